@@ -3,6 +3,7 @@
 from typing import Any
 from uuid import UUID
 from langchain_core.messages import AIMessage, BaseMessage
+from pydantic import BaseModel, computed_field
 from langchain_core.outputs import ChatGeneration, Generation, LLMResult
 from typing_extensions import override
 import structlog
@@ -17,6 +18,58 @@ from esbmc_ai.config import Config
 from esbmc_ai.log_utils import LogCategories
 
 
+class TokenUsage(BaseModel):
+    """Input and output tokens of LLM calls, as reported by the provider. The
+    input tokens are split by how the provider's prompt cache served them."""
+
+    calls: int = 0
+    input_tokens: int = 0
+    """All the input tokens, cached or not."""
+    cache_read_tokens: int = 0
+    """Input tokens read from the prompt cache."""
+    cache_creation_tokens: int = 0
+    """Input tokens written to the prompt cache."""
+    output_tokens: int = 0
+
+    @computed_field  # type: ignore[prop-decorator]
+    @property
+    def uncached_input_tokens(self) -> int:
+        """Input tokens that were not read from or written to the cache."""
+        return self.input_tokens - self.cache_read_tokens - self.cache_creation_tokens
+
+    @classmethod
+    def from_message(cls, message: BaseMessage) -> "TokenUsage | None":
+        """The usage of the call that returned message, None if the provider
+        didn't report it."""
+        usage: Any = getattr(message, "usage_metadata", None)
+        if not usage:
+            return None
+        details: dict[str, Any] = usage.get("input_token_details") or {}
+        return cls(
+            calls=1,
+            input_tokens=usage.get("input_tokens", 0),
+            cache_read_tokens=details.get("cache_read") or 0,
+            cache_creation_tokens=details.get("cache_creation") or 0,
+            output_tokens=usage.get("output_tokens", 0),
+        )
+
+    def add(self, other: "TokenUsage") -> None:
+        """Adds the usage of other to this one."""
+        self.calls += other.calls
+        self.input_tokens += other.input_tokens
+        self.cache_read_tokens += other.cache_read_tokens
+        self.cache_creation_tokens += other.cache_creation_tokens
+        self.output_tokens += other.output_tokens
+
+    def __str__(self) -> str:
+        return (
+            f"{self.input_tokens} input tokens ({self.cache_read_tokens} cache "
+            f"read, {self.cache_creation_tokens} cache write, "
+            f"{self.uncached_input_tokens} uncached), "
+            f"{self.output_tokens} output tokens"
+        )
+
+
 class LoggingCallbackHandler(BaseCallbackHandler):
     """Invoke callback handler is used to print debug messages to the LLM."""
 
@@ -92,6 +145,13 @@ class LoggingCallbackHandler(BaseCallbackHandler):
         **kwargs: Any,
     ) -> Any:
         _ = run_id, parent_run_id, kwargs
+        for msg_group in response.generations:
+            for msg in msg_group:
+                if not isinstance(msg, ChatGeneration):
+                    continue
+                usage: TokenUsage | None = TokenUsage.from_message(msg.message)
+                if usage is not None:
+                    self.logger.info(f"LLM call used {usage}")
         self.logger.debug("=" * 80)
         self.logger.debug("LLM Response")
         for idx, msg_group in enumerate(response.generations):
@@ -199,3 +259,30 @@ class AIModel:
         )
 
         return chat_model
+
+    # Chat model classes that take Anthropic style cache_control markers on
+    # content blocks. Other providers (such as OpenAI) cache prompt prefixes
+    # without markers.
+    CACHE_CONTROL_MODELS: set[str] = {"ChatAnthropic", "ChatAnthropicVertex"}
+
+    @classmethod
+    def supports_cache_control(cls, chat_model: BaseChatModel) -> bool:
+        """If the chat model takes cache_control markers on messages."""
+        return type(chat_model).__name__ in cls.CACHE_CONTROL_MODELS
+
+    @staticmethod
+    def with_cache_control(message: BaseMessage) -> BaseMessage:
+        """A copy of message that marks the end of a cacheable prompt prefix:
+        the last content block gets an ephemeral cache_control marker."""
+        blocks: list[Any] = (
+            [{"type": "text", "text": message.content}]
+            if isinstance(message.content, str)
+            else [
+                {"type": "text", "text": block} if isinstance(block, str) else block
+                for block in message.content
+            ]
+        )
+        if not blocks:
+            return message
+        blocks[-1] = blocks[-1] | {"cache_control": {"type": "ephemeral"}}
+        return message.model_copy(update={"content": blocks})
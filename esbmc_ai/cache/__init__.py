@@ -0,0 +1,7 @@
+"""Verifier result cache backends."""
+
+from .base_cache import BaseCache, CacheStats
+from .disk_cache import DiskCache
+from .remote_cache import RemoteCache
+
+__all__ = ["BaseCache", "CacheStats", "DiskCache", "RemoteCache"]
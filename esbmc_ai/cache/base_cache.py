@@ -0,0 +1,59 @@
+# Author: Yiannis Charalambous
+
+"""Contains the base class of the verifier result cache backends."""
+
+from abc import ABC, abstractmethod
+from dataclasses import dataclass, field
+
+
+@dataclass
+class CacheStats:
+    """Usage statistics of a cache backend."""
+
+    entries: int = 0
+    """Number of entries stored."""
+    total_bytes: int = 0
+    """Total size of the stored entries."""
+    max_bytes: int | None = None
+    """The byte budget of the cache, None if unbounded."""
+    hits: int = 0
+    """Number of lookups that found an entry."""
+    misses: int = 0
+    """Number of lookups that did not find an entry."""
+    versions: dict[str, int] = field(default_factory=dict)
+    """Number of entries stored for each verifier version."""
+
+    @property
+    def hit_rate(self) -> float:
+        """The fraction of lookups that were hits, 0 if there were no lookups."""
+        lookups: int = self.hits + self.misses
+        return self.hits / lookups if lookups else 0.0
+
+
+class BaseCache(ABC):
+    """Key-value store used by verifiers to cache their results. Keys are hex
+    digests, values are opaque bytes: serializing the results is the
+    responsibility of the caller. Implementations need to be thread safe."""
+
+    @abstractmethod
+    def get(self, key: str) -> bytes | None:
+        """Returns the value stored under key, or None if it's not cached."""
+        raise NotImplementedError()
+
+    @abstractmethod
+    def put(self, key: str, data: bytes, version: str = "") -> None:
+        """Stores data under key. The version identifies the verifier that
+        produced the data so that entries can be accounted per version."""
+        raise NotImplementedError()
+
+    @abstractmethod
+    def stats(self) -> CacheStats:
+        """Returns the usage statistics of the cache."""
+        raise NotImplementedError()
+
+    @abstractmethod
+    def prune(self, max_bytes: int | None = None) -> tuple[int, int]:
+        """Evicts the least recently used entries until the cache fits in
+        max_bytes (the configured budget if None). Returns the number of
+        entries removed and the bytes freed."""
+        raise NotImplementedError()
@@ -0,0 +1,227 @@
+# Author: Yiannis Charalambous
+
+"""Reference content-addressed store server for `RemoteCache`, backed by a
+`DiskCache`. Run it with:
+
+    python -m esbmc_ai.cache.cache_server --dir <dir> --port 8765
+    python -m esbmc_ai.cache.cache_server --dir <dir> --unix-socket <path>
+
+The server doesn't authenticate clients: anyone who can reach it can store
+entries, which every client will then read as verification results. Bind it
+to a trusted network or a Unix socket with restricted permissions, and serve
+clients that shouldn't write with --read-only."""
+
+import argparse
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+import os
+from pathlib import Path
+from socketserver import ThreadingMixIn, UnixStreamServer
+from typing import override
+
+from esbmc_ai.cache.disk_cache import DiskCache
+from esbmc_ai.cache.remote_cache import VERSION_HEADER, stats_to_json
+
+_ENTRIES_PREFIX: str = "/entries/"
+_DEFAULT_MAX_ENTRY_SIZE: int = 64 << 20
+
+
+class CacheRequestHandler(BaseHTTPRequestHandler):
+    """Serves the entries of the cache of the server."""
+
+    server: "CacheHTTPServer | CacheUnixServer"  # type: ignore[assignment]
+    protocol_version = "HTTP/1.1"
+
+    def _send(
+        self, status: int, body: bytes = b"", version: str = "", close: bool = False
+    ) -> None:
+        """Sends a response. With close the connection is closed after it,
+        for when the body of the request was not read."""
+        self.send_response(status)
+        self.send_header("Content-Length", str(len(body)))
+        if close:
+            self.send_header("Connection", "close")
+            self.close_connection = True
+        if version:
+            self.send_header(VERSION_HEADER, version)
+        self.end_headers()
+        if body:
+            self.wfile.write(body)
+
+    def _key(self) -> str | None:
+        if not self.path.startswith(_ENTRIES_PREFIX):
+            return None
+        return self.path[len(_ENTRIES_PREFIX) :]
+
+    def do_GET(self) -> None:
+        """Returns an entry or the stats of the cache."""
+        if self.path == "/stats":
+            self._send(200, stats_to_json(self.server.cache.stats()))
+            return
+
+        key: str | None = self._key()
+        if key is None:
+            self._send(404)
+            return
+        try:
+            entry: tuple[bytes, str] | None = self.server.cache.get_entry(key)
+        except ValueError:
+            self._send(400)
+            return
+        if entry is None:
+            self._send(404)
+        else:
+            self._send(200, *entry)
+
+    def do_PUT(self) -> None:
+        """Stores an entry, unless the server is read-only. The body is only
+        read once the request is known to be accepted, and is limited to the
+        max_entry_size of the server."""
+        if self.server.read_only:
+            self._send(403, close=True)
+            return
+        key: str | None = self._key()
+        if key is None:
+            self._send(404, close=True)
+            return
+        header: str | None = self.headers.get("Content-Length")
+        if header is None:
+            self._send(411, close=True)
+            return
+        try:
+            length: int = int(header)
+        except ValueError:
+            length = -1
+        if length < 0:
+            self._send(400, close=True)
+            return
+        if length > self.server.max_entry_size:
+            self._send(413, close=True)
+            return
+
+        data: bytes = self.rfile.read(length)
+        try:
+            self.server.cache.put(
+                key, data, version=self.headers.get(VERSION_HEADER, "")
+            )
+        except ValueError:
+            self._send(400)
+            return
+        self._send(204)
+
+    @override
+    def address_string(self) -> str:
+        # Unix socket clients don't have an address.
+        return str(self.client_address[0]) if self.client_address else "unix"
+
+    @override
+    def log_message(self, format: str, *args) -> None:
+        if not self.server.quiet:
+            super().log_message(format, *args)
+
+
+class CacheHTTPServer(ThreadingHTTPServer):
+    """Cache server listening on TCP."""
+
+    daemon_threads = True
+
+    def __init__(
+        self,
+        address: tuple[str, int],
+        cache: DiskCache,
+        quiet: bool = False,
+        read_only: bool = False,
+        max_entry_size: int = _DEFAULT_MAX_ENTRY_SIZE,
+    ) -> None:
+        self.cache: DiskCache = cache
+        self.quiet: bool = quiet
+        self.read_only: bool = read_only
+        self.max_entry_size: int = max_entry_size
+        super().__init__(address, CacheRequestHandler)
+
+
+class CacheUnixServer(ThreadingMixIn, UnixStreamServer):
+    """Cache server listening on a Unix domain socket."""
+
+    daemon_threads = True
+
+    def __init__(
+        self,
+        path: Path,
+        cache: DiskCache,
+        quiet: bool = False,
+        read_only: bool = False,
+        max_entry_size: int = _DEFAULT_MAX_ENTRY_SIZE,
+    ) -> None:
+        self.cache: DiskCache = cache
+        self.quiet: bool = quiet
+        self.read_only: bool = read_only
+        self.max_entry_size: int = max_entry_size
+        if path.is_socket():
+            path.unlink()
+        super().__init__(str(path), CacheRequestHandler)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description="Content-addressed store server for the ESBMC-AI verifier "
+        "cache."
+    )
+    parser.add_argument("--dir", type=Path, required=True, help="Cache directory.")
+    parser.add_argument("--host", default="127.0.0.1", help="Address to bind.")
+    parser.add_argument("--port", type=int, default=8765, help="Port to bind.")
+    parser.add_argument(
+        "--unix-socket", type=Path, help="Listen on a Unix socket instead."
+    )
+    parser.add_argument(
+        "--max-size", type=int, default=None, help="Byte budget of the cache."
+    )
+    parser.add_argument("--quiet", action="store_true", help="Don't log requests.")
+    parser.add_argument(
+        "--read-only",
+        action="store_true",
+        help="Reject stores. The server doesn't authenticate writers.",
+    )
+    parser.add_argument(
+        "--max-entry-size",
+        type=int,
+        default=_DEFAULT_MAX_ENTRY_SIZE,
+        help="Largest entry in bytes that can be stored, larger ones are "
+        "rejected before they are read.",
+    )
+    args = parser.parse_args()
+
+    cache: DiskCache = DiskCache(
+        directory=args.dir.expanduser(), max_bytes=args.max_size
+    )
+    server: CacheHTTPServer | CacheUnixServer
+    if args.unix_socket:
+        server = CacheUnixServer(
+            args.unix_socket,
+            cache,
+            quiet=args.quiet,
+            read_only=args.read_only,
+            max_entry_size=args.max_entry_size,
+        )
+        print(f"Serving {args.dir} on unix://{args.unix_socket}")
+    else:
+        server = CacheHTTPServer(
+            (args.host, args.port),
+            cache,
+            quiet=args.quiet,
+            read_only=args.read_only,
+            max_entry_size=args.max_entry_size,
+        )
+        print(f"Serving {args.dir} on http://{args.host}:{server.server_port}")
+
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.server_close()
+        if args.unix_socket:
+            os.unlink(args.unix_socket)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,284 @@
+# Author: Yiannis Charalambous
+
+"""Sharded on-disk cache with an LRU index and a byte budget."""
+
+import os
+import re
+import sqlite3
+from pathlib import Path
+from tempfile import NamedTemporaryFile
+from threading import Lock
+from time import time
+from typing import override
+
+import structlog
+
+from esbmc_ai.cache.base_cache import BaseCache, CacheStats
+from esbmc_ai.log_categories import LogCategories
+
+_KEY_PATTERN = re.compile(r"[0-9a-f]{8,128}")
+# The next last_access of the index, the statement it is part of runs
+# atomically, so it is unique even when several processes share the index.
+_NEXT_ACCESS: str = "(SELECT COALESCE(MAX(last_access), 0) + 1 FROM entries)"
+# The triggers that keep the total_bytes counter equal to the size of entries.
+_TOTAL_BYTES_TRIGGERS: list[tuple[str, str, str]] = [
+    ("entries_insert_size", "INSERT ON entries", "NEW.size"),
+    ("entries_delete_size", "DELETE ON entries", "-OLD.size"),
+    ("entries_update_size", "UPDATE OF size ON entries", "NEW.size - OLD.size"),
+]
+# The number of least recently used entries read at a time when evicting.
+_EVICT_BATCH: int = 64
+# Prefix of the temporary files entries are written to, which is not a hex
+# character so they can't be mistaken for entries.
+_TEMP_PREFIX: str = "tmp"
+# Age in seconds after which a temporary file is considered left by an
+# interrupted put, rather than being written by another process.
+_STALE_TEMP_AGE: float = 3600
+
+
+class DiskCache(BaseCache):
+    """Stores each entry in its own file, sharded into two levels of
+    subdirectories by the first 4 hex characters of the key so that no
+    directory grows too large:
+
+        <directory>/ab/cd/abcd...
+
+    A SQLite index (key -> size, last access, version) is kept alongside the
+    entries, along with the hit/miss counters. The last access is a sequence
+    number rather than a time, so the LRU order doesn't depend on the
+    resolution of the clock. The index is what the byte budget and LRU
+    eviction are computed from, so the entries never need to be listed. The
+    total size of the entries is kept up to date in the counters by triggers,
+    so checking the budget doesn't scan the index. SQLite takes care of
+    concurrent access from multiple processes."""
+
+    INDEX_NAME: str = "index.sqlite3"
+
+    def __init__(self, directory: Path, max_bytes: int | None = None) -> None:
+        """Creates a cache in directory. If max_bytes is set, the least
+        recently used entries are evicted whenever the total size of the
+        entries exceeds it."""
+        super().__init__()
+        self.directory: Path = directory
+        self.max_bytes: int | None = max_bytes
+        self._lock: Lock = Lock()
+        self._db: sqlite3.Connection | None = None
+        self._logger: structlog.stdlib.BoundLogger = structlog.get_logger(
+            self.__class__.__name__
+        ).bind(category=LogCategories.VERIFIER)
+
+    @property
+    def index_path(self) -> Path:
+        """Path of the SQLite index."""
+        return self.directory / self.INDEX_NAME
+
+    def _connect(self) -> sqlite3.Connection:
+        """Opens the index, creating it if needed. Must hold the lock."""
+        if self._db is None:
+            self.directory.mkdir(parents=True, exist_ok=True)
+            db = sqlite3.connect(
+                self.index_path,
+                timeout=30,
+                isolation_level=None,
+                check_same_thread=False,
+            )
+            db.execute("PRAGMA journal_mode=WAL")
+            db.execute(
+                "CREATE TABLE IF NOT EXISTS entries ("
+                "key TEXT PRIMARY KEY, "
+                "size INTEGER NOT NULL, "
+                "last_access INTEGER NOT NULL, "
+                "version TEXT NOT NULL)"
+            )
+            db.execute(
+                "CREATE INDEX IF NOT EXISTS entries_lru ON entries(last_access)"
+            )
+            db.execute(
+                "CREATE TABLE IF NOT EXISTS counters ("
+                "name TEXT PRIMARY KEY, value INTEGER NOT NULL)"
+            )
+            db.executemany(
+                "INSERT OR IGNORE INTO counters VALUES (?, 0)",
+                [("hits",), ("misses",)],
+            )
+            for trigger, event, change in _TOTAL_BYTES_TRIGGERS:
+                db.execute(
+                    f"CREATE TRIGGER IF NOT EXISTS {trigger} AFTER {event} "
+                    "BEGIN UPDATE counters SET value = value + "
+                    f"{change} WHERE name = 'total_bytes'; END"
+                )
+            # Created after the triggers, so an index from an older version
+            # starts from the size of the entries it already has.
+            db.execute(
+                "INSERT OR IGNORE INTO counters SELECT 'total_bytes', "
+                "COALESCE(SUM(size), 0) FROM entries"
+            )
+            self._db = db
+        return self._db
+
+    def _entry_path(self, key: str) -> Path:
+        if not _KEY_PATTERN.fullmatch(key):
+            raise ValueError(f"Invalid cache key: {key}")
+        return self.directory / key[:2] / key[2:4] / key
+
+    def _count(self, db: sqlite3.Connection, counter: str) -> None:
+        db.execute("UPDATE counters SET value = value + 1 WHERE name = ?", (counter,))
+
+    @override
+    def get(self, key: str) -> bytes | None:
+        entry: tuple[bytes, str] | None = self.get_entry(key)
+        return entry[0] if entry else None
+
+    def get_entry(self, key: str) -> tuple[bytes, str] | None:
+        """Returns the value stored under key along with its version, or None
+        if it's not cached."""
+        path: Path = self._entry_path(key)
+        with self._lock:
+            db: sqlite3.Connection = self._connect()
+            row = db.execute(
+                "SELECT version FROM entries WHERE key = ?", (key,)
+            ).fetchone()
+            if row:
+                try:
+                    data: bytes = path.read_bytes()
+                except FileNotFoundError:
+                    # Deleted behind our back, drop the stale index entry.
+                    db.execute("DELETE FROM entries WHERE key = ?", (key,))
+                else:
+                    db.execute(
+                        f"UPDATE entries SET last_access = {_NEXT_ACCESS} "
+                        "WHERE key = ?",
+                        (key,),
+                    )
+                    self._count(db, "hits")
+                    return data, row[0]
+
+            self._count(db, "misses")
+            return None
+
+    @override
+    def put(self, key: str, data: bytes, version: str = "") -> None:
+        path: Path = self._entry_path(key)
+        path.parent.mkdir(parents=True, exist_ok=True)
+        # Write to a temporary file first so that readers in other processes
+        # never see a partially written entry.
+        with NamedTemporaryFile(
+            dir=path.parent, prefix=_TEMP_PREFIX, delete=False
+        ) as file:
+            file.write(data)
+        os.replace(file.name, path)
+
+        with self._lock:
+            db: sqlite3.Connection = self._connect()
+            # An upsert rather than INSERT OR REPLACE, whose implicit delete
+            # doesn't fire the triggers that keep the total size.
+            db.execute(
+                f"INSERT INTO entries VALUES (?, ?, {_NEXT_ACCESS}, ?) "
+                "ON CONFLICT(key) DO UPDATE SET size = excluded.size, "
+                "last_access = excluded.last_access, version = excluded.version",
+                (key, len(data), version),
+            )
+            if self.max_bytes is not None:
+                self._evict(db, self.max_bytes)
+
+    def _total_bytes(self, db: sqlite3.Connection) -> int:
+        return db.execute(
+            "SELECT value FROM counters WHERE name = 'total_bytes'"
+        ).fetchone()[0]
+
+    def _evict(self, db: sqlite3.Connection, max_bytes: int) -> tuple[int, int]:
+        """Evicts least recently used entries until the total size fits in
+        max_bytes. Only the entries that are evicted are read from the index.
+        Must hold the lock."""
+        total: int = self._total_bytes(db)
+        removed: int = 0
+        freed: int = 0
+        while total - freed > max_bytes:
+            evicted: list[tuple[str]] = []
+            for key, size in db.execute(
+                "SELECT key, size FROM entries ORDER BY last_access ASC LIMIT ?",
+                (_EVICT_BATCH,),
+            ):
+                if total - freed <= max_bytes:
+                    break
+                self._entry_path(key).unlink(missing_ok=True)
+                evicted.append((key,))
+                freed += size
+            if not evicted:
+                break
+            db.executemany("DELETE FROM entries WHERE key = ?", evicted)
+            removed += len(evicted)
+
+        if removed:
+            self._logger.debug(f"Evicted {removed} cache entries ({freed} bytes)")
+        return removed, freed
+
+    @override
+    def stats(self) -> CacheStats:
+        with self._lock:
+            db: sqlite3.Connection = self._connect()
+            entries: int = db.execute("SELECT COUNT(*) FROM entries").fetchone()[0]
+            total_bytes: int = self._total_bytes(db)
+            counters: dict[str, int] = dict(
+                db.execute("SELECT name, value FROM counters").fetchall()
+            )
+            versions: dict[str, int] = dict(
+                db.execute(
+                    "SELECT version, COUNT(*) FROM entries GROUP BY version"
+                ).fetchall()
+            )
+        return CacheStats(
+            entries=entries,
+            total_bytes=total_bytes,
+            max_bytes=self.max_bytes,
+            hits=counters.get("hits", 0),
+            misses=counters.get("misses", 0),
+            versions=versions,
+        )
+
+    @override
+    def prune(self, max_bytes: int | None = None) -> tuple[int, int]:
+        """Evicts entries over the budget. Also drops index entries whose files
+        are missing, and deletes the unindexed entries left at the top level of
+        the directory by the flat cache layout of older versions and the stale
+        temporary files left in the shard directories by interrupted puts."""
+        budget: int | None = max_bytes if max_bytes is not None else self.max_bytes
+        removed: int = 0
+        freed: int = 0
+
+        if self.directory.is_dir():
+            for path in self.directory.iterdir():
+                if path.is_file() and _KEY_PATTERN.fullmatch(path.name):
+                    freed += path.stat().st_size
+                    path.unlink(missing_ok=True)
+                    removed += 1
+
+            stale: float = time() - _STALE_TEMP_AGE
+            for path in self.directory.glob(f"??/??/{_TEMP_PREFIX}*"):
+                try:
+                    stat: os.stat_result = path.stat()
+                    if stat.st_mtime >= stale:
+                        continue
+                    path.unlink()
+                except FileNotFoundError:
+                    # Renamed to its entry in the meantime.
+                    continue
+                freed += stat.st_size
+                removed += 1
+
+        with self._lock:
+            db: sqlite3.Connection = self._connect()
+            missing: list[tuple[str]] = [
+                (key,)
+                for (key,) in db.execute("SELECT key FROM entries").fetchall()
+                if not self._entry_path(key).exists()
+            ]
+            db.executemany("DELETE FROM entries WHERE key = ?", missing)
+            removed += len(missing)
+
+            if budget is not None:
+                evicted, evicted_bytes = self._evict(db, budget)
+                removed += evicted
+                freed += evicted_bytes
+
+        return removed, freed
@@ -0,0 +1,261 @@
+# Author: Yiannis Charalambous
+
+"""Cache backend that shares verifier results through a content-addressed
+store server, see `esbmc_ai.cache.cache_server` for the reference server.
+
+The protocol is plain HTTP, served over TCP or a Unix socket:
+
+    GET  /entries/<key>   200 with the entry, or 404.
+    PUT  /entries/<key>   Stores the body. The X-Cache-Version header holds the
+                          version of the verifier that produced it.
+    GET  /stats           200 with the CacheStats of the store as JSON."""
+
+import atexit
+from dataclasses import asdict
+from http.client import HTTPConnection, HTTPException, HTTPResponse
+import json
+from queue import Full, Queue
+import socket
+from threading import Lock, Thread
+from time import monotonic
+from typing import override
+from urllib.parse import unquote, urlparse
+
+import structlog
+
+from esbmc_ai.cache.base_cache import BaseCache, CacheStats
+from esbmc_ai.log_categories import LogCategories
+
+VERSION_HEADER: str = "X-Cache-Version"
+
+
+class _UnixHTTPConnection(HTTPConnection):
+    """HTTP connection over a Unix domain socket."""
+
+    def __init__(self, socket_path: str, timeout: float) -> None:
+        super().__init__("localhost", timeout=timeout)
+        self.socket_path: str = socket_path
+
+    @override
+    def connect(self) -> None:
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.settimeout(self.timeout)
+        sock.connect(self.socket_path)
+        self.sock = sock
+
+
+class RemoteCache(BaseCache):
+    """Read-through, write-behind cache in front of a remote store. Lookups
+    check the local cache first, and results fetched from the store are copied
+    into it. Stores are written to the local cache straight away and pushed to
+    the store by a background thread, so verification never waits on the
+    network.
+
+    If the store can't be reached the cache falls back to the local cache, and
+    the store is not contacted again until the retry interval has passed. The
+    uploads that are dropped meanwhile are counted and reported by flush.
+
+    The pending uploads are sent when the process exits, waiting at most
+    flush_timeout seconds, so the results of a run are not lost."""
+
+    QUEUE_SIZE: int = 256
+    """Maximum number of pending uploads, uploads are dropped when full."""
+
+    def __init__(
+        self,
+        url: str,
+        local: BaseCache,
+        timeout: float = 5.0,
+        retry_interval: float = 30.0,
+        flush_timeout: float = 10.0,
+    ) -> None:
+        """Creates a cache for the store at url, which is either
+        http://host:port or unix:///path/to/socket."""
+        super().__init__()
+        parsed = urlparse(url)
+        if parsed.scheme not in ("http", "unix"):
+            raise ValueError(f"Unsupported cache URL: {url}")
+        self.url: str = url
+        self.local: BaseCache = local
+        self.timeout: float = timeout
+        self.retry_interval: float = retry_interval
+        self.flush_timeout: float = flush_timeout
+        self._scheme: str = parsed.scheme
+        self._netloc: str = parsed.netloc
+        self._socket_path: str = unquote(parsed.path)
+        self._base_path: str = "" if self._scheme == "unix" else parsed.path
+        self._base_path = self._base_path.rstrip("/")
+
+        # Guards _offline_until and _dropped, which the writer thread and the
+        # threads that look up entries update.
+        self._lock: Lock = Lock()
+        self._offline_until: float = 0
+        self._dropped: int = 0
+        """Number of uploads dropped since the last flush."""
+        self._queue: Queue[tuple[str, bytes, str] | None] = Queue(self.QUEUE_SIZE)
+        self._writer: Thread | None = None
+        self._writer_lock: Lock = Lock()
+        self._logger: structlog.stdlib.BoundLogger = structlog.get_logger(
+            self.__class__.__name__
+        ).bind(category=LogCategories.VERIFIER)
+
+    def _connection(self) -> HTTPConnection:
+        if self._scheme == "unix":
+            return _UnixHTTPConnection(self._socket_path, timeout=self.timeout)
+        return HTTPConnection(self._netloc, timeout=self.timeout)
+
+    def _request(
+        self,
+        method: str,
+        path: str,
+        body: bytes | None = None,
+        headers: dict[str, str] | None = None,
+    ) -> tuple[int, bytes, HTTPResponse] | None:
+        """Sends a request to the store. Returns None if the store is offline
+        or the request failed."""
+        with self._lock:
+            if monotonic() < self._offline_until:
+                return None
+
+        connection: HTTPConnection = self._connection()
+        try:
+            connection.request(method, self._base_path + path, body, headers or {})
+            response: HTTPResponse = connection.getresponse()
+            return response.status, response.read(), response
+        except (OSError, HTTPException) as e:
+            self._logger.warn(f"Cache server {self.url} unavailable: {e}")
+            with self._lock:
+                self._offline_until = monotonic() + self.retry_interval
+            return None
+        finally:
+            connection.close()
+
+    @override
+    def get(self, key: str) -> bytes | None:
+        data: bytes | None = self.local.get(key)
+        if data is not None:
+            return data
+
+        result = self._request("GET", f"/entries/{key}")
+        if result is None:
+            return None
+        status, data, response = result
+        if status != 200:
+            return None
+
+        self.local.put(key, data, version=response.getheader(VERSION_HEADER, ""))
+        return data
+
+    @override
+    def put(self, key: str, data: bytes, version: str = "") -> None:
+        self.local.put(key, data, version=version)
+        self._start_writer()
+        try:
+            self._queue.put_nowait((key, data, version))
+        except Full:
+            self._logger.warn(f"Cache upload queue full, not uploading {key}")
+            self._drop()
+
+    def _drop(self) -> None:
+        with self._lock:
+            self._dropped += 1
+
+    def _start_writer(self) -> None:
+        with self._writer_lock:
+            if self._writer is None or not self._writer.is_alive():
+                # The writer is a daemon thread, which is killed once the
+                # atexit handlers have run. close unregisters the handler.
+                atexit.register(self.close)
+                self._writer = Thread(
+                    target=self._write_behind, name="RemoteCacheWriter", daemon=True
+                )
+                self._writer.start()
+
+    def _write_behind(self) -> None:
+        """Uploads the queued entries to the store."""
+        while True:
+            item = self._queue.get()
+            try:
+                if item is None:
+                    return
+                key, data, version = item
+                result = self._request(
+                    "PUT", f"/entries/{key}", data, {VERSION_HEADER: version}
+                )
+                if result is None:
+                    self._drop()
+                elif result[0] >= 300:
+                    self._logger.warn(f"Cache server rejected {key}: {result[0]}")
+                    self._drop()
+            finally:
+                self._queue.task_done()
+
+    def flush(self, timeout: float | None = None) -> bool:
+        """Blocks until all the pending uploads have been sent, or timeout
+        seconds have passed. Returns False on timeout, or if uploads were
+        dropped since the last flush because the store was offline, rejected
+        them or the queue was full."""
+        if not self._wait_uploads(timeout):
+            return False
+        return self._report_dropped() == 0
+
+    def _report_dropped(self) -> int:
+        """Logs and returns the number of uploads dropped since the last
+        call."""
+        with self._lock:
+            dropped, self._dropped = self._dropped, 0
+        if dropped:
+            self._logger.warn(
+                f"{dropped} uploads to cache server {self.url} were dropped"
+            )
+        return dropped
+
+    def _wait_uploads(self, timeout: float | None) -> bool:
+        deadline: float | None = None if timeout is None else monotonic() + timeout
+        with self._queue.all_tasks_done:
+            while self._queue.unfinished_tasks:
+                remaining: float | None = (
+                    None if deadline is None else deadline - monotonic()
+                )
+                if remaining is not None and remaining <= 0:
+                    return False
+                self._queue.all_tasks_done.wait(remaining)
+        return True
+
+    def close(self) -> None:
+        """Sends the pending uploads and stops the background thread, waiting
+        at most flush_timeout seconds. Uploads still pending are dropped."""
+        atexit.unregister(self.close)
+        if self._writer is None or not self._writer.is_alive():
+            return
+        if not self._wait_uploads(self.flush_timeout):
+            self._logger.warn(
+                f"Cache server {self.url} too slow, dropping "
+                f"{self._queue.unfinished_tasks} uploads"
+            )
+            return
+        self._report_dropped()
+        self._queue.put(None)
+        self._writer.join(self.flush_timeout)
+
+    def remote_stats(self) -> CacheStats | None:
+        """Returns the statistics of the store, None if it's unavailable."""
+        result = self._request("GET", "/stats")
+        if result is None or result[0] != 200:
+            return None
+        return CacheStats(**json.loads(result[1]))
+
+    @override
+    def stats(self) -> CacheStats:
+        """Returns the statistics of the local cache."""
+        return self.local.stats()
+
+    @override
+    def prune(self, max_bytes: int | None = None) -> tuple[int, int]:
+        """Prunes the local cache, the store manages its own budget."""
+        return self.local.prune(max_bytes)
+
+
+def stats_to_json(stats: CacheStats) -> bytes:
+    """Encodes cache stats in the format returned by the stats endpoint."""
+    return json.dumps(asdict(stats)).encode("utf-8")
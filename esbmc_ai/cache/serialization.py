@@ -0,0 +1,297 @@
+# Author: Yiannis Charalambous
+
+"""Compact, versioned serialization of verifier outputs for the cache.
+
+An entry is laid out as follows (little endian):
+
+    magic (4 bytes) | format version (u16) | codec (u8) | meta length (u32)
+    | output checksum (u32) | meta (compressed JSON) | output (compressed)
+
+The meta block holds the scalar fields of the output, a fingerprint of the
+schema of every model involved, and the issues. The traces of each issue are
+stored as a columnar table where paths are indices into a shared path table,
+since the same few files are repeated in every trace point. The raw verifier
+output is compressed separately and only decompressed when the `output` field
+is first accessed, so a cache hit that only looks at `successful` and the
+issues never inflates it. The CRC32 of the compressed output is checked when
+the entry is loaded, so a corrupt output is a miss rather than an error on
+first access.
+
+Entries can come from a shared store, so the classes they name are only
+looked up in a registry of known classes, never imported. Verifiers with their
+own output or issue classes register them with register_class."""
+
+from hashlib import sha256
+import json
+from pathlib import Path
+import struct
+from typing import Any
+import zlib
+
+from pydantic import BaseModel
+
+from esbmc_ai.issue import Issue, VerifierIssue
+from esbmc_ai.program_trace import CounterexampleProgramTrace, ProgramTrace
+from esbmc_ai.verifier_output import VerifierOutput
+
+try:
+    import zstandard
+except ImportError:  # pragma: no cover - zlib fallback
+    zstandard = None
+
+FORMAT_VERSION: int = 2
+_MAGIC: bytes = b"EAIR"
+_HEADER = struct.Struct("<4sHBII")
+
+CODEC_ZLIB: int = 1
+CODEC_ZSTD: int = 2
+
+
+class CacheFormatError(Exception):
+    """Raised when a cache entry was written with a different format, schema
+    or codec, or is corrupt, and can't be decoded. Should be treated as a cache
+    miss."""
+
+
+_DECODE_ERRORS: tuple[type[Exception], ...] = (
+    zlib.error,
+    ValueError,
+    KeyError,
+    IndexError,
+    TypeError,
+) + ((zstandard.ZstdError,) if zstandard is not None else ())
+"""The errors raised by decompressing or decoding a corrupt entry."""
+
+
+def _compress(data: bytes, codec: int) -> bytes:
+    if codec == CODEC_ZSTD:
+        assert zstandard is not None
+        return zstandard.ZstdCompressor(level=3).compress(data)
+    return zlib.compress(data, level=6)
+
+
+def _decompress(data: bytes, codec: int) -> bytes:
+    if codec == CODEC_ZSTD:
+        if zstandard is None:
+            raise CacheFormatError("Entry is zstd compressed, zstandard is missing")
+        return zstandard.ZstdDecompressor().decompress(data)
+    if codec == CODEC_ZLIB:
+        return zlib.decompress(data)
+    raise CacheFormatError(f"Unknown codec: {codec}")
+
+
+def _class_path(cls: type) -> str:
+    return f"{cls.__module__}:{cls.__qualname__}"
+
+
+_CLASSES: dict[str, type] = {}
+"""The classes entries can be decoded to, by their class path."""
+
+
+def register_class[T: type](cls: T) -> T:
+    """Allows entries to be decoded to cls, a VerifierOutput or Issue subclass.
+    Returns cls so it can be used as a decorator. The classes of the outputs
+    written by dumps are registered too."""
+    assert issubclass(cls, (VerifierOutput, Issue)), f"{cls} can't be cached"
+    _CLASSES[_class_path(cls)] = cls
+    return cls
+
+
+register_class(VerifierOutput)
+register_class(Issue)
+register_class(VerifierIssue)
+
+
+def _resolve_class(path: str, base: type) -> type:
+    cls: type | None = _CLASSES.get(path)
+    if cls is None:
+        raise CacheFormatError(f"Unknown class {path}")
+    if not issubclass(cls, base):
+        raise CacheFormatError(f"{path} is not a {base.__name__}")
+    return cls
+
+
+def schema_fingerprint(output_cls: type[VerifierOutput]) -> str:
+    """Fingerprint of the fields of every model stored in an entry. Entries
+    written by a version of the models with different fields are rejected."""
+    models: list[type[BaseModel]] = [
+        output_cls,
+        Issue,
+        VerifierIssue,
+        ProgramTrace,
+        CounterexampleProgramTrace,
+    ]
+    schema: str = ";".join(
+        _class_path(m) + "=" + ",".join(sorted(m.model_fields)) for m in models
+    )
+    return sha256(schema.encode("utf-8")).hexdigest()[:16]
+
+
+class _PathTable:
+    """Deduplicates the paths of all the traces in an entry."""
+
+    def __init__(self, paths: list[str] | None = None) -> None:
+        self.paths: list[str] = paths or []
+        self._index: dict[str, int] = {p: i for i, p in enumerate(self.paths)}
+
+    def add(self, path: Path) -> int:
+        key: str = str(path)
+        if key not in self._index:
+            self._index[key] = len(self.paths)
+            self.paths.append(key)
+        return self._index[key]
+
+
+def _encode_traces(
+    traces: list[ProgramTrace], paths: _PathTable, assignments: bool
+) -> dict[str, list]:
+    table: dict[str, list] = {
+        "trace_index": [t.trace_index for t in traces],
+        "path": [paths.add(t.path) for t in traces],
+        "name": [t.name for t in traces],
+        "line_idx": [t.line_idx for t in traces],
+    }
+    if assignments:
+        table["assignment"] = [
+            getattr(t, "assignment", None) for t in traces  # type: ignore
+        ]
+    return table
+
+
+def _decode_traces(
+    table: dict[str, list], paths: list[Path], cls: type[ProgramTrace]
+) -> list:
+    columns: list[str] = ["trace_index", "path", "name", "line_idx"]
+    if cls is CounterexampleProgramTrace:
+        columns.append("assignment")
+    traces: list = []
+    for row in zip(*(table[c] for c in columns)):
+        values: dict[str, Any] = dict(zip(columns, row))
+        values["path"] = paths[values["path"]]
+        # The entry is schema checked, so validation can be skipped.
+        traces.append(cls.model_construct(**values))
+    return traces
+
+
+_ISSUE_BASE_FIELDS: set[str] = {
+    "error_type",
+    "message",
+    "severity",
+    "stack_trace",
+    "counterexample",
+}
+
+
+def _encode_issue(issue: Issue, paths: _PathTable) -> dict[str, Any]:
+    register_class(type(issue))
+    encoded: dict[str, Any] = {
+        "class": _class_path(type(issue)),
+        "error_type": issue.error_type,
+        "message": issue.message,
+        "severity": issue.severity,
+        "stack_trace": _encode_traces(issue.stack_trace, paths, assignments=False),
+    }
+    if isinstance(issue, VerifierIssue):
+        encoded["counterexample"] = _encode_traces(
+            issue.counterexample, paths, assignments=True  # type: ignore
+        )
+    extra_fields: set[str] = set(type(issue).model_fields) - _ISSUE_BASE_FIELDS
+    if extra_fields:
+        encoded["extra"] = issue.model_dump(mode="json", include=extra_fields)
+    return encoded
+
+
+def _decode_issue(encoded: dict[str, Any], paths: list[Path]) -> Issue:
+    cls: type = _resolve_class(encoded["class"], Issue)
+    values: dict[str, Any] = {
+        "error_type": encoded["error_type"],
+        "message": encoded["message"],
+        "severity": encoded["severity"],
+        "stack_trace": _decode_traces(encoded["stack_trace"], paths, ProgramTrace),
+    }
+    if "counterexample" in encoded:
+        values["counterexample"] = _decode_traces(
+            encoded["counterexample"], paths, CounterexampleProgramTrace
+        )
+    if "extra" in encoded:
+        # Fields added by subclasses are stored in JSON mode, so they need to
+        # be validated to be converted back.
+        return cls.model_validate(values | encoded["extra"])
+    return cls.model_construct(**values)
+
+
+def dumps(output: VerifierOutput, codec: int | None = None) -> bytes:
+    """Serializes a verifier output. Uses zstd when available unless a codec
+    is given."""
+    if codec is None:
+        codec = CODEC_ZSTD if zstandard is not None else CODEC_ZLIB
+
+    output_cls: type[VerifierOutput] = register_class(type(output))
+    scalar_fields: set[str] = set(output_cls.model_fields) - {"output", "issues"}
+    paths: _PathTable = _PathTable()
+    issues: list[dict[str, Any]] = [_encode_issue(i, paths) for i in output.issues]
+    meta: dict[str, Any] = {
+        "class": _class_path(output_cls),
+        "schema": schema_fingerprint(output_cls),
+        "fields": output.model_dump(mode="json", include=scalar_fields),
+        "paths": paths.paths,
+        "issues": issues,
+    }
+
+    meta_blob: bytes = _compress(
+        json.dumps(meta, separators=(",", ":")).encode("utf-8"), codec
+    )
+    output_blob: bytes = _compress(output.output.encode("utf-8"), codec)
+    header: bytes = _HEADER.pack(
+        _MAGIC, FORMAT_VERSION, codec, len(meta_blob), zlib.crc32(output_blob)
+    )
+    return header + meta_blob + output_blob
+
+
+def loads(data: bytes) -> VerifierOutput:
+    """Deserializes a verifier output written by dumps. The raw output is
+    decompressed lazily.
+
+    Raises:
+        CacheFormatError: If the entry can't be decoded by this version or is
+            corrupt."""
+    if len(data) < _HEADER.size:
+        raise CacheFormatError("Entry is truncated")
+    magic, version, codec, meta_len, output_crc = _HEADER.unpack_from(data)
+    if magic != _MAGIC:
+        raise CacheFormatError("Entry is not in the compact format")
+    if version != FORMAT_VERSION:
+        raise CacheFormatError(f"Unsupported format version: {version}")
+
+    meta_end: int = _HEADER.size + meta_len
+    output_blob: bytes = data[meta_end:]
+    if meta_end > len(data) or zlib.crc32(output_blob) != output_crc:
+        raise CacheFormatError("Entry output is corrupt")
+
+    try:
+        meta: dict[str, Any] = json.loads(
+            _decompress(data[_HEADER.size : meta_end], codec)
+        )
+        output_cls: type = _resolve_class(meta["class"], VerifierOutput)
+        if meta["schema"] != schema_fingerprint(output_cls):
+            raise CacheFormatError("Entry was written with a different schema")
+
+        paths: list[Path] = [Path(p) for p in meta["paths"]]
+        issues: list[Issue] = [_decode_issue(i, paths) for i in meta["issues"]]
+        fields: dict[str, Any] = meta["fields"]
+    except _DECODE_ERRORS as e:
+        raise CacheFormatError("Entry meta block is corrupt") from e
+
+    def load_output() -> str:
+        try:
+            return _decompress(output_blob, codec).decode("utf-8")
+        except _DECODE_ERRORS as e:
+            # The checksum matched, so the entry was written corrupt.
+            raise CacheFormatError("Entry output is corrupt") from e
+
+    try:
+        return output_cls.from_cache(
+            fields=fields, issues=issues, output_loader=load_output
+        )
+    except _DECODE_ERRORS as e:
+        raise CacheFormatError("Entry fields are corrupt") from e
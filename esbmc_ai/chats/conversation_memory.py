@@ -0,0 +1,152 @@
+# Author: Yiannis Charalambous
+
+"""Memory policies that bound the conversation sent to the LLM during repair.
+Each repair attempt re-embeds the source code and the verifier output, so
+without a policy the prompt grows with every attempt."""
+
+from abc import ABC, abstractmethod
+from dataclasses import dataclass
+from typing import Callable, Literal, override
+
+from langchain_core.messages import BaseMessage, HumanMessage
+from structlog.stdlib import get_logger
+
+from esbmc_ai.log_categories import LogCategories
+
+MemoryStrategy = Literal["full", "last_turns", "summarize"]
+
+
+@dataclass
+class ConversationTurn:
+    """A repair attempt in the conversation: the rendered prompt followed by
+    the response of the LLM once it has been received."""
+
+    messages: list[BaseMessage]
+    summary: str | None = None
+    """Short description of the attempt that replaces its messages when it is
+    collapsed. None until the response is received."""
+    collapsed: bool = False
+
+    def collapse(self) -> None:
+        """Replaces the messages of the turn by its summary."""
+        if self.summary is not None and not self.collapsed:
+            self.messages = [HumanMessage(content=self.summary)]
+            self.collapsed = True
+
+
+class ConversationMemory(ABC):
+    """Decides which turns of the conversation are kept. The system messages
+    and the current turn (the last one) are always kept, the oldest turns are
+    evicted first."""
+
+    @abstractmethod
+    def prune(
+        self, system: list[BaseMessage], turns: list[ConversationTurn]
+    ) -> list[ConversationTurn]:
+        """Returns the turns that are kept, turns may be collapsed in place."""
+        raise NotImplementedError()
+
+
+class FullMemory(ConversationMemory):
+    """Keeps the whole conversation."""
+
+    @override
+    def prune(
+        self, system: list[BaseMessage], turns: list[ConversationTurn]
+    ) -> list[ConversationTurn]:
+        return turns
+
+
+class LastTurnsMemory(ConversationMemory):
+    """Keeps the last turns, up to count of them before the current one."""
+
+    def __init__(self, count: int) -> None:
+        self.count: int = count
+
+    @override
+    def prune(
+        self, system: list[BaseMessage], turns: list[ConversationTurn]
+    ) -> list[ConversationTurn]:
+        return turns[-(self.count + 1) :]
+
+
+class SummaryMemory(ConversationMemory):
+    """Keeps the last turns, up to count of them before the current one, in
+    full. Older turns are collapsed to their summary, which holds the diff of
+    the attempt rather than the code and verifier output it was shown."""
+
+    def __init__(self, count: int) -> None:
+        self.count: int = count
+
+    @override
+    def prune(
+        self, system: list[BaseMessage], turns: list[ConversationTurn]
+    ) -> list[ConversationTurn]:
+        for turn in turns[: -(self.count + 1)]:
+            turn.collapse()
+        return turns
+
+
+class TokenBudgetMemory(ConversationMemory):
+    """Applies another memory, then evicts the oldest turns until the
+    conversation fits in the token budget. The current turn is kept even if it
+    doesn't fit on its own."""
+
+    def __init__(
+        self,
+        memory: ConversationMemory,
+        budget: int,
+        count_tokens: Callable[[str], int],
+    ) -> None:
+        self.memory: ConversationMemory = memory
+        self.budget: int = budget
+        self.count_tokens: Callable[[str], int] = count_tokens
+        self._logger = get_logger().bind(category=LogCategories.CHAT)
+
+    def _tokens(self, messages: list[BaseMessage]) -> int:
+        return sum(self.count_tokens(message.text) for message in messages)
+
+    @override
+    def prune(
+        self, system: list[BaseMessage], turns: list[ConversationTurn]
+    ) -> list[ConversationTurn]:
+        turns = self.memory.prune(system, turns)
+        counts: list[int] = [self._tokens(turn.messages) for turn in turns]
+        total: int = self._tokens(system) + sum(counts)
+        evicted: int = 0
+        while total > self.budget and evicted < len(turns) - 1:
+            total -= counts[evicted]
+            evicted += 1
+
+        if evicted:
+            self._logger.debug(f"Evicted {evicted} turns to fit the token budget")
+        if total > self.budget:
+            self._logger.warn(
+                f"The prompt has {total} tokens, over the budget of {self.budget}"
+            )
+        return turns[evicted:]
+
+
+def create_memory(
+    strategy: MemoryStrategy,
+    turns: int,
+    token_budget: int | None = None,
+    count_tokens: Callable[[str], int] | None = None,
+) -> ConversationMemory:
+    """Creates the memory of a strategy. turns is the number of previous turns
+    kept in full. If token_budget is set, count_tokens is used to measure the
+    conversation."""
+    memory: ConversationMemory
+    if strategy == "full":
+        memory = FullMemory()
+    elif strategy == "last_turns":
+        memory = LastTurnsMemory(turns)
+    elif strategy == "summarize":
+        memory = SummaryMemory(turns)
+    else:
+        raise ValueError(f"Unknown memory strategy: {strategy}")
+
+    if token_budget is not None:
+        assert count_tokens is not None, "count_tokens is needed for a budget"
+        memory = TokenBudgetMemory(memory, token_budget, count_tokens)
+    return memory
@@ -2,41 +2,202 @@
 
 """Contains code for automatically repairing code using ESBMC."""
 
+import asyncio
+from time import perf_counter
+from typing import AsyncIterator, Callable, Literal
+
 from langchain_core.prompts import PromptTemplate
-from langchain_core.messages import BaseMessage
+from langchain_core.messages import AIMessage, BaseMessage
 from langchain_core.language_models import BaseChatModel
+from structlog.stdlib import get_logger
 
-from esbmc_ai.solution import Solution
+from esbmc_ai.ai_models import AIModel, TokenUsage
+from esbmc_ai.solution import Solution, SolutionPatchResult, SourceFile
+from esbmc_ai.chats.conversation_memory import (
+    ConversationMemory,
+    ConversationTurn,
+    FullMemory,
+)
 from esbmc_ai.chats.template_key_provider import (
     OracleTemplateKeyProvider,
     TemplateKeyProvider,
 )
 from esbmc_ai.verifier_output import VerifierOutput
 from esbmc_ai.chats import KeyTemplateRenderer
+from esbmc_ai.log_categories import LogCategories
+from esbmc_ai.unified_diff import PatchParseError, unified_diff
+
+OutputMode = Literal["full", "diff"]
+
+
+class CodeFenceExtractor:
+    """Finds the first fenced code block of a response while it streams in, so
+    that the code can be used as soon as the closing fence arrives."""
+
+    def __init__(self) -> None:
+        self._partial_line: str = ""
+        self._lines: list[str] | None = None
+        """Lines of the code block, None until the opening fence is found."""
+        self.code: str | None = None
+        """The code of the block once it is closed."""
+
+    def _read_line(self, line: str) -> None:
+        if self._lines is None:
+            if line.lstrip().startswith("```"):
+                self._lines = []
+        elif line.strip() == "```":
+            self.code = "\n".join(self._lines)
+        else:
+            self._lines.append(line)
+
+    def feed(self, text: str) -> str | None:
+        """Reads the next part of the response. Returns the code when this
+        part closes the code block, None otherwise."""
+        if self.code is not None:
+            return None
+        lines: list[str] = (self._partial_line + text).split("\n")
+        self._partial_line = lines.pop()
+        for line in lines:
+            self._read_line(line)
+            if self.code is not None:
+                return self.code
+        return None
+
+    def finish(self) -> str | None:
+        """Reads the end of the response, which can close the code block
+        without a new line. Returns the code if this closes the block."""
+        if self.code is not None or not self._partial_line:
+            return None
+        self._read_line(self._partial_line)
+        self._partial_line = ""
+        return self.code
+
+
+class SolutionCandidates:
+    """The candidate repairs sampled for one prompt by generate_solutions.
+    None of the responses is in the message history until the caller picks
+    the candidate the conversation continues with, by calling complete_turn
+    before the next prompt."""
+
+    def __init__(
+        self,
+        generator: "SolutionGenerator",
+        turn: ConversationTurn,
+        responses: list[BaseMessage],
+        solution: Solution,
+        verifier_output: VerifierOutput,
+    ) -> None:
+        self._generator: "SolutionGenerator" = generator
+        self._turn: ConversationTurn = turn
+        self._responses: list[BaseMessage] = responses
+        self._solution: Solution = solution
+        self._verifier_output: VerifierOutput = verifier_output
+        self._completed: bool = False
+        self.codes: list[str] = [
+            SolutionGenerator.extract_code_from_solution(response.text)
+            for response in responses
+        ]
+        """The extracted code of each candidate, in the order they were
+        requested."""
+
+    def complete_turn(self, index: int) -> None:
+        """Adds the response of the candidate at index to the message history.
+        The verifier output of this candidate is the one to feed back when
+        retrying."""
+        assert not self._completed, "The turn is already completed"
+        self._completed = True
+        self._generator._complete_turn(
+            self._turn,
+            self._responses[index],
+            self._solution,
+            self._verifier_output,
+            self.codes[index],
+        )
 
 
 class SolutionGenerator:
     """SolutionGenerator is a simple conversation-based automated program repair
     class. It maintains a conversation with the LLM, starting with a system message
     (provided at initialization) and then adding repair attempt messages via
-    generate_solution calls."""
+    generate_solution calls.
+
+    Each repair attempt is a turn of the conversation, the memory decides which
+    turns are kept before every call to the LLM, so that the prompt doesn't
+    grow with every attempt.
+
+    With prompt_cache, the conversation is laid out so that the provider can
+    cache its prefix: the first turn, which holds the original source code, is
+    pinned after the system messages and is never pruned by the memory. The
+    end of the pinned prefix and the end of the previous turn are marked with
+    cache_control for the providers that need markers."""
 
     def __init__(
         self,
         ai_model: BaseChatModel,
         esbmc_output_type: str = "full",
         system_message: list[BaseMessage] | None = None,
+        memory: ConversationMemory | None = None,
+        prompt_cache: bool = False,
     ) -> None:
-        """Initializes the solution generator."""
+        """Initializes the solution generator. The whole conversation is kept
+        if no memory is given."""
         super().__init__()
 
         self.ai_model: BaseChatModel = ai_model
         self.template_key_provider: TemplateKeyProvider = OracleTemplateKeyProvider()
-        self.messages: list[BaseMessage] = system_message or []
+        self.system_messages: list[BaseMessage] = system_message or []
+        self.turns: list[ConversationTurn] = []
+        self.memory: ConversationMemory = memory or FullMemory()
+        self.attempts: int = 0
+        self.prompt_cache: bool = prompt_cache
+        self.token_usage: TokenUsage = TokenUsage()
+        """Tokens used by all the LLM calls."""
+        self._logger = get_logger().bind(category=LogCategories.CHAT)
 
         self.esbmc_output_type: str = esbmc_output_type
 
         self.invokations: int = 0
+        self.diff_fallbacks: int = 0
+        """Number of diffs that could not be applied, see
+        generate_diff_solution."""
+
+    @property
+    def messages(self) -> list[BaseMessage]:
+        """The conversation sent to the LLM: the system messages followed by
+        the turns kept by the memory."""
+        return self.system_messages + [
+            message for turn in self.turns for message in turn.messages
+        ]
+
+    def _request(self) -> list[BaseMessage]:
+        """The messages sent to the LLM, with the cache markers if the model
+        needs them."""
+        messages: list[BaseMessage] = self.messages
+        if not self.prompt_cache or not AIModel.supports_cache_control(
+            self.ai_model
+        ):
+            return messages
+
+        # The last message of the system messages, of the pinned first turn
+        # and of the turn before the current one.
+        breakpoints: set[int] = set()
+        end: int = len(self.system_messages)
+        if end:
+            breakpoints.add(end - 1)
+        for turn in self.turns[:-1]:
+            end += len(turn.messages)
+            if turn is self.turns[0] or turn is self.turns[-2]:
+                breakpoints.add(end - 1)
+        return [
+            AIModel.with_cache_control(message) if idx in breakpoints else message
+            for idx, message in enumerate(messages)
+        ]
+
+    def _record_usage(self, responses: list[BaseMessage]) -> None:
+        for response in responses:
+            usage: TokenUsage | None = TokenUsage.from_message(response)
+            if usage is not None:
+                self.token_usage.add(usage)
 
     @staticmethod
     def extract_code_from_solution(solution: str) -> str:
@@ -64,15 +225,39 @@ class SolutionGenerator:
             pass
         return solution
 
-    def generate_solution(
+    @staticmethod
+    def apply_diff_solution(solution: Solution, response: str) -> str | None:
+        """Applies the unified diff in the code block of a response to the first
+        file of the solution, without changing the solution. Returns the
+        patched code, or None if the diff is malformed, doesn't change the file
+        or any of its hunks can't be applied."""
+        source_file: SourceFile = solution.files[0]
+        patch: str = SolutionGenerator.extract_code_from_solution(response)
+        # The code block loses the new line of the last line of the diff.
+        if not patch.endswith("\n"):
+            patch += "\n"
+
+        candidate: Solution = Solution([])
+        candidate.add_source_file(
+            SourceFile(file_path=source_file.file_path, content=source_file.content)
+        )
+        try:
+            result: SolutionPatchResult = candidate.patch_solution(patch)
+        except PatchParseError:
+            return None
+        # A diff with no hunks for the file is rejected too.
+        if not result.applied or not result.files.get(source_file.file_path):
+            return None
+        return candidate.files[0].content
+
+    def _push_prompt(
         self,
         initial_message_prompt: PromptTemplate,
         solution: Solution,
         verifier_output: VerifierOutput,
-    ) -> str:
-        """Prompts the LLM to repair the source code using the verifier output.
-        Returns the extracted code from the LLM's response."""
-
+    ) -> ConversationTurn:
+        """Renders the repair prompt into a new turn, and prunes the
+        conversation with the memory."""
         # Add the initial message for this repair attempt
         # Pass the template string to KeyTemplateRenderer which will handle formatting
         key_template_renderer: KeyTemplateRenderer = KeyTemplateRenderer(
@@ -85,16 +270,287 @@ class SolutionGenerator:
             solution=solution,
             oracle_output=verifier_output,
         )
-        self.messages.extend(formatted_messages)
+        turn: ConversationTurn = ConversationTurn(messages=list(formatted_messages))
+        self.turns.append(turn)
+        if self.prompt_cache and len(self.turns) > 1:
+            # The first turn is part of the cached prefix.
+            pinned: ConversationTurn = self.turns[0]
+            self.turns = [pinned] + self.memory.prune(
+                self.system_messages + pinned.messages, self.turns[1:]
+            )
+        else:
+            self.turns = self.memory.prune(self.system_messages, self.turns)
+        return turn
+
+    def _complete_turn(
+        self,
+        turn: ConversationTurn,
+        response: BaseMessage,
+        solution: Solution,
+        verifier_output: VerifierOutput,
+        repaired_code: str,
+    ) -> None:
+        """Adds the response to the turn, along with the summary the turn is
+        collapsed to by memories that summarize: the error that was shown and
+        the diff of the repair, which is much shorter than the prompt."""
+        self.attempts += 1
+        turn.messages.append(response)
+
+        summary: str = f"Repair attempt {self.attempts}"
+        if verifier_output.issues:
+            summary += (
+                f" for {verifier_output.error_type} at "
+                f"{verifier_output.error_file}:{verifier_output.error_line}"
+            )
+        source_file = solution.files[0]
+        diff: str = unified_diff(
+            source_file.content,
+            repaired_code,
+            f"a/{source_file.file_path.name}",
+            f"b/{source_file.file_path.name}",
+        )
+        if diff:
+            summary += f" made these changes:\n\n```diff\n{diff}```"
+        else:
+            summary += " made no changes."
+        turn.summary = summary
+
+    def generate_solution(
+        self,
+        initial_message_prompt: PromptTemplate,
+        solution: Solution,
+        verifier_output: VerifierOutput,
+    ) -> str:
+        """Prompts the LLM to repair the source code using the verifier output.
+        Returns the extracted code from the LLM's response."""
+
+        turn: ConversationTurn = self._push_prompt(
+            initial_message_prompt, solution, verifier_output
+        )
 
         self.invokations += 1
 
         # Generate the solution
-        response: BaseMessage = self.ai_model.invoke(self.messages)
+        response: BaseMessage = self.ai_model.invoke(self._request())
+        self._record_usage([response])
+
+        repaired_code = SolutionGenerator.extract_code_from_solution(response.text)
 
         # Add AI response to message history for conversation context
-        self.messages.append(response)
+        self._complete_turn(turn, response, solution, verifier_output, repaired_code)
+
+        return repaired_code
+
+    def generate_diff_solution(
+        self,
+        diff_prompt: PromptTemplate,
+        fallback_prompt: PromptTemplate,
+        solution: Solution,
+        verifier_output: VerifierOutput,
+    ) -> str:
+        """Like generate_solution, but diff_prompt asks the LLM for a unified
+        diff of the first file of the solution rather than the whole file, so
+        the output tokens don't grow with the size of the file. Returns the
+        patched code.
+
+        If the diff can't be applied, the LLM is asked for the whole file with
+        fallback_prompt in a new turn."""
+        turn: ConversationTurn = self._push_prompt(
+            diff_prompt, solution, verifier_output
+        )
+
+        self.invokations += 1
+
+        response: BaseMessage = self.ai_model.invoke(self._request())
+        self._record_usage([response])
+
+        repaired_code: str | None = SolutionGenerator.apply_diff_solution(
+            solution, response.text
+        )
+        if repaired_code is not None:
+            self._complete_turn(
+                turn, response, solution, verifier_output, repaired_code
+            )
+            return repaired_code
+
+        self.diff_fallbacks += 1
+        self._logger.warn("The diff could not be applied, asking for the file")
+        # The fallback continues the same attempt, which is counted when the
+        # fallback turn is completed.
+        turn.messages.append(response)
+        turn.summary = (
+            f"Repair attempt {self.attempts + 1} gave a diff that could not be "
+            "applied."
+        )
+        return self.generate_solution(fallback_prompt, solution, verifier_output)
+
+    def generate_solutions(
+        self,
+        initial_message_prompt: PromptTemplate,
+        solution: Solution,
+        verifier_output: VerifierOutput,
+        count: int,
+    ) -> SolutionCandidates:
+        """Samples count candidate repairs for the same prompt in a single
+        batched request.
+
+        Only one candidate's response is added to the message history, so the
+        conversation stays linear: the caller picks it with
+        SolutionCandidates.complete_turn, and feeds back its verifier output
+        when retrying."""
+        assert count >= 1, "count needs to be at least 1"
+
+        turn: ConversationTurn = self._push_prompt(
+            initial_message_prompt, solution, verifier_output
+        )
+
+        self.invokations += count
+
+        # Each batch input is the same conversation, the LLM samples them
+        # independently (and concurrently when the provider allows it).
+        request: list[BaseMessage] = self._request()
+        responses: list[BaseMessage] = self.ai_model.batch(
+            [list(request) for _ in range(count)]
+        )
+        self._record_usage(responses)
+        return SolutionCandidates(self, turn, responses, solution, verifier_output)
+
+    async def agenerate_solution(
+        self,
+        initial_message_prompt: PromptTemplate,
+        solution: Solution,
+        verifier_output: VerifierOutput,
+    ) -> str:
+        """Async version of generate_solution, the event loop is free to run
+        other tasks (such as verifications) while the LLM responds."""
+        turn: ConversationTurn = self._push_prompt(
+            initial_message_prompt, solution, verifier_output
+        )
+
+        self.invokations += 1
+
+        response: BaseMessage = await self.ai_model.ainvoke(self._request())
+        self._record_usage([response])
 
         repaired_code = SolutionGenerator.extract_code_from_solution(response.text)
+        self._complete_turn(turn, response, solution, verifier_output, repaired_code)
+        return repaired_code
+
+    async def agenerate_solutions(
+        self,
+        initial_message_prompt: PromptTemplate,
+        solution: Solution,
+        verifier_output: VerifierOutput,
+        count: int,
+    ) -> SolutionCandidates:
+        """Async version of generate_solutions."""
+        assert count >= 1, "count needs to be at least 1"
+
+        turn: ConversationTurn = self._push_prompt(
+            initial_message_prompt, solution, verifier_output
+        )
+
+        self.invokations += count
+
+        request: list[BaseMessage] = self._request()
+        responses: list[BaseMessage] = await self.ai_model.abatch(
+            [list(request) for _ in range(count)]
+        )
+        self._record_usage(responses)
+        return SolutionCandidates(self, turn, responses, solution, verifier_output)
+
+    async def aiter_solutions(
+        self,
+        initial_message_prompt: PromptTemplate,
+        solution: Solution,
+        verifier_output: VerifierOutput,
+        count: int,
+    ) -> AsyncIterator[tuple[int, str]]:
+        """Samples count candidate repairs for the same prompt with concurrent
+        requests, and yields the index and extracted code of each candidate as
+        soon as its response arrives, so that it can be verified while the
+        other requests are still running. The requests go through the rate
+        limiter of the model.
+
+        Only the first candidate's response is added to the message history.
+        The requests that are still running are cancelled if the iteration is
+        stopped."""
+        assert count >= 1, "count needs to be at least 1"
+
+        turn: ConversationTurn = self._push_prompt(
+            initial_message_prompt, solution, verifier_output
+        )
+
+        self.invokations += count
 
+        request: list[BaseMessage] = self._request()
+
+        async def sample(idx: int) -> tuple[int, BaseMessage]:
+            return idx, await self.ai_model.ainvoke(list(request))
+
+        tasks: list[asyncio.Task[tuple[int, BaseMessage]]] = [
+            asyncio.create_task(sample(idx)) for idx in range(count)
+        ]
+        try:
+            for next_response in asyncio.as_completed(tasks):
+                idx, response = await next_response
+                self._record_usage([response])
+                code: str = SolutionGenerator.extract_code_from_solution(
+                    response.text
+                )
+                if idx == 0:
+                    self._complete_turn(
+                        turn, response, solution, verifier_output, code
+                    )
+                yield idx, code
+        finally:
+            for task in tasks:
+                task.cancel()
+
+    def stream_solution(
+        self,
+        initial_message_prompt: PromptTemplate,
+        solution: Solution,
+        verifier_output: VerifierOutput,
+        on_code: Callable[[str], None] | None = None,
+    ) -> str:
+        """Like generate_solution, but the response is streamed: on_code is
+        called with the code as soon as the closing fence of its code block
+        arrives, while the rest of the response (such as trailing prose) is
+        still being received. The code that is returned is extracted from the
+        whole response like generate_solution does, which is almost always
+        the same code.
+
+        The time to the first chunk and to the code are logged."""
+        turn: ConversationTurn = self._push_prompt(
+            initial_message_prompt, solution, verifier_output
+        )
+
+        self.invokations += 1
+
+        start: float = perf_counter()
+        extractor: CodeFenceExtractor = CodeFenceExtractor()
+        response: BaseMessage | None = None
+        for chunk in self.ai_model.stream(self._request()):
+            if response is None:
+                self._logger.info(f"First chunk after {perf_counter() - start:.2f}s")
+                response = chunk
+            else:
+                response += chunk  # type: ignore[operator]
+            code: str | None = extractor.feed(chunk.text)
+            if code is not None:
+                self._logger.info(f"Code block after {perf_counter() - start:.2f}s")
+                if on_code is not None:
+                    on_code(code)
+        if response is None:
+            response = AIMessage(content="")
+        code = extractor.finish()
+        if code is not None:
+            self._logger.info(f"Code block after {perf_counter() - start:.2f}s")
+            if on_code is not None:
+                on_code(code)
+        self._record_usage([response])
+
+        repaired_code = SolutionGenerator.extract_code_from_solution(response.text)
+        self._complete_turn(turn, response, solution, verifier_output, repaired_code)
         return repaired_code
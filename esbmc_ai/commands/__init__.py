@@ -7,6 +7,7 @@ from .help_config import HelpConfigCommand
 from .fix_code_command import FixCodeCommand
 from .debug_config import DebugConfigViewCommand
 from .license_command import LicenseCommand
+from .cache_command import CacheStatsCommand, CachePruneCommand
 
 __all__ = [
     "ExitCommand",
@@ -15,4 +16,6 @@ __all__ = [
     "FixCodeCommand",
     "DebugConfigViewCommand",
     "LicenseCommand",
+    "CacheStatsCommand",
+    "CachePruneCommand",
 ]
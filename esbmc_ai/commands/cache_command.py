@@ -0,0 +1,113 @@
+# Author: Yiannis Charalambous
+
+"""Contains the commands that inspect and maintain the verifier cache."""
+
+from typing_extensions import override
+
+from esbmc_ai.cache import BaseCache, CacheStats
+from esbmc_ai.chat_command import ChatCommand
+from esbmc_ai.command_result import CommandResult
+from esbmc_ai.component_manager import ComponentManager
+
+
+def _format_bytes(size: int) -> str:
+    if size < 1024:
+        return f"{size} B"
+    value: float = size / 1024
+    for unit in ["KiB", "MiB", "GiB"]:
+        if value < 1024:
+            return f"{value:.1f} {unit}"
+        value /= 1024
+    return f"{value:.1f} TiB"
+
+
+class CacheStatsCommandResult(CommandResult):
+    """Returned by the CacheStatsCommand."""
+
+    entries: int
+    total_bytes: int
+    max_bytes: int | None
+    hits: int
+    misses: int
+    hit_rate: float
+    versions: dict[str, int]
+
+    @override
+    def __str__(self) -> str:
+        budget: str = (
+            _format_bytes(self.max_bytes) if self.max_bytes is not None else "unbounded"
+        )
+        lines: list[str] = [
+            f"Entries: {self.entries}",
+            f"Size: {_format_bytes(self.total_bytes)} / {budget}",
+            f"Hits: {self.hits}",
+            f"Misses: {self.misses}",
+            f"Hit rate: {self.hit_rate:.1%}",
+        ]
+        if self.versions:
+            lines.append("Entries by verifier version:")
+            lines.extend(
+                f"\t* {version or '<unknown>'}: {count}"
+                for version, count in self.versions.items()
+            )
+        return "\n".join(lines)
+
+
+class CachePruneCommandResult(CommandResult):
+    """Returned by the CachePruneCommand."""
+
+    removed: int
+    freed_bytes: int
+
+    @override
+    def __str__(self) -> str:
+        return (
+            f"Removed {self.removed} entries, "
+            f"freed {_format_bytes(self.freed_bytes)}"
+        )
+
+
+class CacheStatsCommand(ChatCommand):
+    """Shows the size and hit rate of the cache of the selected verifier."""
+
+    def __init__(self) -> None:
+        super().__init__(
+            command_name="cache-stats",
+            help_message="Show the size and hit rate of the verifier cache.",
+        )
+
+    @override
+    def execute(self) -> CacheStatsCommandResult:
+        cache: BaseCache = ComponentManager().verifier.cache
+        stats: CacheStats = cache.stats()
+        return CacheStatsCommandResult(
+            successful=True,
+            entries=stats.entries,
+            total_bytes=stats.total_bytes,
+            max_bytes=stats.max_bytes,
+            hits=stats.hits,
+            misses=stats.misses,
+            hit_rate=stats.hit_rate,
+            versions=stats.versions,
+        )
+
+
+class CachePruneCommand(ChatCommand):
+    """Evicts the least recently used entries of the verifier cache until it
+    fits in verifier.cache_max_size, and removes stale entries."""
+
+    def __init__(self) -> None:
+        super().__init__(
+            command_name="cache-prune",
+            help_message="Evict verifier cache entries over the size budget "
+            "(verifier.cache_max_size) and remove stale entries.",
+        )
+
+    @override
+    def execute(self) -> CachePruneCommandResult:
+        cache: BaseCache = ComponentManager().verifier.cache
+        removed, freed = cache.prune()
+        self.logger.info(f"Pruned {removed} cache entries")
+        return CachePruneCommandResult(
+            successful=True, removed=removed, freed_bytes=freed
+        )
@@ -1,7 +1,11 @@
 # Author: Yiannis Charalambous
 
+import asyncio
+from concurrent.futures import Future, as_completed
 from enum import Enum
 from pathlib import Path
+from threading import Event
+from time import perf_counter
 from typing import Any
 from pydantic import Field, field_validator
 from typing_extensions import override
@@ -11,13 +15,23 @@ from langchain_core.messages import BaseMessage, SystemMessage, HumanMessage, AI
 from esbmc_ai.base_component import BaseComponentConfig
 from esbmc_ai.component_manager import ComponentManager
 from esbmc_ai.solution import Solution, SourceFile
-from esbmc_ai.ai_models import AIModel
-from esbmc_ai.chats.solution_generator import SolutionGenerator
+from esbmc_ai.solution_workspace import SolutionWorkspace
+from esbmc_ai.ai_models import AIModel, TokenUsage
+from esbmc_ai.chats.conversation_memory import MemoryStrategy, create_memory
+from esbmc_ai.chats.solution_generator import (
+    OutputMode,
+    SolutionCandidates,
+    SolutionGenerator,
+)
 from esbmc_ai.command_result import CommandResult
 from esbmc_ai.verifier_output import VerifierOutput
 from esbmc_ai.chat_command import ChatCommand
 from esbmc_ai.loading_widget import BaseLoadingWidget, LoadingWidget
-from esbmc_ai.verifiers.base_source_verifier import BaseSourceVerifier
+from esbmc_ai.verifiers.base_source_verifier import (
+    BaseSourceVerifier,
+    VerifierCancelledException,
+)
+from esbmc_ai.verifiers.verifier_service import VerifierService
 from esbmc_ai.verifiers.esbmc import ESBMCOutput
 
 
@@ -28,10 +42,16 @@ class FixCodeCommandResult(CommandResult):
         successful: Whether the repair was successful
         attempts: Number of repair attempts made
         repaired_source: The repaired source code or None if repair failed
+        token_usage: The tokens used by the LLM calls, None if the LLM was not
+            called
+        diff_fallbacks: Number of diffs that could not be applied, for which
+            the whole file was requested
     """
 
     attempts: int
     repaired_source: str | None = None
+    token_usage: TokenUsage | None = None
+    diff_fallbacks: int = 0
 
     @override
     def __str__(self) -> str:
@@ -62,6 +82,86 @@ class FixCodeCommandConfig(BaseComponentConfig):
         description="Fix code command max attempts.",
     )
 
+    candidates: int = Field(
+        default=1,
+        ge=1,
+        description="Number of candidate repairs sampled from the LLM per "
+        "attempt. When greater than 1, the candidates are verified "
+        "concurrently and the first one that verifies is accepted, the "
+        "remaining verifier processes are cancelled. Use a temperature above "
+        "0, otherwise the candidates will be identical.",
+    )
+
+    pipeline: bool = Field(
+        default=False,
+        description="Run the repair loop with asyncio so that the LLM requests "
+        "overlap with verification: the candidates of an attempt are requested "
+        "concurrently and each one is verified as soon as it arrives, the next "
+        "attempt is requested as soon as the first candidate fails while the "
+        "other candidates are still being verified. Needs candidates greater "
+        "than 1 for the attempts to overlap.",
+    )
+
+    stream: bool = Field(
+        default=False,
+        description="Stream the response of the LLM and start verifying the "
+        "repaired code as soon as its code block is closed, without waiting "
+        "for the rest of the response. The time to the first chunk, to the "
+        "code and to the verification result are logged. Used when candidates "
+        "is 1.",
+    )
+
+    output_mode: OutputMode = Field(
+        default="full",
+        description="What the LLM is asked to output for each attempt. full "
+        "asks for the whole fixed file, diff asks for a unified diff of the "
+        "file (with diff_initial and diff_retry_prompt), which takes far fewer "
+        "output tokens on large files. If the diff can't be applied, the whole "
+        "file is requested with diff_fallback_prompt. diff is used when "
+        "candidates is 1 and stream and pipeline are off.",
+    )
+
+    max_workers: int | None = Field(
+        default=None,
+        ge=1,
+        description="Maximum number of verifier processes that run at the "
+        "same time when candidates is greater than 1. Defaults to the number "
+        "of candidates.",
+    )
+
+    memory: MemoryStrategy = Field(
+        default="full",
+        description="What is kept of the previous attempts in the "
+        "conversation. full keeps everything, last_turns keeps the last "
+        "memory_turns attempts and drops the older ones, summarize keeps the "
+        "last memory_turns attempts and collapses the older ones to the diff "
+        "they made.",
+    )
+
+    memory_turns: int = Field(
+        default=2,
+        ge=0,
+        description="Number of previous attempts kept in full by the "
+        "last_turns and summarize memory strategies.",
+    )
+
+    prompt_cache: bool = Field(
+        default=False,
+        description="Lay out the conversation so that the provider can cache "
+        "the prompt prefix shared by the attempts: the first attempt, with the "
+        "original source code, is kept right after the system messages and is "
+        "never pruned. Adds cache_control markers for the providers that need "
+        "them (Anthropic), the cached tokens are reported in the result.",
+    )
+
+    memory_token_budget: int | None = Field(
+        default=None,
+        ge=1,
+        description="Maximum number of tokens of the conversation sent to the "
+        "LLM, the oldest attempts are evicted first to fit it. The current "
+        "attempt is always sent. Leave empty for no budget.",
+    )
+
     initial: str = Field(
         default="ESBMC found an error in the code:\n\nError Type: {{oracle_output.error_type}}\nError Message: {{oracle_output.error_message}}\nError Location: {{oracle_output.error_file}}:{{oracle_output.error_line}}\n\nStack Trace:\n{{oracle_output.primary_issue.stack_trace_formatted}}\n\n{% if is_verifier_issue(oracle_output.primary_issue) and oracle_output.primary_issue.counterexample | length > 0 %}Counterexample:\n{{oracle_output.primary_issue.counterexample_formatted}}\n\n{% endif %}The source code is:\n\n```c\n{{solution.files[0].content}}\n```\n\nUsing the error information above, show the fixed text.",
         description="Initial prompt for the first repair attempt. Uses structured oracle output fields.",
@@ -72,6 +172,21 @@ class FixCodeCommandConfig(BaseComponentConfig):
         description="Prompt used for retry attempts after the initial attempt fails. Uses structured oracle output fields and can reference conversation history.",
     )
 
+    diff_initial: str = Field(
+        default="ESBMC found an error in the code:\n\nError Type: {{oracle_output.error_type}}\nError Message: {{oracle_output.error_message}}\nError Location: {{oracle_output.error_file}}:{{oracle_output.error_line}}\n\nStack Trace:\n{{oracle_output.primary_issue.stack_trace_formatted}}\n\n{% if is_verifier_issue(oracle_output.primary_issue) and oracle_output.primary_issue.counterexample | length > 0 %}Counterexample:\n{{oracle_output.primary_issue.counterexample_formatted}}\n\n{% endif %}The source code of {{solution.files[0].file_path.name}} is:\n\n```c\n{{solution.files[0].content}}\n```\n\nUsing the error information above, show the fix as a unified diff in a ```diff code block, with the headers --- a/{{solution.files[0].file_path.name}} and +++ b/{{solution.files[0].file_path.name}}. Give each hunk 3 lines of context and line counts that match its lines. Do not show the whole file.",
+        description="Initial prompt for the first repair attempt when output_mode is diff.",
+    )
+
+    diff_retry_prompt: str = Field(
+        default="The previous attempt failed. ESBMC found an error:\n\nError Type: {{oracle_output.error_type}}\nError Message: {{oracle_output.error_message}}\nError Location: {{oracle_output.error_file}}:{{oracle_output.error_line}}\n\nStack Trace:\n{{oracle_output.primary_issue.stack_trace_formatted}}\n\n{% if is_verifier_issue(oracle_output.primary_issue) and oracle_output.primary_issue.counterexample | length > 0 %}Counterexample:\n{{oracle_output.primary_issue.counterexample_formatted}}\n\n{% endif %}The source code of {{solution.files[0].file_path.name}} is now:\n\n```c\n{{solution.files[0].content}}\n```\n\nPlease review the conversation history to see what was tried before. Using the error information above and learning from previous failed attempts, show the fix as a unified diff of the source code above in a ```diff code block, with the headers --- a/{{solution.files[0].file_path.name}} and +++ b/{{solution.files[0].file_path.name}}. Give each hunk 3 lines of context and line counts that match its lines. Do not show the whole file.",
+        description="Prompt used for retry attempts when output_mode is diff.",
+    )
+
+    diff_fallback_prompt: str = Field(
+        default="The diff could not be applied to the source code:\n\n```c\n{{solution.files[0].content}}\n```\n\nShow the whole fixed text instead of a diff.",
+        description="Prompt used when output_mode is diff and the diff of the LLM could not be applied, asks for the whole fixed file.",
+    )
+
     system: list[dict[str, str]] = [
         {
             "role": "system",
@@ -185,40 +300,127 @@ class FixCodeCommand(ChatCommand):
             input_variables=[],
             template_format="jinja2",
         )
+        # Asks for the whole file when the diff of the LLM can't be applied,
+        # None unless the diff output mode is used.
+        fallback_prompt: PromptTemplate | None = None
+        if self._config.output_mode == "diff":
+            if (
+                self._config.candidates > 1
+                or self._config.stream
+                or self._config.pipeline
+            ):
+                self.logger.warn(
+                    "The diff output mode is only used when candidates is 1 "
+                    "and stream and pipeline are off, asking for the whole file"
+                )
+            else:
+                initial_prompt = PromptTemplate(
+                    template=self._config.diff_initial,
+                    input_variables=[],
+                    template_format="jinja2",
+                )
+                retry_prompt = PromptTemplate(
+                    template=self._config.diff_retry_prompt,
+                    input_variables=[],
+                    template_format="jinja2",
+                )
+                fallback_prompt = PromptTemplate(
+                    template=self._config.diff_fallback_prompt,
+                    input_variables=[],
+                    template_format="jinja2",
+                )
 
         solution_generator: SolutionGenerator = SolutionGenerator(
             ai_model=ai_model,
             system_message=system_messages,
             esbmc_output_type=self._config.verifier_output_type,
+            memory=create_memory(
+                strategy=self._config.memory,
+                turns=self._config.memory_turns,
+                token_budget=self._config.memory_token_budget,
+                count_tokens=ai_model.get_num_tokens,
+            ),
+            prompt_cache=self._config.prompt_cache,
         )
 
         print()
 
-        for attempt in range(1, self._config.max_attempts + 1):
-            # Use initial prompt for first attempt, retry prompt for subsequent attempts
-            prompt = initial_prompt if attempt == 1 else retry_prompt
+        # Attempts are verified in an overlay of the solution on disk, so only
+        # the files the LLM modified are written for each attempt.
+        with SolutionWorkspace(
+            solution,
+            temp_dir=self.global_config.temp_file_dir,
+            auto_clean=self.global_config.temp_auto_clean,
+        ) as workspace:
+            result: FixCodeCommandResult | None = None
+            if self._config.pipeline:
+                result = asyncio.run(
+                    self._pipelined_repair(
+                        solution_generator=solution_generator,
+                        initial_prompt=initial_prompt,
+                        retry_prompt=retry_prompt,
+                        verifier=verifier,
+                        solution=solution,
+                        verifier_output=verifier_output,
+                        workspace=workspace,
+                    )
+                )
+            else:
+                for attempt in range(1, self._config.max_attempts + 1):
+                    # Use initial prompt for first attempt, retry prompt for
+                    # subsequent attempts
+                    prompt = initial_prompt if attempt == 1 else retry_prompt
+
+                    if self._config.candidates > 1:
+                        result, verifier_output = self._attempt_parallel_repair(
+                            attempt=attempt,
+                            solution_generator=solution_generator,
+                            prompt=prompt,
+                            verifier=verifier,
+                            solution=solution,
+                            verifier_output=verifier_output,
+                            workspace=workspace,
+                        )
+                    elif self._config.stream:
+                        result, verifier_output = self._attempt_streamed_repair(
+                            attempt=attempt,
+                            solution_generator=solution_generator,
+                            prompt=prompt,
+                            verifier=verifier,
+                            solution=solution,
+                            verifier_output=verifier_output,
+                            workspace=workspace,
+                        )
+                    else:
+                        result, verifier_output = self._attempt_repair(
+                            attempt=attempt,
+                            solution_generator=solution_generator,
+                            prompt=prompt,
+                            fallback_prompt=fallback_prompt,
+                            verifier=verifier,
+                            solution=solution,
+                            verifier_output=verifier_output,
+                            workspace=workspace,
+                        )
+                    if result:
+                        break
 
-            result: FixCodeCommandResult | None
-            result, verifier_output = self._attempt_repair(
-                attempt=attempt,
-                solution_generator=solution_generator,
-                prompt=prompt,
-                verifier=verifier,
-                solution=solution,
-                verifier_output=verifier_output,
-            )
             if result:
                 if self.global_config.generate_patches:
                     result.repaired_source = source_file.get_diff(
                         self.original_source_file
                     )
 
+                result.token_usage = solution_generator.token_usage
+                result.diff_fallbacks = solution_generator.diff_fallbacks
                 return result
 
         return FixCodeCommandResult(
             successful=False,
             attempts=self._config.max_attempts,
             repaired_source=None,
+            token_usage=solution_generator.token_usage,
+            diff_fallbacks=solution_generator.diff_fallbacks,
         )
 
     def _attempt_repair(
@@ -229,53 +431,359 @@ class FixCodeCommand(ChatCommand):
         solution: Solution,
         verifier: BaseSourceVerifier,
         verifier_output: VerifierOutput,
+        workspace: SolutionWorkspace,
+        fallback_prompt: PromptTemplate | None = None,
     ) -> tuple[FixCodeCommandResult | None, ESBMCOutput]:
+        """Repairs with a single response. If fallback_prompt is given, prompt
+        asks the LLM for a diff and fallback_prompt asks for the whole file
+        when the diff can't be applied."""
         source_file: SourceFile = solution.files[0]
 
         # Generate AI solution
         with self.anim("Generating Solution... Please Wait"):
-            llm_solution = solution_generator.generate_solution(
-                initial_message_prompt=prompt,
-                solution=solution,
-                verifier_output=verifier_output,
-            )
+            if fallback_prompt is not None:
+                llm_solution = solution_generator.generate_diff_solution(
+                    diff_prompt=prompt,
+                    fallback_prompt=fallback_prompt,
+                    solution=solution,
+                    verifier_output=verifier_output,
+                )
+            else:
+                llm_solution = solution_generator.generate_solution(
+                    initial_message_prompt=prompt,
+                    solution=solution,
+                    verifier_output=verifier_output,
+                )
 
             # Update the source file state
             source_file.content = llm_solution
 
-        solution = solution.save_temp()
-
         # Pass to ESBMC, a workaround is used where the file is saved
         # to a temporary location since ESBMC needs it in file format.
-        with self.anim("Verifying with ESBMC... Please Wait"):
-            verifier_output = verifier.verify_source(solution=solution)
+        with (
+            self.anim("Verifying with ESBMC... Please Wait"),
+            workspace.attempt(solution) as attempt_solution,
+        ):
+            verifier_output = verifier.verify_source(solution=attempt_solution)
             assert isinstance(verifier_output, ESBMCOutput)
 
         # Solution found
         if verifier_output.return_code == 0:
+            return self._on_repair_success(attempt, source_file), verifier_output
 
-            self.logger.info("Successfully verified code")
+        self._log_failure(attempt)
+        return None, verifier_output
 
-            # Check if an output directory is specified and save to it
-            if self.global_config.solution.output_dir:
-                output_path: Path = (
-                    self.global_config.solution.output_dir / source_file.file_path.name
+    def _attempt_streamed_repair(
+        self,
+        attempt: int,
+        solution_generator: SolutionGenerator,
+        prompt: PromptTemplate,
+        solution: Solution,
+        verifier: BaseSourceVerifier,
+        verifier_output: VerifierOutput,
+        workspace: SolutionWorkspace,
+    ) -> tuple[FixCodeCommandResult | None, VerifierOutput]:
+        """Streams the response of the LLM and starts verifying the code as
+        soon as its code block is closed, while the rest of the response is
+        still arriving. If the code extracted from the whole response differs,
+        the early verification is cancelled and the code is verified again."""
+        source_file: SourceFile = solution.files[0]
+        start: float = perf_counter()
+        verifications: dict[str, tuple[Future[VerifierOutput], Event]] = {}
+
+        with VerifierService.from_config(verifier, workers=1) as service:
+
+            def verify(code: str) -> Future[VerifierOutput]:
+                if code not in verifications:
+                    candidate: Solution = Solution(
+                        [], include_dirs=solution.include_dirs
+                    )
+                    candidate.add_source_file(
+                        SourceFile(file_path=source_file.file_path, content=code)
+                    )
+                    attempt_solution: Solution = workspace.materialize(candidate)
+                    cancel_event: Event = Event()
+                    future: Future[VerifierOutput] = service.submit(
+                        attempt_solution, cancel_event=cancel_event
+                    )
+                    future.add_done_callback(
+                        lambda _: workspace.release(attempt_solution)
+                    )
+                    verifications[code] = future, cancel_event
+                return verifications[code][0]
+
+            with self.anim("Generating Solution... Please Wait"):
+                llm_solution: str = solution_generator.stream_solution(
+                    initial_message_prompt=prompt,
+                    solution=solution,
+                    verifier_output=verifier_output,
+                    on_code=verify,
                 )
-                if self.global_config.generate_patches:
-                    output_path = output_path.parent / (output_path.name + ".patch")
-                    source_file.save_diff(output_path, self.original_source_file)
-                else:
-                    source_file.save_file(output_path)
-            return (
-                FixCodeCommandResult(
-                    successful=True,
-                    attempts=attempt,
-                    repaired_source=source_file.content,
-                ),
-                verifier_output,
+                source_file.content = llm_solution
+
+            for code, (future, cancel_event) in verifications.items():
+                if code != llm_solution:
+                    self.logger.info("Cancelling the early verification")
+                    future.cancel()
+                    cancel_event.set()
+
+            with self.anim("Verifying with ESBMC... Please Wait"):
+                verifier_output = verify(llm_solution).result()
+            self.logger.info(
+                f"Verified after {perf_counter() - start:.2f}s from the start of "
+                "the request"
+            )
+
+        if verifier_output.successful:
+            return self._on_repair_success(attempt, source_file), verifier_output
+
+        self._log_failure(attempt)
+        return None, verifier_output
+
+    def _attempt_parallel_repair(
+        self,
+        attempt: int,
+        solution_generator: SolutionGenerator,
+        prompt: PromptTemplate,
+        solution: Solution,
+        verifier: BaseSourceVerifier,
+        verifier_output: VerifierOutput,
+        workspace: SolutionWorkspace,
+    ) -> tuple[FixCodeCommandResult | None, VerifierOutput]:
+        """Samples multiple candidates in one round and verifies them
+        concurrently. The first candidate that verifies wins, the verifier
+        processes of the remaining candidates are cancelled."""
+        source_file: SourceFile = solution.files[0]
+
+        with self.anim(
+            f"Generating {self._config.candidates} Solutions... Please Wait"
+        ):
+            candidates: SolutionCandidates = solution_generator.generate_solutions(
+                initial_message_prompt=prompt,
+                solution=solution,
+                verifier_output=verifier_output,
+                count=self._config.candidates,
+            )
+
+        # Identical candidates only need to be verified once.
+        unique_candidates: list[str] = list(dict.fromkeys(candidates.codes))
+        self.logger.info(
+            f"Verifying {len(unique_candidates)} unique candidates "
+            f"(of {len(candidates.codes)} sampled)"
+        )
+
+        cancel_event: Event = Event()
+
+        def submit_candidate(
+            service: VerifierService, code: str
+        ) -> Future[VerifierOutput]:
+            candidate: Solution = Solution([], include_dirs=solution.include_dirs)
+            candidate.add_source_file(
+                SourceFile(file_path=source_file.file_path, content=code)
+            )
+            attempt_solution: Solution = workspace.materialize(candidate)
+            future: Future[VerifierOutput] = service.submit(
+                attempt_solution, cancel_event=cancel_event
             )
+            future.add_done_callback(lambda _: workspace.release(attempt_solution))
+            return future
+
+        outputs: dict[int, VerifierOutput] = {}
+        errors: list[Exception] = []
+        winner: int | None = None
+        with (
+            self.anim("Verifying candidates with ESBMC... Please Wait"),
+            VerifierService.from_config(
+                verifier,
+                workers=self._config.max_workers or len(unique_candidates),
+            ) as service,
+        ):
+            futures: dict[Future[VerifierOutput], int] = {
+                submit_candidate(service, code): idx
+                for idx, code in enumerate(unique_candidates)
+            }
+            for future in as_completed(futures):
+                idx: int = futures[future]
+                try:
+                    outputs[idx] = future.result()
+                except VerifierCancelledException:
+                    continue
+                except Exception as e:
+                    self.logger.error(f"Candidate {idx} failed to verify: {e}")
+                    errors.append(e)
+                    continue
+
+                if outputs[idx].successful:
+                    winner = idx
+                    # Stop the candidates that have not started and kill the
+                    # verifier processes of the ones that are running.
+                    cancel_event.set()
+                    for f in futures:
+                        f.cancel()
+                    break
+
+        if winner is not None:
+            self.logger.info(f"Candidate {winner} verified successfully")
+            candidates.complete_turn(candidates.codes.index(unique_candidates[winner]))
+            source_file.content = unique_candidates[winner]
+            return self._on_repair_success(attempt, source_file), outputs[winner]
+
+        # The first candidate is the one that is kept in the conversation, so
+        # its verifier output is fed back in the next attempt. If it failed to
+        # verify, the next candidate with an output is used instead, with its
+        # code and response, so that the counterexample matches the code it is
+        # shown with.
+        kept: int = min(outputs) if outputs else 0
+        candidates.complete_turn(candidates.codes.index(unique_candidates[kept]))
+        if not outputs and errors:
+            raise errors[0]
+
+        self._log_failure(attempt)
+        if kept != 0:
+            self.logger.warn(
+                f"Candidate 0 has no verifier output, candidate {kept} is kept"
+            )
+        source_file.content = unique_candidates[kept]
+        return None, outputs.get(kept, verifier_output)
+
+    async def _pipelined_repair(
+        self,
+        solution_generator: SolutionGenerator,
+        initial_prompt: PromptTemplate,
+        retry_prompt: PromptTemplate,
+        solution: Solution,
+        verifier: BaseSourceVerifier,
+        verifier_output: VerifierOutput,
+        workspace: SolutionWorkspace,
+    ) -> FixCodeCommandResult | None:
+        """Repair loop that overlaps the LLM requests with the verification of
+        the candidates. Each candidate is verified as soon as its response
+        arrives, and the next attempt is requested as soon as the candidate
+        kept in the conversation (the first one) fails to verify, while the
+        other candidates of the attempt are still being generated or verified.
+        The first candidate of any attempt that verifies wins, the remaining
+        requests and verifier processes are cancelled."""
+        source_file: SourceFile = solution.files[0]
+        count: int = self._config.candidates
+        cancel_event: Event = Event()
 
-        # Failure case
+        service: VerifierService = VerifierService.from_config(
+            verifier, workers=self._config.max_workers or count
+        )
+        # The requests of each attempt, and the verifications of the
+        # candidates with the attempt, index and code of the candidate.
+        requests: list[asyncio.Task[None]] = []
+        verifications: dict[asyncio.Task[VerifierOutput], tuple[int, int, str]] = {}
+
+        async def verify(code: str) -> VerifierOutput:
+            candidate: Solution = Solution([], include_dirs=solution.include_dirs)
+            candidate.add_source_file(
+                SourceFile(file_path=source_file.file_path, content=code)
+            )
+            attempt_solution: Solution = workspace.materialize(candidate)
+            try:
+                return await asyncio.wrap_future(
+                    service.submit(attempt_solution, cancel_event=cancel_event)
+                )
+            finally:
+                workspace.release(attempt_solution)
+
+        async def request(attempt: int, output: VerifierOutput) -> None:
+            prompt: PromptTemplate = initial_prompt if attempt == 1 else retry_prompt
+            async for idx, code in solution_generator.aiter_solutions(
+                initial_message_prompt=prompt,
+                solution=solution,
+                verifier_output=output,
+                count=count,
+            ):
+                self.logger.info(f"Received candidate {attempt}-{idx}")
+                task = asyncio.create_task(verify(code))
+                verifications[task] = (attempt, idx, code)
+
+        try:
+            attempt: int = 1
+            requests.append(asyncio.create_task(request(attempt, verifier_output)))
+            while True:
+                running: set[asyncio.Task[Any]] = {
+                    *verifications,
+                    *(task for task in requests if not task.done()),
+                }
+                if not running:
+                    return None
+                done, _ = await asyncio.wait(
+                    running, return_when=asyncio.FIRST_COMPLETED
+                )
+                for task in done:
+                    if task not in verifications:
+                        # Errors of the LLM requests are raised.
+                        task.result()
+                        continue
+
+                    candidate_attempt, idx, code = verifications.pop(task)
+                    try:
+                        output: VerifierOutput = task.result()
+                    except VerifierCancelledException:
+                        continue
+                    except Exception as e:
+                        if idx == 0 and candidate_attempt == attempt:
+                            raise
+                        self.logger.error(
+                            f"Candidate {candidate_attempt}-{idx} failed to "
+                            f"verify: {e}"
+                        )
+                        continue
+
+                    if output.successful:
+                        self.logger.info(
+                            f"Candidate {candidate_attempt}-{idx} verified "
+                            "successfully"
+                        )
+                        source_file.content = code
+                        return self._on_repair_success(candidate_attempt, source_file)
+
+                    if idx == 0 and candidate_attempt == attempt:
+                        self._log_failure(attempt)
+                        if attempt < self._config.max_attempts:
+                            # The next attempt continues from the candidate
+                            # kept in the conversation.
+                            attempt += 1
+                            source_file.content = code
+                            requests.append(
+                                asyncio.create_task(request(attempt, output))
+                            )
+        finally:
+            # Kill the verifier processes that are left and wait for them to
+            # end before their attempt directories are released, then stop
+            # the requests.
+            cancel_event.set()
+            await asyncio.to_thread(service.close)
+            for task in [*requests, *verifications]:
+                task.cancel()
+            await asyncio.gather(*requests, *verifications, return_exceptions=True)
+
+    def _on_repair_success(
+        self, attempt: int, source_file: SourceFile
+    ) -> FixCodeCommandResult:
+        self.logger.info("Successfully verified code")
+
+        # Check if an output directory is specified and save to it
+        if self.global_config.solution.output_dir:
+            output_path: Path = (
+                self.global_config.solution.output_dir / source_file.file_path.name
+            )
+            if self.global_config.generate_patches:
+                output_path = output_path.parent / (output_path.name + ".patch")
+                source_file.save_diff(output_path, self.original_source_file)
+            else:
+                source_file.save_file(output_path)
+        return FixCodeCommandResult(
+            successful=True,
+            attempts=attempt,
+            repaired_source=source_file.content,
+        )
+
+    def _log_failure(self, attempt: int) -> None:
         if attempt != self._config.max_attempts:
             self.logger.info(
                 f"Failure {attempt}/{self._config.max_attempts}: Retrying..."
@@ -284,5 +792,3 @@ class FixCodeCommand(ChatCommand):
             self.logger.info(
                 f"Failure {attempt}/{self._config.max_attempts}: Exiting..."
             )
-
-        return None, verifier_output
@@ -18,7 +18,7 @@ from pydantic_settings import (
     SettingsConfigDict,
     TomlConfigSettingsSource,
 )
-from typing import Annotated
+from typing import Annotated, Literal
 from pydantic import (
     AliasChoices,
     AliasPath,
@@ -28,6 +28,7 @@ from pydantic import (
     Field,
     FilePath,
     field_validator,
+    model_validator,
 )
 from pydantic.fields import FieldInfo
 
@@ -311,6 +312,67 @@ class CommandOracleConfig(BaseModel):
         raise ValueError(f"Invalid parser set: {value}")
 
 
+ESBMC_ITERATIVE_PARAMS: frozenset[str] = frozenset(
+    [
+        "--k-induction",
+        "--k-induction-parallel",
+        "--incremental-bmc",
+        "--falsification",
+        "--termination",
+    ]
+)
+"""ESBMC parameters of the modes that grow the bound themselves, which can't
+be combined with the --unwind bound set by the escalation."""
+
+
+class ESBMCEscalationConfig(BaseModel):
+    """Settings of the escalation of the budget of ESBMC runs."""
+
+    enabled: bool = Field(
+        default=False,
+        description="Run ESBMC with a small timeout (and unwind bound) first, "
+        "and grow them each time the run times out (or hits the bound), up to "
+        "the timeout of ESBMC and max_unwind.",
+    )
+
+    start_timeout: int = Field(
+        default=5,
+        ge=1,
+        description="The timeout of the first run in seconds.",
+    )
+
+    factor: float = Field(
+        default=2.0,
+        gt=1,
+        description="The timeout and unwind bound are multiplied by this after "
+        "each run that times out or hits the bound.",
+    )
+
+    start_unwind: int | None = Field(
+        default=None,
+        ge=1,
+        description="The unwind bound of the first run, passed with --unwind "
+        "in place of any --unwind of the params. Can't be used with params "
+        "that grow the bound themselves, such as --k-induction. Leave empty to "
+        "not set an unwind bound.",
+    )
+
+    max_unwind: int = Field(
+        default=64,
+        ge=1,
+        description="The largest unwind bound that is tried.",
+    )
+
+    use_history: bool = Field(
+        default=True,
+        description="Record the smallest timeout and unwind bound known to be "
+        "enough for a program in the verifier cache, and start from them when "
+        "a version of the same program is verified again with the same entry "
+        "function, such as the next repair attempt. Needs the verifier cache "
+        "to be enabled.",
+    )
+
+
 class ESBMCConfig(BaseModel):
     """ESBMC-specific configuration.
 
@@ -357,6 +419,100 @@ class ESBMCConfig(BaseModel):
         description="The timeout set for ESBMC.",
     )
 
+    max_output_size: int | None = Field(
+        default=1 << 22,
+        ge=0,
+        description="The number of characters of ESBMC output that are kept, "
+        "older output is dropped as ESBMC writes more. The counterexamples "
+        "are parsed as they are written, so they are not affected, except "
+        "with the witness output format when the witness can't be read: the "
+        "counterexample is then missing if output was dropped. Leave empty to "
+        "keep the whole output.",
+    )
+
+    early_exit: bool = Field(
+        default=False,
+        description="Stop ESBMC as soon as the first violated property and its "
+        "counterexample have been printed, instead of waiting for it to end. "
+        "The result is marked as truncated.",
+    )
+
+    multi_property: bool = Field(
+        default=False,
+        description="Check every property instead of stopping at the first "
+        "violated one, so that one verification reports all the violated "
+        "properties. early_exit is ignored when this is set.",
+    )
+
+    parallel_claims: int = Field(
+        default=1,
+        ge=1,
+        description="With multi_property, the claims are split in this many "
+        "groups that are checked by parallel ESBMC processes, and their "
+        "results are merged. 1 checks all the claims in one process.",
+    )
+
+    portfolio: dict[str, list[str]] = Field(
+        default_factory=dict,
+        description='Parameter profiles by name, such as {"bmc": ["--unwind", '
+        '"10"], "kind": ["--k-induction"]}. If set, ESBMC is run with every '
+        "profile at the same time in place of params, the first conclusive "
+        "result (a successful verification or a counterexample) is kept and "
+        "the other processes are killed. The result reports the profile that "
+        "won.",
+    )
+
+    incremental: bool = Field(
+        default=False,
+        description="Verify from each of the incremental entry points and "
+        "cache the result of each one by the functions it can reach, so that "
+        "after a change only the entry points that reach a changed function "
+        "are verified again. Needs the verifier cache to reuse results.",
+    )
+
+    incremental_entry_points: list[str] = Field(
+        default=[],
+        description="The functions verified separately (with --function) in "
+        "incremental mode. Leave empty to use the entry function.",
+    )
+
+    preprocess_cache: bool = Field(
+        default=False,
+        description="Preprocess each C/C++ source file with ESBMC once and "
+        "keep the preprocessed translation unit in the verifier cache, keyed "
+        "by the digests of the file, the headers of the solution and the "
+        "include dirs. The digests of every file the unit was made from, such "
+        "as system headers, are checked before it is reused. Unchanged files "
+        "are then not preprocessed again across attempts and runs, only the "
+        "edited ones. Needs the verifier cache.",
+    )
+
+    escalation: ESBMCEscalationConfig = Field(
+        default_factory=ESBMCEscalationConfig,
+        description="Escalation of the timeout and unwind bound of ESBMC runs.",
+    )
+
+    output_format: Literal["text", "witness"] = Field(
+        default="text",
+        description="Where the counterexample is read from. text parses the "
+        "output of ESBMC, witness has ESBMC write a GraphML violation witness "
+        "and reads the counterexample from it, falling back to the text output "
+        "if the witness can't be read.",
+    )
+
+    @model_validator(mode="after")
+    def check_escalation_params(self) -> "ESBMCConfig":
+        if self.escalation.enabled and self.escalation.start_unwind is not None:
+            for profile_params in [self.params, *self.portfolio.values()]:
+                iterative: set[str] = ESBMC_ITERATIVE_PARAMS & set(profile_params)
+                if iterative:
+                    raise ValueError(
+                        "escalation.start_unwind can't be used with "
+                        f"{", ".join(sorted(iterative))}, remove them from the "
+                        "ESBMC params or leave start_unwind empty."
+                    )
+        return self
+
 
 class VerifierConfig(BaseModel):
     # The value is checked in AddonLoader.
@@ -371,6 +527,66 @@ class VerifierConfig(BaseModel):
         "This is not supported by all verifiers.",
     )
 
+    cache_dir: Path | None = Field(
+        default=None,
+        description="The directory the verifier cache is stored in. Leave "
+        "empty to use the user cache directory of the system.",
+    )
+
+    @field_validator("cache_dir", mode="before")
+    @classmethod
+    def on_set_cache_dir(cls, value: Path | None) -> Path | None:
+        if value is None:
+            return None
+        return Path(value).expanduser()
+
+    cache_max_size: int | None = Field(
+        default=1 << 30,
+        ge=0,
+        description="The size budget of the verifier cache in bytes. When "
+        "exceeded, the least recently used results are evicted. Leave empty "
+        "for an unbounded cache.",
+    )
+
+    cache_remote_url: str | None = Field(
+        default=None,
+        description="URL of a shared cache server to read results from and "
+        "upload results to, either http://host:port or unix:///path/to/socket. "
+        "The local cache is still used and serves as the fallback when the "
+        "server is unavailable. See esbmc_ai.cache.cache_server.",
+    )
+
+    workers: int | None = Field(
+        default=None,
+        ge=1,
+        description="The number of verifier processes that can run at the "
+        "same time when verifying concurrently. Defaults to the number of "
+        "CPUs.",
+    )
+
+    cpu_affinity: bool = Field(
+        default=False,
+        description="Pin each verifier process to its own CPU when verifying "
+        "concurrently. Verifier processes run one at a time are not pinned.",
+    )
+
+    memory_limit: int | None = Field(
+        default=None,
+        ge=1 << 26,
+        description="Limit of the address space of each verifier process in "
+        "bytes, at least 64 MiB so that the verifier can be executed. Applies "
+        "whether the verifier processes run concurrently or one at a time. "
+        "Leave empty for no limit.",
+    )
+
+    cpu_time_limit: int | None = Field(
+        default=None,
+        ge=1,
+        description="Limit of the CPU time of each verifier process in "
+        "seconds, the process is killed with SIGXCPU once it is reached. Leave "
+        "empty for no limit.",
+    )
+
     command_oracle: CommandOracleConfig = Field(
         default_factory=CommandOracleConfig,
         description='Command oracle "command-oracle" specific configuration.',
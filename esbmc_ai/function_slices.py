@@ -0,0 +1,133 @@
+# Author: Yiannis Charalambous
+
+"""Splits the source files of a solution into functions, using the function
+boundaries found by lizard, so that the parts of a solution a verification
+depends on can be told apart from the rest."""
+
+from dataclasses import dataclass
+from hashlib import sha256
+import re
+
+import lizard
+
+from esbmc_ai.solution import Solution, SourceFile
+
+_IDENTIFIER_PATTERN = re.compile(r"[A-Za-z_]\w*")
+
+
+@dataclass(frozen=True)
+class FunctionSlice:
+    """A function of a solution. Functions with the same name in different
+    files (such as static functions) share a slice."""
+
+    name: str
+    digest: str
+    """Digest of the text of the function."""
+    references: frozenset[str]
+    """The functions of the solution that are named in the function, which
+    includes the functions it calls and the ones it takes the address of."""
+
+
+class SolutionSlices:
+    """The functions of a solution and the code outside of them."""
+
+    def __init__(self, solution: Solution) -> None:
+        texts: dict[str, list[str]] = {}
+        global_text: list[str] = []
+        for source_file in solution.get_files_by_ext(
+            ["c", "cpp", "i", "ii", "cc", "cxx", "c++", "h", "hpp", "hxx", "h++"]
+        ):
+            functions, rest = self._split_file(source_file)
+            for name, text in functions:
+                texts.setdefault(name, []).append(text)
+            global_text.append(f"{self._relative(solution, source_file)}\n{rest}")
+
+        # Qualified C++ names are referenced by their last part.
+        names_by_short_name: dict[str, set[str]] = {}
+        for name in texts:
+            names_by_short_name.setdefault(name.rsplit("::", 1)[-1], set()).add(name)
+
+        def referenced(text: str) -> frozenset[str]:
+            return frozenset(
+                name
+                for identifier in set(_IDENTIFIER_PATTERN.findall(text))
+                for name in names_by_short_name.get(identifier, ())
+            )
+
+        self.functions: dict[str, FunctionSlice] = {
+            name: FunctionSlice(
+                name=name,
+                digest=sha256("\0".join(parts).encode("utf-8")).hexdigest(),
+                references=referenced("\n".join(parts)) - {name},
+            )
+            for name, parts in texts.items()
+        }
+        self.global_digest: str = sha256(
+            "\0".join(global_text).encode("utf-8")
+        ).hexdigest()
+        """Digest of the code outside of the functions, such as declarations,
+        types and macros, which every function may depend on."""
+        self.global_references: frozenset[str] = referenced("\n".join(global_text))
+        """Functions named outside of any function, such as in a table of
+        function pointers. They can be reached from anywhere."""
+        self.include_dirs_digest: str = solution.include_dirs_digest
+        """Digest of the include dirs, whose headers every function may depend
+        on."""
+
+    @staticmethod
+    def _relative(solution: Solution, source_file: SourceFile) -> str:
+        """The path of the file relative to the working dir of the solution,
+        so that the same program in another directory has the same slices."""
+        try:
+            return str(source_file.file_path.relative_to(solution.working_dir))
+        except ValueError:
+            return str(source_file.file_path)
+
+    @staticmethod
+    def _split_file(source_file: SourceFile) -> tuple[list[tuple[str, str]], str]:
+        """The name and text of each function of the file, and the text of the
+        file outside of the functions."""
+        lines: list[str] = source_file.content.splitlines(keepends=True)
+        info = lizard.analyze_file.analyze_source_code(
+            str(source_file.file_path), source_file.content
+        )
+        functions: list[tuple[str, str]] = []
+        in_function: list[bool] = [False] * len(lines)
+        for function in info.function_list:
+            start, end = function.start_line - 1, function.end_line
+            functions.append((function.name, "".join(lines[start:end])))
+            in_function[start:end] = [True] * (end - start)
+        rest: str = "".join(
+            line for line, inside in zip(lines, in_function) if not inside
+        )
+        return functions, rest
+
+    def call_tree(self, entry_function: str) -> set[str]:
+        """The functions reachable from entry_function, including itself and
+        the functions named outside of any function."""
+        reached: set[str] = set()
+        pending: list[str] = [entry_function, *self.global_references]
+        while pending:
+            name: str = pending.pop()
+            if name in reached or name not in self.functions:
+                continue
+            reached.add(name)
+            pending.extend(self.functions[name].references)
+        return reached
+
+    def call_tree_digest(self, entry_function: str) -> str | None:
+        """Digest of the code a verification from entry_function depends on:
+        the functions of its call tree, the code outside of functions and the
+        include dirs. It doesn't change when a function outside of the call
+        tree changes. None if the solution doesn't define entry_function."""
+        if entry_function not in self.functions:
+            return None
+        digests: list[str] = [
+            self.global_digest,
+            self.include_dirs_digest,
+            entry_function,
+        ] + [
+            f"{name}={self.functions[name].digest}"
+            for name in sorted(self.call_tree(entry_function))
+        ]
+        return sha256("\n".join(digests).encode("utf-8")).hexdigest()
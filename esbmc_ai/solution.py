@@ -2,12 +2,14 @@
 
 """Keeps track of all the source files that ESBMC-AI is targeting."""
 
-from os import walk
+from dataclasses import dataclass, field
+from os import scandir, stat_result, walk
 from os.path import commonpath
 from pathlib import Path
-from subprocess import PIPE, STDOUT, run, CompletedProcess
-from tempfile import NamedTemporaryFile, TemporaryDirectory
+from threading import Lock
+from tempfile import TemporaryDirectory
 from shutil import copytree
+from stat import S_ISREG
 from typing import Any, Literal, override
 from hashlib import sha256
 
@@ -17,10 +19,84 @@ from pydantic import Field, PrivateAttr
 import lizard
 from structlog.stdlib import get_logger
 
-from esbmc_ai.log_utils import LogCategories, get_log_level, print_horizontal_line
+from esbmc_ai.log_utils import LogCategories
+from esbmc_ai.unified_diff import HunkResult, apply_patch, parse_patch, unified_diff
 
 _SourceFileFormatStyles = Literal["markdown", "xml", "plain"]
 
+_FileSnapshot = tuple[int, int, int]
+"""The (mtime, size, inode) of a file, used to detect changes without reading
+it."""
+
+_INCLUDE_FILE_DIGESTS_LIMIT: int = 65536
+"""Maximum number of memoized include file digests and directory listings, the
+oldest are evicted first."""
+
+_include_file_digests: dict[tuple[int, int], tuple[_FileSnapshot, bytes]] = {}
+"""Content digests of the files in include directories by (device, inode), kept
+for as long as the snapshot of the file is unchanged. Keying on the inode
+rather than the path means a file reached through different paths, such as
+the include dir symlinks of SolutionWorkspace attempts, is hashed once."""
+_include_file_digests_lock: Lock = Lock()
+
+
+def _include_file_digest(file_path: Path, stat: stat_result) -> bytes:
+    """Returns the SHA256 digest of the contents of a file. The digest is only
+    recomputed if the file changed since the last time it was hashed."""
+    key: tuple[int, int] = (stat.st_dev, stat.st_ino)
+    snapshot: _FileSnapshot = (stat.st_mtime_ns, stat.st_size, stat.st_ino)
+    with _include_file_digests_lock:
+        cached = _include_file_digests.get(key)
+    if cached is not None and cached[0] == snapshot:
+        return cached[1]
+
+    digest: bytes = sha256(file_path.read_bytes()).digest()
+    with _include_file_digests_lock:
+        _include_file_digests.pop(key, None)
+        _include_file_digests[key] = (snapshot, digest)
+        while len(_include_file_digests) > _INCLUDE_FILE_DIGESTS_LIMIT:
+            del _include_file_digests[next(iter(_include_file_digests))]
+    return digest
+
+
+def file_digest(file_path: Path) -> str | None:
+    """SHA256 hex digest of the contents of a file on disk, memoized like the
+    files of include directories. None if the file can't be read."""
+    try:
+        return _include_file_digest(file_path, file_path.stat()).hex()
+    except OSError:
+        return None
+
+
+_directory_listings: dict[tuple[int, int], tuple[int, list[tuple[str, bool]]]] = {}
+"""The entries of the include directories by (device, inode), with whether
+each is a directory to recurse into, kept for as long as the mtime of the
+directory is unchanged. Adding, removing or renaming an entry changes it."""
+_directory_listings_lock: Lock = Lock()
+
+
+def _list_directory(directory: Path) -> list[tuple[str, bool]]:
+    """The names of the entries of a directory and whether each is a directory
+    (not a symlink to one). The directory is only read again if its mtime
+    changed since the last time it was listed."""
+    stat: stat_result = directory.stat()
+    key: tuple[int, int] = (stat.st_dev, stat.st_ino)
+    with _directory_listings_lock:
+        cached = _directory_listings.get(key)
+    if cached is not None and cached[0] == stat.st_mtime_ns:
+        return cached[1]
+
+    with scandir(directory) as entries:
+        listing: list[tuple[str, bool]] = [
+            (entry.name, entry.is_dir(follow_symlinks=False)) for entry in entries
+        ]
+    with _directory_listings_lock:
+        _directory_listings.pop(key, None)
+        _directory_listings[key] = (stat.st_mtime_ns, listing)
+        while len(_directory_listings) > _INCLUDE_FILE_DIGESTS_LIMIT:
+            del _directory_listings[next(iter(_directory_listings))]
+    return listing
+
 
 class SolutionIntegrityError(Exception):
     """Raised when the solution disk integrity check fails."""
@@ -45,6 +121,26 @@ class SolutionIntegrityError(Exception):
         )
 
 
+@dataclass
+class SolutionPatchResult:
+    """The outcome of applying a patch to a solution."""
+
+    files: dict[Path, list[HunkResult]] = field(default_factory=dict)
+    """The results of the hunks of each file in the patch."""
+    missing: list[str] = field(default_factory=list)
+    """Paths in the patch that are not in the solution."""
+
+    @property
+    def failed_hunks(self) -> int:
+        """The number of hunks that could not be applied."""
+        return sum(not h.applied for hunks in self.files.values() for h in hunks)
+
+    @property
+    def applied(self) -> bool:
+        """True if every hunk of the patch was applied."""
+        return not self.missing and self.failed_hunks == 0
+
+
 class SourceFile(Serializable):
     """Represents a source file in the Solution. Contains methods to manipulate
     and get information about different versions."""
@@ -52,6 +148,10 @@ class SourceFile(Serializable):
     file_path: Path = Field(description="Absolute file path")
     content: str = Field(description="File content")
 
+    _digest: str = PrivateAttr(default="")
+    _digest_content: str | None = PrivateAttr(default=None)
+    """The content object the digest was computed from."""
+
     @staticmethod
     def apply_line_patch(source_code: str, patch: str, start: int, end: int) -> str:
         """Applies a patch to the source code.
@@ -102,6 +202,16 @@ class SourceFile(Serializable):
     def __str__(self) -> str:
         return f"SourceFile({self.file_path})"
 
+    @property
+    def digest(self) -> str:
+        """SHA256 hex digest of the content. Memoized until the content is
+        reassigned, which is detected by identity so it costs nothing to check.
+        """
+        if self._digest_content is not self.content:
+            self._digest = sha256(self.content.encode("utf-8")).hexdigest()
+            self._digest_content = self.content
+        return self._digest
+
     def __hash__(self) -> int:
         """Stable hash based on file content for caching.
 
@@ -109,8 +219,7 @@ class SourceFile(Serializable):
         Hashes content only (not path) so identical content produces same hash
         regardless of file location.
         """
-        content_hash = sha256(self.content.encode("utf-8")).hexdigest()
-        return int(content_hash, 16)
+        return int(self.digest, 16)
 
     def __eq__(self, other: object) -> bool:
         """Compare SourceFiles based on file path and content."""
@@ -144,42 +253,16 @@ class SourceFile(Serializable):
         return ai_model.get_num_tokens(self.content[lower_idx:upper_idx])
 
     def get_diff(self, source_file_2: "SourceFile") -> str:
-        """Return diff between two SourceFiles."""
-        # Save as temp files
-        with (
-            NamedTemporaryFile(mode="w", delete=False) as file,
-            NamedTemporaryFile(mode="w", delete=False) as file_2,
-        ):
-            file.write(self.content)
-            file.flush()
-            file_2.write(source_file_2.content)
-            file_2.flush()
-
-            cmd = [
-                "diff",
-                "-u",  # Adds context around the diff text.
-                "--label",
-                str(source_file_2.file_path),  # Label for first file (original)
-                "--label",
-                str(self.file_path),  # Label for second file (modified)
-                file_2.name,  # Original file first
-                file.name,  # Modified file second
-            ]
-            process: CompletedProcess = run(
-                cmd,
-                stdout=PIPE,
-                stderr=STDOUT,
-                check=False,
-            )
-
-            # Exit status is 0 if inputs are the same, 1 if different, 2 if trouble.
-            # https://askubuntu.com/questions/698784/exit-code-of-diff
-            if process.returncode == 2:
-                raise ValueError(
-                    f"Diff for {file.name} and {file_2.name} failed (exit 2)."
-                )
-
-            return process.stdout.decode("utf-8")
+        """Return diff between two SourceFiles, in the format of `diff -u`
+        with source_file_2 as the original. Empty if the contents are equal."""
+        if self.digest == source_file_2.digest:
+            return ""
+        return unified_diff(
+            source_file_2.content,
+            self.content,
+            from_label=str(source_file_2.file_path),
+            to_label=str(self.file_path),
+        )
 
     def save_temp_file(self) -> Path:
         """Saves the file in a temporary directory it creates. The temp file is
@@ -290,6 +373,7 @@ class Solution(Serializable):
 
     _files: list[SourceFile] = PrivateAttr(default_factory=list)
     _include_dirs: list[Path] = PrivateAttr(default_factory=list)
+    _program_digest: str | None = PrivateAttr(default=None)
 
     @staticmethod
     def from_paths(
@@ -383,7 +467,12 @@ class Solution(Serializable):
         """Hash all files in a directory recursively based on content.
 
         Creates a stable hash by reading all files in the directory,
-        sorting them by relative path, and hashing their contents.
+        sorting them by relative path, and hashing their contents. The
+        listings of the directories are memoized on their mtime and the
+        digests of the files on their (mtime, size, inode), so only the
+        directories and files that changed since the last call are read.
+        Every directory and file is still stat'ed to find the changes, so the
+        cost of a call grows with the size of the tree, without reading it.
 
         Args:
             directory: The directory to hash
@@ -394,38 +483,80 @@ class Solution(Serializable):
         if not directory.exists() or not directory.is_dir():
             return sha256(b"").hexdigest()
 
+        # Symlinks to directories are not followed, like Path.rglob.
+        file_paths: list[Path] = []
+        pending: list[Path] = [directory]
+        while pending:
+            current: Path = pending.pop()
+            try:
+                listing: list[tuple[str, bool]] = _list_directory(current)
+            except OSError:
+                continue
+            for name, is_dir in listing:
+                (pending if is_dir else file_paths).append(current / name)
+
         file_hashes: list[str] = []
         # Walk directory in sorted order for determinism
-        for file_path in sorted(directory.rglob("*")):
-            if file_path.is_file():
+        for file_path in sorted(file_paths):
+            try:
+                stat: stat_result = file_path.stat()
+            except OSError:
+                continue
+            if S_ISREG(stat.st_mode):
                 # Hash: relative_path + content
                 relative = file_path.relative_to(directory)
                 path_hash = sha256(str(relative).encode("utf-8")).digest()
-                content_hash = sha256(file_path.read_bytes()).digest()
+                content_hash = _include_file_digest(file_path, stat)
                 combined = sha256(path_hash + content_hash).hexdigest()
                 file_hashes.append(combined)
 
         # Combine all file hashes
         return sha256("".join(file_hashes).encode("utf-8")).hexdigest()
 
-    def __hash__(self) -> int:
-        """Stable hash based on solution content for caching.
+    @property
+    def include_dirs_digest(self) -> str:
+        """SHA256 hex digest of the contents of the include directories, their
+        paths are not part of it."""
+        include_dir_digests = sorted(
+            self._hash_directory_contents(d) for d in self._include_dirs
+        )
+        return sha256("".join(include_dir_digests).encode("utf-8")).hexdigest()
 
-        Combines hashes of all files and include directories in a deterministic way.
-        Files and directories are sorted to ensure consistent ordering.
-        Include directories are hashed based on their contents.
+    @property
+    def digest(self) -> str:
+        """SHA256 hex digest of the solution content.
+
+        Combines the digests of all files and include directories in a
+        deterministic way. Files and directories are sorted to ensure consistent
+        ordering. Include directories are hashed based on their contents. Only
+        files that changed since the last call are rehashed.
         """
-        # Sort files by their hash for deterministic ordering
-        file_hashes = sorted(hash(f) for f in self._files)
+        # Sort files by their digest for deterministic ordering
+        file_digests = sorted(f.digest for f in self._files)
         # Hash include dirs by their contents (not paths)
-        include_dir_hashes = sorted(
+        include_dir_digests = sorted(
             self._hash_directory_contents(d) for d in self._include_dirs
         )
 
-        # Combine all hashes into a single string and hash it
-        combined = "".join(str(h) for h in file_hashes) + "".join(include_dir_hashes)
-        combined_hash = sha256(combined.encode("utf-8")).hexdigest()
-        return int(combined_hash, 16)
+        # Combine all digests into a single string and hash it
+        combined = "".join(file_digests) + "".join(include_dir_digests)
+        return sha256(combined.encode("utf-8")).hexdigest()
+
+    @property
+    def program_digest(self) -> str:
+        """The digest of the solution this one is a version of, such as the
+        original solution of a repair attempt, so that the versions of a
+        program can be told apart from other programs. Defaults to the digest
+        of this solution."""
+        return self._program_digest or self.digest
+
+    @program_digest.setter
+    def program_digest(self, value: str) -> None:
+        self._program_digest = value
+
+    def __hash__(self) -> int:
+        """Stable hash based on solution content for caching."""
+        return int(self.digest, 16)
 
     def __eq__(self, other: object) -> bool:
         """Compare Solutions based on files and include directories."""
@@ -572,36 +703,37 @@ class Solution(Serializable):
         self._files.append(SourceFile.load(abs_path))
 
     def get_diff(self, other: "Solution") -> str:
-        """Gets the diff with another solution. The following params are used: -ruN"""
-
-        if not self.verify_solution_integrity():
-            self.save_temp()
-
-        if not other.verify_solution_integrity():
-            other.save_temp()
-
-        cmd = [
-            "diff",
-            "-ruN",  # (r)ecursive, (u) additional context, (N) treat absent files as empty
-            str(self.working_dir),
-            str(other.working_dir),
-        ]
-
-        process: CompletedProcess = run(
-            cmd,
-            stdout=PIPE,
-            stderr=STDOUT,
-            check=False,
-        )
-
-        # Exit status is 0 if inputs are the same, 1 if different, 2 if trouble.
-        # https://askubuntu.com/questions/698784/exit-code-of-diff
-        if process.returncode == 2:
-            raise ValueError(
-                f"Diff for {self.working_dir} and {other.working_dir} failed (exit 2)."
+        """Gets the diff with another solution, in the format of `diff -ruN`
+        without the timestamps: files are matched by their path relative to the
+        working directory of each solution, and files missing from one of them
+        are treated as empty. Files with the same digest are skipped without
+        being compared."""
+        files: dict[Path, SourceFile] = {
+            f.file_path.relative_to(self.working_dir): f for f in self._files
+        }
+        other_files: dict[Path, SourceFile] = {
+            f.file_path.relative_to(other.working_dir): f for f in other._files
+        }
+
+        diffs: list[str] = []
+        for relative in sorted(files.keys() | other_files.keys()):
+            source_file: SourceFile | None = files.get(relative)
+            other_file: SourceFile | None = other_files.get(relative)
+            if source_file and other_file and source_file.digest == other_file.digest:
+                continue
+
+            path: Path = self.working_dir / relative
+            other_path: Path = other.working_dir / relative
+            diff: str = unified_diff(
+                source_file.content if source_file else "",
+                other_file.content if other_file else "",
+                from_label=str(path),
+                to_label=str(other_path),
             )
+            if diff:
+                diffs.append(f"diff -ruN {path} {other_path}\n{diff}")
 
-        return process.stdout.decode("utf-8")
+        return "".join(diffs)
 
     def save_diff(self, path: Path, solution: "Solution") -> Path:
         """Saves the solution as a patch of the original."""
@@ -683,50 +815,91 @@ class Solution(Serializable):
             include_dirs=list(set(self._include_dirs + other._include_dirs)),
         )
 
-    def patch_solution(self, patch: str) -> None:
-        """Patches the solution using the patch command."""
-        if not self.verify_solution_integrity():
-            raise SolutionIntegrityError(self.files)
-
-        # Save as temp files
-        with NamedTemporaryFile(mode="w", delete=False) as patch_file:
-            patch_file.write(patch)
-            patch_file.flush()
-
-            cmd = [
-                "patch",
-                "-d",  # Change to working dir first
-                str(self.working_dir),
-                "-i",  # Flag to specify patch file
-                str(Path(patch_file.name).absolute()),
-            ]
-
-            process: CompletedProcess = run(
-                cmd,
-                stdout=PIPE,
-                stderr=STDOUT,
-                check=False,
+    def _resolve_patch_path(self, label: str) -> SourceFile | None:
+        """Finds the file of the solution a path of a patch refers to. Relative
+        paths are matched against the working dir, with leading directories
+        (such as the a/ and b/ prefixes of git) stripped if needed."""
+        if label == "/dev/null":
+            return None
+        path: Path = Path(label)
+        if path.is_absolute():
+            return self.resolve(path)
+        for strip in range(len(path.parts)):
+            found: SourceFile | None = self.resolve(
+                self.working_dir / Path(*path.parts[strip:])
+            )
+            if found:
+                return found
+        return None
+
+    def _new_file_path(self, label: str) -> Path:
+        path: Path = Path(label)
+        if path.is_absolute():
+            return path
+        if len(path.parts) > 1 and path.parts[0] in ("a", "b"):
+            path = Path(*path.parts[1:])
+        return self.working_dir / path
+
+    def patch_solution(
+        self, patch: str, max_fuzz: int = 2, allow_partial: bool = False
+    ) -> "SolutionPatchResult":
+        """Applies a unified diff to the files of the solution in memory. Hunks
+        are matched with an offset or ignoring up to max_fuzz lines of context
+        if needed, like the patch command. Files created by the patch are added
+        to the solution, deleted files are removed.
+
+        Unless allow_partial is set, the solution is only changed if every hunk
+        applies, so candidate patches can be tried and rejected.
+
+        Raises:
+            PatchParseError: If the patch is not a valid unified diff."""
+        result: SolutionPatchResult = SolutionPatchResult()
+        contents: dict[int, str] = {}
+        created: list[SourceFile] = []
+        removed: list[SourceFile] = []
+
+        for file_patch in parse_patch(patch):
+            source_file: SourceFile | None = self._resolve_patch_path(
+                file_patch.old_path
+            ) or self._resolve_patch_path(file_patch.new_path)
+            is_new: bool = (
+                source_file is None
+                and bool(file_patch.hunks)
+                and all(h.old_len == 0 for h in file_patch.hunks)
             )
+            if source_file is None and not is_new:
+                result.missing.append(file_patch.new_path)
+                continue
+
+            content: str
+            if source_file is None:
+                path: Path = self._new_file_path(file_patch.new_path)
+                content, hunk_results = apply_patch("", file_patch.hunks, max_fuzz)
+                created.append(SourceFile(path, content))
+            else:
+                path = source_file.file_path
+                content, hunk_results = apply_patch(
+                    contents.get(id(source_file), source_file.content),
+                    file_patch.hunks,
+                    max_fuzz,
+                )
+                if file_patch.new_path == "/dev/null" and not content:
+                    removed.append(source_file)
+                else:
+                    contents[id(source_file)] = content
+            result.files.setdefault(path, []).extend(hunk_results)
+
+        logger = get_logger().bind(category=LogCategories.SYSTEM)
+        if not (result.applied or allow_partial):
+            logger.info(
+                f"Patch rejected: {result.failed_hunks} failed hunks, "
+                f"{len(result.missing)} missing files"
+            )
+            return result
 
-            # patch's exit status is 0 if all hunks are applied successfully,
-            # 1 if some  hunks  cannot  be applied  or there were merge
-            # conflicts, and 2 if there is more serious trouble.
-            match process.returncode:
-                case 1:
-                    print_horizontal_line(get_log_level(0))
-                    print(
-                        f"The patch:\n\n{patch}\n\nThe diff output:\n\n"
-                        + process.stdout.decode("utf-8")
-                    )
-                    raise ValueError(
-                        f"Patch failed for some files in solution {self.working_dir}"
-                    )
-                case 2:
-                    print_horizontal_line(get_log_level(0))
-                    print(
-                        f"The patch:\n\n{patch}\n\nThe diff output:\n\n"
-                        + process.stdout.decode("utf-8")
-                    )
-                    raise ValueError(
-                        f"Patch failed SERIOUSLY in solution {self.working_dir}"
-                    )
+        for source_file in self._files:
+            if id(source_file) in contents:
+                source_file.content = contents[id(source_file)]
+        self._files = [f for f in self._files if f not in removed] + created
+        logger.info(f"Patched {len(result.files)} files")
+        return result
@@ -0,0 +1,206 @@
+# Author: Yiannis Charalambous
+
+"""Overlay workspace for verifying many variations of the same solution
+without copying it in full every time."""
+
+from contextlib import contextmanager
+import os
+from pathlib import Path
+from shutil import copy2, copytree, rmtree
+from tempfile import mkdtemp
+from threading import Lock
+from typing import Iterator
+import weakref
+
+from structlog.stdlib import get_logger
+
+from esbmc_ai.log_categories import LogCategories
+from esbmc_ai.solution import Solution, SourceFile
+
+
+class SolutionWorkspace:
+    """Holds a base snapshot of a solution on disk, and creates a directory for
+    each variation (attempt) of the solution that needs to be on disk, such as
+    for verification. Attempt directories only hold the files that differ from
+    the base: the rest are hard links to the base snapshot, and the include
+    directories are symlinks to the originals, so no include tree is copied.
+    Include directories that hold files of the solution are the exception:
+    they are copied once into the base and hard linked into each attempt.
+
+    The layout of the workspace is:
+
+        <root>/base/...         The solution as it was when the workspace was
+                                created.
+        <root>/attempt-N/...    The attempts, same layout as the base.
+
+    If auto_clean is set, attempt directories are deleted when released and
+    the workspace is deleted when closed or garbage collected."""
+
+    def __init__(
+        self,
+        solution: Solution,
+        temp_dir: Path | None = None,
+        auto_clean: bool = True,
+    ) -> None:
+        """Creates the workspace in a new directory under temp_dir (the system
+        temp directory if None) with a snapshot of solution."""
+        self.auto_clean: bool = auto_clean
+        self.root: Path = Path(
+            mkdtemp(
+                prefix="esbmc-ai-",
+                suffix="-" + solution.working_dir.name,
+                dir=temp_dir,
+            )
+        )
+        self.base_dir: Path = self.root / "base"
+        self._working_dir: Path = solution.working_dir
+        # The attempts are versions of the program of the snapshot.
+        self.program_digest: str = solution.program_digest
+        self._digests: dict[Path, str] = {}
+        self._include_dirs: dict[Path, Path] = {}
+        self._count: int = 0
+        self._attempt_dirs: dict[int, Path] = {}
+        self._lock: Lock = Lock()
+        self._logger = get_logger().bind(category=LogCategories.SYSTEM)
+        self._finalizer = weakref.finalize(
+            self, rmtree, self.root, ignore_errors=True
+        )
+        if not auto_clean:
+            self._finalizer.detach()
+
+        self._snapshot(solution)
+
+    def _relative(self, path: Path, working_dir: Path | None = None) -> Path:
+        """Maps a path of the solution to its path in the workspace. Paths
+        outside of the working dir (such as system include dirs) are placed
+        at the top level by name, like Solution.save_solution."""
+        try:
+            return path.relative_to(working_dir or self._working_dir)
+        except ValueError:
+            return Path(path.name)
+
+    def _snapshot(self, solution: Solution) -> None:
+        self.base_dir.mkdir()
+        relatives: list[Path] = [self._relative(f.file_path) for f in solution.files]
+        for include_dir in solution.include_dirs:
+            relative: Path = self._relative(include_dir)
+            # Include dirs holding files of the solution can't be symlinked as
+            # the files would be shared between attempts, so they are copied
+            # once into the base instead, and linked into each attempt by
+            # _link_include_dir. The copy is made before the files of the
+            # solution are written so it can't overwrite them.
+            if any(r.is_relative_to(relative) for r in relatives):
+                copytree(
+                    include_dir,
+                    self.base_dir / relative,
+                    symlinks=True,
+                    dirs_exist_ok=True,
+                )
+                self._include_dirs[relative] = self.base_dir / relative
+            else:
+                self._include_dirs[relative] = include_dir
+
+        for source_file, relative in zip(solution.files, relatives):
+            path: Path = self.base_dir / relative
+            path.parent.mkdir(parents=True, exist_ok=True)
+            source_file.save_file(path)
+            self._digests[relative] = source_file.digest
+
+        self._logger.info(f"Created solution workspace {self.root}")
+
+    def _link_include_dir(self, relative: Path, attempt_dir: Path) -> None:
+        """Populates the include dir at relative in attempt_dir with hard links
+        to the entries of its copy in the base, except for the files of the
+        solution, which the attempt writes itself."""
+        for dir_path, dir_names, file_names in (self.base_dir / relative).walk():
+            target_dir: Path = attempt_dir / dir_path.relative_to(self.base_dir)
+            target_dir.mkdir(parents=True, exist_ok=True)
+            # Symlinked dirs are not walked into, they are linked like files.
+            links: list[str] = [d for d in dir_names if (dir_path / d).is_symlink()]
+            for name in file_names + links:
+                source: Path = dir_path / name
+                path: Path = target_dir / name
+                if path.relative_to(attempt_dir) in self._digests or path.exists(
+                    follow_symlinks=False
+                ):
+                    continue
+                if source.is_symlink():
+                    path.symlink_to(source.readlink())
+                    continue
+                try:
+                    os.link(source, path)
+                except OSError:
+                    copy2(source, path)
+
+    def materialize(self, solution: Solution) -> Solution:
+        """Writes a variation of the solution into a new attempt directory,
+        and returns the solution loaded from there. The files of solution are
+        expected to have the same paths as the files of the snapshot, only
+        the files whose content differs from the snapshot are written."""
+        with self._lock:
+            self._count += 1
+            attempt_dir: Path = self.root / f"attempt-{self._count}"
+        attempt_dir.mkdir()
+
+        files: list[SourceFile] = []
+        for source_file in solution.files:
+            relative: Path = self._relative(
+                source_file.file_path, solution.working_dir
+            )
+            path: Path = attempt_dir / relative
+            path.parent.mkdir(parents=True, exist_ok=True)
+            if self._digests.get(relative) == source_file.digest:
+                try:
+                    os.link(self.base_dir / relative, path)
+                except OSError:
+                    source_file.save_file(path)
+            else:
+                source_file.save_file(path)
+            files.append(SourceFile(file_path=path, content=source_file.content))
+
+        for relative, target in self._include_dirs.items():
+            if target.is_relative_to(self.base_dir):
+                self._link_include_dir(relative, attempt_dir)
+
+        include_dirs: list[Path] = []
+        for relative, target in self._include_dirs.items():
+            path = attempt_dir / relative
+            if not path.exists():
+                path.parent.mkdir(parents=True, exist_ok=True)
+                path.symlink_to(target, target_is_directory=True)
+            include_dirs.append(path)
+
+        result: Solution = Solution([], include_dirs=include_dirs)
+        result.add_source_files(files)
+        result.program_digest = self.program_digest
+        with self._lock:
+            self._attempt_dirs[id(result)] = attempt_dir
+        return result
+
+    def release(self, attempt: Solution) -> None:
+        """Deletes the directory of an attempt created by materialize, if the
+        workspace cleans up automatically."""
+        with self._lock:
+            attempt_dir: Path | None = self._attempt_dirs.pop(id(attempt), None)
+        if self.auto_clean and attempt_dir is not None:
+            rmtree(attempt_dir, ignore_errors=True)
+
+    @contextmanager
+    def attempt(self, solution: Solution) -> Iterator[Solution]:
+        """Materializes solution for the duration of the context."""
+        materialized: Solution = self.materialize(solution)
+        try:
+            yield materialized
+        finally:
+            self.release(materialized)
+
+    def close(self) -> None:
+        """Deletes the workspace if it cleans up automatically."""
+        if self.auto_clean:
+            self._finalizer()
+
+    def __enter__(self) -> "SolutionWorkspace":
+        return self
+
+    def __exit__(self, *_) -> None:
+        self.close()
@@ -0,0 +1,691 @@
+# Author: Yiannis Charalambous
+
+"""In-process unified diff engine. Produces the same format as `diff -u`,
+including the `\\ No newline at end of file` markers, using the Myers
+difference algorithm over lines. Also parses unified diffs and applies them
+in memory with offset and fuzz matching, like `patch`."""
+
+from dataclasses import dataclass, field
+import re
+from typing import Iterator, Literal, NamedTuple
+
+_NO_NEWLINE: str = "\\ No newline at end of file\n"
+
+
+class Opcode(NamedTuple):
+    """Describes how to turn a[i1:i2] into b[j1:j2]."""
+
+    tag: Literal["equal", "delete", "insert", "replace"]
+    i1: int
+    i2: int
+    j1: int
+    j2: int
+
+
+def _discard_confusing_lines(
+    a: list[int], b: list[int]
+) -> tuple[list[bool], list[bool]]:
+    """Finds the lines that can be marked as changed without running them
+    through the algorithm, the same way diff does: lines that have no match in
+    the other file, and runs of lines that have too many matches. Discarding
+    them speeds up the comparison, and doing it like diff means that the same
+    shortest edit script is picked when there are several."""
+    counts: list[dict[int, int]] = [{}, {}]
+    for f, lines in enumerate((a, b)):
+        for line in lines:
+            counts[f][line] = counts[f].get(line, 0) + 1
+
+    result: list[list[bool]] = []
+    for f, lines in enumerate((a, b)):
+        other_counts: dict[int, int] = counts[1 - f]
+        end: int = len(lines)
+        # Multiply many by the approximate square root of the number of lines.
+        many: int = 5
+        tem: int = end // 64
+        while (tem := tem >> 2) > 0:
+            many *= 2
+
+        # 1 for lines to discard, 2 for provisionally discardable ones.
+        discards: list[int] = [0] * end
+        for i, line in enumerate(lines):
+            nmatch: int = other_counts.get(line, 0)
+            if nmatch == 0:
+                discards[i] = 1
+            elif nmatch > many:
+                discards[i] = 2
+
+        # Provisional lines are only discarded in a run of discardable lines
+        # that starts and ends with lines that are not provisional.
+        i = 0
+        while i < end:
+            if discards[i] == 2:
+                discards[i] = 0
+            elif discards[i] != 0:
+                provisional: int = 0
+                j = i
+                while j < end and discards[j] != 0:
+                    if discards[j] == 2:
+                        provisional += 1
+                    j += 1
+                while j > i and discards[j - 1] == 2:
+                    j -= 1
+                    discards[j] = 0
+                    provisional -= 1
+                length: int = j - i
+
+                if provisional * 4 > length:
+                    for k in range(i, j):
+                        if discards[k] == 2:
+                            discards[k] = 0
+                else:
+                    minimum: int = 1
+                    tem = length >> 2
+                    while (tem := tem >> 2) > 0:
+                        minimum <<= 1
+                    minimum += 1
+                    # Cancel any subrun of minimum or more provisionals.
+                    consec: int = 0
+                    k = 0
+                    while k < length:
+                        if discards[i + k] != 2:
+                            consec = 0
+                        else:
+                            consec += 1
+                            if consec == minimum:
+                                k -= consec
+                            elif consec > minimum:
+                                discards[i + k] = 0
+                        k += 1
+                    # Cancel provisionals at the start and end of the run, up
+                    # to 3 discarded lines in a row or the first discarded line
+                    # 8 lines in.
+                    for step, base in ((1, i), (-1, i + length - 1)):
+                        consec = 0
+                        for k in range(length):
+                            index: int = base + step * k
+                            if k >= 8 and discards[index] == 1:
+                                break
+                            if discards[index] == 2:
+                                consec = 0
+                                discards[index] = 0
+                            elif discards[index] == 0:
+                                consec = 0
+                            else:
+                                consec += 1
+                            if consec == 3:
+                                break
+                    i += length - 1
+            i += 1
+
+        result.append([d != 0 for d in discards])
+    return result[0], result[1]
+
+
+def _middle_snake(
+    a: list[int],
+    b: list[int],
+    xoff: int,
+    xlim: int,
+    yoff: int,
+    ylim: int,
+    fd: list[int],
+    bd: list[int],
+    offset: int,
+) -> tuple[int, int]:
+    """Finds the midpoint of a shortest edit script of a[xoff:xlim] and
+    b[yoff:ylim] by searching from both ends at once. fd and bd hold the
+    furthest reaching x of each diagonal (x - y) of the forward and backward
+    searches, indexed from offset."""
+    dmin: int = xoff - ylim
+    dmax: int = xlim - yoff
+    fmid: int = xoff - yoff
+    bmid: int = xlim - ylim
+    fmin = fmax = fmid
+    bmin = bmax = bmid
+    odd: bool = (fmid - bmid) % 2 == 1
+
+    fd[offset + fmid] = xoff
+    bd[offset + bmid] = xlim
+
+    while True:
+        # Extend the forward search by an edit step in each diagonal.
+        if fmin > dmin:
+            fmin -= 1
+            fd[offset + fmin - 1] = -1
+        else:
+            fmin += 1
+        if fmax < dmax:
+            fmax += 1
+            fd[offset + fmax + 1] = -1
+        else:
+            fmax -= 1
+        for d in range(fmax, fmin - 1, -2):
+            tlo: int = fd[offset + d - 1]
+            thi: int = fd[offset + d + 1]
+            x: int = thi if tlo < thi else tlo + 1
+            y: int = x - d
+            while x < xlim and y < ylim and a[x] == b[y]:
+                x += 1
+                y += 1
+            fd[offset + d] = x
+            if odd and bmin <= d <= bmax and bd[offset + d] <= x:
+                return x, y
+
+        # Extend the backward search.
+        if bmin > dmin:
+            bmin -= 1
+            bd[offset + bmin - 1] = xlim + 1
+        else:
+            bmin += 1
+        if bmax < dmax:
+            bmax += 1
+            bd[offset + bmax + 1] = xlim + 1
+        else:
+            bmax -= 1
+        for d in range(bmax, bmin - 1, -2):
+            tlo = bd[offset + d - 1]
+            thi = bd[offset + d + 1]
+            x = tlo if tlo < thi else thi - 1
+            y = x - d
+            while xoff < x and yoff < y and a[x - 1] == b[y - 1]:
+                x -= 1
+                y -= 1
+            bd[offset + d] = x
+            if not odd and fmin <= d <= fmax and x <= fd[offset + d]:
+                return x, y
+
+
+def _compare(a: list[int], b: list[int]) -> tuple[list[bool], list[bool]]:
+    """Marks the lines of a and b that are not part of a longest common
+    subsequence, using the linear space variant of the Myers algorithm."""
+    changed_a: list[bool] = [False] * len(a)
+    changed_b: list[bool] = [False] * len(b)
+    offset: int = len(b) + 1
+    fd: list[int] = [0] * (len(a) + len(b) + 3)
+    bd: list[int] = [0] * (len(a) + len(b) + 3)
+
+    stack: list[tuple[int, int, int, int]] = [(0, len(a), 0, len(b))]
+    while stack:
+        xoff, xlim, yoff, ylim = stack.pop()
+        while xoff < xlim and yoff < ylim and a[xoff] == b[yoff]:
+            xoff += 1
+            yoff += 1
+        while xoff < xlim and yoff < ylim and a[xlim - 1] == b[ylim - 1]:
+            xlim -= 1
+            ylim -= 1
+
+        if xoff == xlim:
+            for y in range(yoff, ylim):
+                changed_b[y] = True
+        elif yoff == ylim:
+            for x in range(xoff, xlim):
+                changed_a[x] = True
+        else:
+            xmid, ymid = _middle_snake(a, b, xoff, xlim, yoff, ylim, fd, bd, offset)
+            stack.append((xmid, xlim, ymid, ylim))
+            stack.append((xoff, xmid, yoff, ymid))
+
+    return changed_a, changed_b
+
+
+def diff_opcodes(a: list[str], b: list[str], horizon: int = 3) -> list[Opcode]:
+    """Returns the opcodes of a shortest edit script turning a into b. Like
+    diff, only the lines of the common prefix and suffix within horizon lines
+    of the first and last changes take part in the comparison. Pass the amount
+    of context lines to get the same edit script as diff."""
+    prefix: int = 0
+    while prefix < len(a) and prefix < len(b) and a[prefix] == b[prefix]:
+        prefix += 1
+    suffix: int = 0
+    while (
+        suffix < len(a) - prefix
+        and suffix < len(b) - prefix
+        and a[-1 - suffix] == b[-1 - suffix]
+    ):
+        suffix += 1
+    if prefix == len(a) == len(b):
+        return [Opcode("equal", 0, len(a), 0, len(b))] if a else []
+
+    # The common prefix and suffix don't need to go through the algorithm.
+    lo: int = max(0, prefix - horizon)
+    skip_end: int = max(0, suffix - horizon)
+    a_end: int = len(a) - skip_end
+    b_end: int = len(b) - skip_end
+
+    # Compare lines by integer ids, cheaper than comparing the strings.
+    ids: dict[str, int] = {}
+    a_ids: list[int] = [ids.setdefault(line, len(ids)) for line in a[lo:a_end]]
+    b_ids: list[int] = [ids.setdefault(line, len(ids)) for line in b[lo:b_end]]
+
+    # Lines that are discarded are changed, the rest are compared.
+    changed_a, changed_b = _discard_confusing_lines(a_ids, b_ids)
+    kept_a: list[int] = [i for i, d in enumerate(changed_a) if not d]
+    kept_b: list[int] = [j for j, d in enumerate(changed_b) if not d]
+    compared_a, compared_b = _compare(
+        [a_ids[i] for i in kept_a], [b_ids[j] for j in kept_b]
+    )
+    for i, changed in zip(kept_a, compared_a):
+        changed_a[i] = changed
+    for j, changed in zip(kept_b, compared_b):
+        changed_b[j] = changed
+
+    # The change lists have a sentinel at both ends.
+    changed_a = [False] + changed_a + [False]
+    changed_b = [False] + changed_b + [False]
+    _shift_boundaries(changed_a, changed_b, a_ids)
+    _shift_boundaries(changed_b, changed_a, b_ids)
+
+    opcodes: list[Opcode] = [
+        Opcode(tag, i1 + lo, i2 + lo, j1 + lo, j2 + lo)
+        for tag, i1, i2, j1, j2 in _opcodes_from_changes(changed_a, changed_b)
+    ]
+    # Add back the lines that were left out.
+    if lo:
+        if opcodes and opcodes[0].tag == "equal":
+            opcodes[0] = Opcode("equal", 0, opcodes[0].i2, 0, opcodes[0].j2)
+        else:
+            opcodes.insert(0, Opcode("equal", 0, lo, 0, lo))
+    if skip_end:
+        if opcodes and opcodes[-1].tag == "equal":
+            last: Opcode = opcodes[-1]
+            opcodes[-1] = Opcode("equal", last.i1, len(a), last.j1, len(b))
+        else:
+            opcodes.append(Opcode("equal", a_end, len(a), b_end, len(b)))
+    return opcodes
+
+
+def _shift_boundaries(
+    changed: list[bool], other_changed: list[bool], equivs: list[int]
+) -> None:
+    """Slides runs of changed lines over equal lines the same way diff does,
+    so that the output is the same as diff when several shortest edit scripts
+    exist: runs are merged with neighbouring runs where possible, moved as far
+    forward as possible, and then back to line up with a run of changes in the
+    other file.
+
+    The change lists have a sentinel at both ends, line x is at index x + 1."""
+    i_end: int = len(changed) - 2
+    i = j = 0
+    while True:
+        # Scan forwards to the next run of changes, keeping track of the
+        # corresponding point in the other file.
+        while i < i_end and not changed[i + 1]:
+            while other_changed[j + 1]:
+                j += 1
+            j += 1
+            i += 1
+        if i == i_end:
+            break
+        start: int = i
+        # Find the end of this run of changes.
+        i += 1
+        while changed[i + 1]:
+            i += 1
+        while other_changed[j + 1]:
+            j += 1
+
+        while True:
+            run_length: int = i - start
+            # Move the run back while the previous unchanged line matches the
+            # last changed one, merging with previous runs.
+            while start and equivs[start - 1] == equivs[i - 1]:
+                start -= 1
+                changed[start + 1] = True
+                i -= 1
+                changed[i + 1] = False
+                while changed[start]:
+                    start -= 1
+                j -= 1
+                while other_changed[j + 1]:
+                    j -= 1
+            # The end of the run, at the last point where it corresponds to a
+            # run of changes in the other file. i_end if there's no such point.
+            corresponding: int = i if other_changed[j] else i_end
+            # Move the run forward while the first changed line matches the
+            # following unchanged one, merging with following runs.
+            while i != i_end and equivs[start] == equivs[i]:
+                changed[start + 1] = False
+                start += 1
+                changed[i + 1] = True
+                i += 1
+                while changed[i + 1]:
+                    i += 1
+                j += 1
+                while other_changed[j + 1]:
+                    j += 1
+                    corresponding = i
+            if run_length == i - start:
+                break
+
+        # Move the merged run back to a corresponding run in the other file.
+        while corresponding < i:
+            start -= 1
+            changed[start + 1] = True
+            i -= 1
+            changed[i + 1] = False
+            j -= 1
+            while other_changed[j + 1]:
+                j -= 1
+
+
+def _opcodes_from_changes(
+    changed_a: list[bool], changed_b: list[bool]
+) -> list[Opcode]:
+    n, m = len(changed_a) - 2, len(changed_b) - 2
+    opcodes: list[Opcode] = []
+    i = j = 0
+    while i < n or j < m:
+        i1, j1 = i, j
+        while i < n and changed_a[i + 1]:
+            i += 1
+        while j < m and changed_b[j + 1]:
+            j += 1
+        if i1 < i or j1 < j:
+            tag = "replace" if i1 < i and j1 < j else "delete" if i1 < i else "insert"
+            opcodes.append(Opcode(tag, i1, i, j1, j))
+        i1, j1 = i, j
+        while i < n and j < m and not changed_a[i + 1] and not changed_b[j + 1]:
+            i += 1
+            j += 1
+        if i1 < i:
+            opcodes.append(Opcode("equal", i1, i, j1, j))
+    return opcodes
+
+
+def _group_opcodes(opcodes: list[Opcode], context: int) -> Iterator[list[Opcode]]:
+    """Groups changes into hunks with up to context lines of context. Changes
+    separated by no more than twice the context are placed in the same hunk."""
+    if not any(op.tag != "equal" for op in opcodes):
+        return
+    codes: list[Opcode] = list(opcodes)
+    # Trim the context at the start and end.
+    if codes[0].tag == "equal":
+        tag, i1, i2, j1, j2 = codes[0]
+        codes[0] = Opcode(tag, max(i1, i2 - context), i2, max(j1, j2 - context), j2)
+    if codes[-1].tag == "equal":
+        tag, i1, i2, j1, j2 = codes[-1]
+        codes[-1] = Opcode(tag, i1, min(i2, i1 + context), j1, min(j2, j1 + context))
+
+    group: list[Opcode] = []
+    for tag, i1, i2, j1, j2 in codes:
+        if tag == "equal" and i2 - i1 > 2 * context:
+            group.append(Opcode(tag, i1, i1 + context, j1, j1 + context))
+            yield group
+            group = []
+            i1, j1 = i2 - context, j2 - context
+        group.append(Opcode(tag, i1, i2, j1, j2))
+    if group and not (len(group) == 1 and group[0].tag == "equal"):
+        yield group
+
+
+def _format_range(start: int, stop: int) -> str:
+    """Formats a hunk range the way diff does: the line number of the first
+    line and the count, omitted if 1. Empty ranges point to the line before."""
+    length: int = stop - start
+    if length == 1:
+        return str(start + 1)
+    if length == 0:
+        return f"{start},0"
+    return f"{start + 1},{length}"
+
+
+def _emit(prefix: str, line: str) -> str:
+    if line.endswith("\n"):
+        return prefix + line
+    return prefix + line + "\n" + _NO_NEWLINE
+
+
+def unified_diff_lines(
+    a: list[str],
+    b: list[str],
+    from_label: str,
+    to_label: str,
+    context: int = 3,
+) -> str:
+    """Unified diff of two lists of lines that keep their line endings.
+    Returns an empty string if they are equal."""
+    hunks: list[str] = []
+    for group in _group_opcodes(diff_opcodes(a, b, context), context):
+        first, last = group[0], group[-1]
+        lines: list[str] = [
+            f"@@ -{_format_range(first.i1, last.i2)} "
+            f"+{_format_range(first.j1, last.j2)} @@\n"
+        ]
+        for tag, i1, i2, j1, j2 in group:
+            if tag == "equal":
+                lines.extend(_emit(" ", line) for line in a[i1:i2])
+                continue
+            lines.extend(_emit("-", line) for line in a[i1:i2])
+            lines.extend(_emit("+", line) for line in b[j1:j2])
+        hunks.append("".join(lines))
+
+    if not hunks:
+        return ""
+    return f"--- {from_label}\n+++ {to_label}\n" + "".join(hunks)
+
+
+def split_lines(text: str) -> list[str]:
+    """Splits text into lines that keep their newline. Unlike str.splitlines
+    only line feeds end a line, like in diff."""
+    lines: list[str] = text.split("\n")
+    result: list[str] = [line + "\n" for line in lines[:-1]]
+    if lines[-1]:
+        result.append(lines[-1])
+    return result
+
+
+def unified_diff(a: str, b: str, from_label: str, to_label: str) -> str:
+    """Unified diff of two texts, same output as `diff -u --label from_label
+    --label to_label`. Returns an empty string if they are equal."""
+    if a == b:
+        return ""
+    return unified_diff_lines(
+        split_lines(a),
+        split_lines(b),
+        from_label,
+        to_label,
+    )
+
+
+class PatchParseError(ValueError):
+    """Raised when a patch is not a valid unified diff."""
+
+
+_HUNK_HEADER = re.compile(r"@@ -(\d+)(?:,(\d+))? \+(\d+)(?:,(\d+))? @@")
+
+
+@dataclass
+class Hunk:
+    """A hunk of a unified diff. The lines keep their prefix character and
+    their newline, which is removed from lines marked with `\\ No newline at
+    end of file`."""
+
+    old_start: int
+    old_len: int
+    new_start: int
+    new_len: int
+    lines: list[str] = field(default_factory=list)
+
+    @property
+    def old_lines(self) -> list[str]:
+        """The lines the hunk replaces."""
+        return [line[1:] for line in self.lines if line[0] in " -"]
+
+    @property
+    def new_lines(self) -> list[str]:
+        """The lines the hunk replaces them with."""
+        return [line[1:] for line in self.lines if line[0] in " +"]
+
+    def trimmed(self, fuzz: int) -> tuple[list[str], list[str], int, int]:
+        """Returns the old and new lines without up to fuzz lines of context
+        at each end, and the number of lines removed from the start and end."""
+        lead: int = 0
+        while lead < min(fuzz, len(self.lines)) and self.lines[lead][0] == " ":
+            lead += 1
+        trail: int = 0
+        while (
+            trail < min(fuzz, len(self.lines) - lead)
+            and self.lines[-1 - trail][0] == " "
+        ):
+            trail += 1
+        lines: list[str] = self.lines[lead : len(self.lines) - trail]
+        old: list[str] = [line[1:] for line in lines if line[0] in " -"]
+        new: list[str] = [line[1:] for line in lines if line[0] in " +"]
+        return old, new, lead, trail
+
+
+@dataclass
+class FilePatch:
+    """The hunks of a unified diff for a single file."""
+
+    old_path: str
+    new_path: str
+    hunks: list[Hunk] = field(default_factory=list)
+
+
+def _parse_label(line: str) -> str:
+    """Path of a --- or +++ line, without the timestamp diff appends."""
+    return line[4:].rstrip("\n").split("\t")[0].strip()
+
+
+def parse_patch(patch: str) -> list[FilePatch]:
+    """Parses a unified diff, which can contain the diffs of several files.
+    Lines outside of the file diffs (such as `diff` or `index` lines) are
+    ignored. Empty lines in hunks are taken as empty context lines, as they
+    are often left without the leading space.
+
+    Raises:
+        PatchParseError: If the patch is malformed."""
+    lines: list[str] = split_lines(patch)
+    files: list[FilePatch] = []
+    i: int = 0
+    while i < len(lines):
+        line: str = lines[i]
+        if line.startswith("--- ") and i + 1 < len(lines):
+            if not lines[i + 1].startswith("+++ "):
+                raise PatchParseError(f"Expected +++ after line {i + 1}")
+            files.append(FilePatch(_parse_label(line), _parse_label(lines[i + 1])))
+            i += 2
+            continue
+
+        match = _HUNK_HEADER.match(line)
+        if match is None:
+            i += 1
+            continue
+        if not files:
+            raise PatchParseError(f"Hunk without file header at line {i + 1}")
+
+        old_start, old_len, new_start, new_len = (
+            int(g) if g is not None else 1 for g in match.groups()
+        )
+        hunk: Hunk = Hunk(old_start, old_len, new_start, new_len)
+        old_left, new_left = old_len, new_len
+        i += 1
+        while old_left > 0 or new_left > 0:
+            if i >= len(lines):
+                raise PatchParseError(f"Hunk {match.group(0)} is truncated")
+            line = lines[i]
+            if line in ("\n", ""):
+                line = " \n"
+            kind: str = line[0]
+            if kind == " ":
+                old_left -= 1
+                new_left -= 1
+            elif kind == "-":
+                old_left -= 1
+            elif kind == "+":
+                new_left -= 1
+            elif kind != "\\":
+                raise PatchParseError(f"Invalid hunk line {i + 1}: {line!r}")
+            if kind != "\\":
+                hunk.lines.append(line)
+            i += 1
+            # The marker can follow the last line of the hunk.
+            if i < len(lines) and lines[i].startswith("\\"):
+                hunk.lines[-1] = hunk.lines[-1].rstrip("\n")
+                i += 1
+        if old_left < 0 or new_left < 0:
+            raise PatchParseError(f"Hunk line counts don't match at line {i}")
+        files[-1].hunks.append(hunk)
+    return files
+
+
+class HunkResult(NamedTuple):
+    """The outcome of applying a hunk."""
+
+    applied: bool
+    line: int | None = None
+    """The line (1-based) of the result the hunk was applied at."""
+    offset: int = 0
+    """The number of lines the hunk was found away from where expected."""
+    fuzz: int = 0
+    """The number of context lines that had to be ignored at each end."""
+
+
+def _find(lines: list[str], old: list[str], expected: int, floor: int) -> int | None:
+    """Finds old in lines at or after floor, as close as possible to the
+    expected position."""
+    last: int = len(lines) - len(old)
+    expected = min(max(expected, floor), max(last, floor))
+    for distance in range(max(expected - floor, last - expected) + 1):
+        for position in (expected - distance, expected + distance):
+            if floor <= position <= last and (
+                lines[position : position + len(old)] == old
+            ):
+                return position
+            if distance == 0:
+                break
+    return None
+
+
+def apply_hunks(
+    lines: list[str], hunks: list[Hunk], max_fuzz: int = 2
+) -> tuple[list[str], list[HunkResult]]:
+    """Applies the hunks to lines, returning the patched lines and the result
+    of each hunk. Hunks that can't be applied are skipped. Like patch, each
+    hunk is looked for where it's expected first and then further away, and
+    if it's not found up to max_fuzz lines of context are ignored."""
+    result: list[str] = list(lines)
+    results: list[HunkResult] = []
+    # Lines added by the hunks applied so far, and the offset the last hunk was
+    # found at, which is carried over as the rest of the file likely moved too.
+    delta: int = 0
+    drift: int = 0
+    floor: int = 0
+    for hunk in hunks:
+        # Pure insertions point to the line before, every other hunk to its
+        # first line.
+        start: int = hunk.old_start if hunk.old_len == 0 else hunk.old_start - 1
+        trimmed: tuple[int, int] | None = None
+        for fuzz in range(max_fuzz + 1):
+            old, new, lead, trail = hunk.trimmed(fuzz)
+            if (lead, trail) == trimmed:
+                # Not enough context for more fuzz.
+                continue
+            trimmed = (lead, trail)
+            expected: int = start + lead + delta + drift
+            position: int | None = _find(result, old, expected, floor)
+            if position is not None:
+                break
+        else:
+            results.append(HunkResult(applied=False))
+            continue
+
+        result[position : position + len(old)] = new
+        drift = position - (start + lead + delta)
+        delta += len(new) - len(old)
+        floor = position + len(new)
+        results.append(
+            HunkResult(
+                applied=True, line=position + 1, offset=position - expected, fuzz=fuzz
+            )
+        )
+    return result, results
+
+
+def apply_patch(
+    text: str, hunks: list[Hunk], max_fuzz: int = 2
+) -> tuple[str, list[HunkResult]]:
+    """Applies the hunks to text. See apply_hunks."""
+    lines, results = apply_hunks(split_lines(text), hunks, max_fuzz)
+    return "".join(lines), results
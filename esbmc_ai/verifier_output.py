@@ -3,15 +3,47 @@
 from abc import abstractmethod
 from functools import cached_property
 from pathlib import Path
-from typing import override
+from typing import Any, Callable, Iterator, Self, override
 
 from langchain_core.load.serializable import Serializable
-from pydantic import Field
+from pydantic import BaseModel, Field, PrivateAttr
 
 from esbmc_ai.program_trace import ProgramTrace
 from esbmc_ai.issue import Issue
 
 
+class ResourceUsage(BaseModel):
+    """Resources used by a verifier process, read from its rusage when it was
+    reaped. The times and peak memory include the children of the process
+    that it waited for, such as solvers."""
+
+    max_rss: int
+    """Peak resident set size in bytes."""
+    user_time: float
+    """CPU time spent in user mode in seconds."""
+    system_time: float
+    """CPU time spent in the kernel in seconds."""
+    kill_reason: str | None = None
+    """Why the process was killed: "stopped" if ESBMC-AI stopped it once the
+    output had what was needed, the name of the signal (such as "SIGXCPU" when
+    the CPU time limit is reached) if it was killed by a signal. None if it
+    exited by itself."""
+
+    @classmethod
+    def combine(cls, usages: list["ResourceUsage | None"]) -> "ResourceUsage | None":
+        """The usage of processes that ran together: the highest peak memory,
+        the total CPU time and the first kill reason."""
+        known: list[ResourceUsage] = [u for u in usages if u is not None]
+        if not known:
+            return None
+        return cls(
+            max_rss=max(u.max_rss for u in known),
+            user_time=sum(u.user_time for u in known),
+            system_time=sum(u.system_time for u in known),
+            kill_reason=next((u.kill_reason for u in known if u.kill_reason), None),
+        )
+
+
 class VerifierOutput(Serializable):
     """Class that represents the verifier output. All properties can be accessed
     directly in templates.
@@ -28,6 +60,67 @@ class VerifierOutput(Serializable):
     """List of issues/errors found during verification."""
     duration: float | None = None
     """Execution time in seconds."""
+    resource_usage: ResourceUsage | None = None
+    """Resources used by the verifier process, None if unknown."""
+
+    _output_loader: Callable[[], str] | None = PrivateAttr(default=None)
+    """Loads the output on first access when it's restored from the cache."""
+
+    @classmethod
+    def from_cache(
+        cls,
+        fields: dict[str, Any],
+        issues: list[Issue],
+        output_loader: Callable[[], str],
+    ) -> Self:
+        """Builds an output restored from the cache. The scalar fields are
+        validated, the issues are used as they are and the output is only
+        loaded once it's accessed."""
+        obj: Self = cls.model_validate(fields | {"output": "", "issues": []})
+        obj.__dict__["issues"] = issues
+        del obj.__dict__["output"]
+        obj._output_loader = output_loader
+        return obj
+
+    def __getattr__(self, name: str) -> Any:
+        if name == "output" and self._output_loader is not None:
+            self.__dict__["output"] = self._output_loader()
+            self._output_loader = None
+            return self.__dict__["output"]
+        return super().__getattr__(name)  # type: ignore[misc]
+
+    def _load_output(self) -> None:
+        """Loads the output if it's pending, so that anything that reads the
+        fields directly sees it."""
+        if "output" not in self.__dict__:
+            _ = self.output
+
+    @override
+    def model_dump(self, **kwargs: Any) -> dict[str, Any]:
+        self._load_output()
+        return super().model_dump(**kwargs)
+
+    @override
+    def model_dump_json(self, **kwargs: Any) -> str:
+        self._load_output()
+        return super().model_dump_json(**kwargs)
+
+    @override
+    def __iter__(self) -> Iterator[tuple[str, Any]]:  # type: ignore[override]
+        self._load_output()
+        return super().__iter__()
+
+    @override
+    def __eq__(self, other: object) -> bool:
+        self._load_output()
+        if isinstance(other, VerifierOutput):
+            other._load_output()
+        return super().__eq__(other)
+
+    @override
+    def __getstate__(self) -> dict[Any, Any]:
+        self._load_output()
+        return super().__getstate__()
 
     @classmethod
     @override
@@ -1,5 +1,12 @@
 from .base_source_verifier import BaseSourceVerifier
 from .esbmc import ESBMC
 from .cmd_oracle import CommandOracle
+from .verifier_service import VerificationJob, VerifierService
 
-__all__ = ["BaseSourceVerifier", "ESBMC", "CommandOracle"]
+__all__ = [
+    "BaseSourceVerifier",
+    "ESBMC",
+    "CommandOracle",
+    "VerificationJob",
+    "VerifierService",
+]
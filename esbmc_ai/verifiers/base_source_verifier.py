@@ -3,21 +3,29 @@
 """This module holds the code for the base source code verifier."""
 
 from abc import abstractmethod
+from contextlib import contextmanager
+from contextvars import ContextVar
+from dataclasses import dataclass
+import os
 from pathlib import Path
+import signal
+import sys
+from threading import Event, Lock, Thread
 from time import perf_counter
-from subprocess import PIPE, STDOUT, run, CompletedProcess
-from typing import Any, override
+from subprocess import PIPE, STDOUT, Popen, CompletedProcess, TimeoutExpired
+from typing import IO, Any, Callable, Iterator, override
 from hashlib import sha256
-import pickle
-import zlib
+import resource
 
 from platformdirs import user_cache_dir
 
 from esbmc_ai.__about__ import __version__ as esbmc_ai_version
 from esbmc_ai.base_component import BaseComponent
+from esbmc_ai.cache import BaseCache, DiskCache, RemoteCache
+from esbmc_ai.cache.serialization import CacheFormatError, dumps, loads
 from esbmc_ai.log_utils import LogCategories
 from esbmc_ai.solution import Solution
-from esbmc_ai.verifier_output import VerifierOutput
+from esbmc_ai.verifier_output import ResourceUsage, VerifierOutput
 
 
 class SourceCodeParseError(Exception):
@@ -30,6 +38,127 @@ class VerifierTimedOutException(Exception):
     determined."""
 
 
+class VerifierCancelledException(Exception):
+    """Error that means that the verifier process was killed because the
+    cancel event of the enclosing cancel scope was set."""
+
+
+_cancel_event: ContextVar[Event | None] = ContextVar("cancel_event", default=None)
+
+
+@contextmanager
+def cancel_scope(event: Event) -> Iterator[None]:
+    """Binds a cancel event to the current thread of execution. Any verifier
+    process started through `BaseSourceVerifier.run_command` inside the scope
+    is killed as soon as the event is set, and `VerifierCancelledException` is
+    raised in place of its result."""
+    token = _cancel_event.set(event)
+    try:
+        yield
+    finally:
+        _cancel_event.reset(token)
+
+
+def current_cancel_event() -> Event | None:
+    """The cancel event of the enclosing cancel scope, if any."""
+    return _cancel_event.get()
+
+
+@dataclass(frozen=True)
+class ProcessLimits:
+    """Resource limits applied to the verifier processes started inside a
+    `process_limits` scope. They are applied before the verifier is executed,
+    so they hold from its first instruction and are inherited by every
+    process it starts."""
+
+    cpus: frozenset[int] | None = None
+    """The CPUs the process is pinned to. None to not pin it."""
+    memory_limit: int | None = None
+    """The address space limit of the process in bytes. None or 0 for no
+    limit."""
+    cpu_time_limit: int | None = None
+    """The CPU time limit of the process in seconds, it is sent SIGXCPU once
+    it is reached. None for no limit."""
+
+    @property
+    def limited(self) -> bool:
+        """If any of the limits is set."""
+        return bool(self.cpus or self.memory_limit or self.cpu_time_limit)
+
+
+_process_limits: ContextVar[ProcessLimits | None] = ContextVar(
+    "process_limits", default=None
+)
+
+
+@contextmanager
+def process_limits(limits: ProcessLimits) -> Iterator[None]:
+    """Binds resource limits to the current thread of execution. Any verifier
+    process started through `BaseSourceVerifier.run_command` inside the scope
+    runs with the limits, in place of the default limits of the verifier."""
+    token = _process_limits.set(limits)
+    try:
+        yield
+    finally:
+        _process_limits.reset(token)
+
+
+# Applies the limits given as arguments (CPUs separated by commas, address
+# space limit in bytes, CPU time limit in seconds, empty or 0 for none) to
+# itself and executes the rest of the arguments. It is run with the interpreter in
+# isolated mode, without the site module, so it starts quickly.
+_LIMITS_WRAPPER: str = """
+import os, resource, sys
+cpus, memory_limit, cpu_time_limit, *cmd = sys.argv[1:]
+if cpus and hasattr(os, "sched_setaffinity"):
+    os.sched_setaffinity(0, {int(cpu) for cpu in cpus.split(",")})
+if memory_limit and int(memory_limit) > 0:
+    resource.setrlimit(resource.RLIMIT_AS, (int(memory_limit), int(memory_limit)))
+if cpu_time_limit:
+    # The hard limit kills the process if it handles SIGXCPU.
+    limit = int(cpu_time_limit)
+    resource.setrlimit(resource.RLIMIT_CPU, (limit, limit + 5))
+try:
+    os.execvp(cmd[0], cmd)
+except OSError as e:
+    print(f"Could not execute {cmd[0]}: {e}", file=sys.stderr)
+    os._exit(127)
+"""
+
+
+def _limited_command(cmd: list[str], limits: ProcessLimits) -> list[str]:
+    """The command that runs cmd with the limits applied before it is executed.
+    A preexec_fn would do the same but it is not safe when other threads are
+    running, which is the case when verifying concurrently, and applying the
+    limits from the parent after the process started leaves a window where the
+    verifier, and any process it starts, runs without them."""
+    return [
+        sys.executable,
+        "-I",
+        "-S",
+        "-c",
+        _LIMITS_WRAPPER,
+        ",".join(str(cpu) for cpu in sorted(limits.cpus or ())),
+        str(limits.memory_limit) if limits.memory_limit else "",
+        "" if limits.cpu_time_limit is None else str(limits.cpu_time_limit),
+        *cmd,
+    ]
+
+
+class VerifierProcess(CompletedProcess):
+    """A verifier process that has ended, with the resources it used."""
+
+    def __init__(
+        self,
+        args: list[str],
+        returncode: int,
+        stdout: bytes,
+        resource_usage: ResourceUsage | None = None,
+    ) -> None:
+        super().__init__(args, returncode, stdout, None)
+        self.resource_usage: ResourceUsage | None = resource_usage
+
+
 class BaseSourceVerifier(BaseComponent):
     """The base class for creating a source verifier for ESBMC-AI. In order for
     this class to work with ESBMC-AI, the constructor must have default values
@@ -55,12 +184,49 @@ class BaseSourceVerifier(BaseComponent):
         super().__init__()
         self._name = verifier_name
         self._authors = authors
+        self._cache: BaseCache | None = None
+        # The verifier service accesses the cache from several threads.
+        self._cache_lock: Lock = Lock()
 
     @property
     def verifier_name(self) -> str:
         """Alias for name"""
         return self.name
 
+    @property
+    def verifier_version(self) -> str:
+        """The version of the underlying verifier, recorded alongside cached
+        results. Override to report the version of the verifier tool."""
+        return ""
+
+    @property
+    def cache(self) -> BaseCache:
+        """The cache backend verification results are stored in, created from
+        the verifier config on first access. If a remote cache is configured,
+        the local cache is placed behind it."""
+        if self._cache is not None:
+            return self._cache
+        with self._cache_lock:
+            if self._cache is None:
+                cache_dir: Path = self.global_config.verifier.cache_dir or Path(
+                    user_cache_dir("esbmc-ai", "Yiannis Charalambous")
+                )
+                cache: BaseCache = DiskCache(
+                    directory=cache_dir,
+                    max_bytes=self.global_config.verifier.cache_max_size,
+                )
+                remote_url: str | None = self.global_config.verifier.cache_remote_url
+                if remote_url:
+                    cache = RemoteCache(url=remote_url, local=cache)
+                # Only published once complete, so other threads never use
+                # the local cache without the remote one in front of it.
+                self._cache = cache
+        return self._cache
+
+    @cache.setter
+    def cache(self, value: BaseCache) -> None:
+        self._cache = value
+
     def _cache_name_pack(self, properties: Any) -> Any:
         """Packs additional version properties to the cache name in order to ensure
         it only functions in the current version of ESBMC-AI."""
@@ -69,66 +235,69 @@ class BaseSourceVerifier(BaseComponent):
     def _compute_cache_id(self, properties: Any) -> str:
         """Compute a stable cache ID from properties using content-based hashing.
 
-        Uses __hash__ methods of objects (e.g., Solution, SourceFile) to create
-        stable, content-based cache keys that work across different file paths
-        and Python processes.
+        Uses the digest or __hash__ methods of objects (e.g., Solution,
+        SourceFile) to create stable, content-based cache keys that work across
+        different file paths and Python processes.
 
-        Uses zlib.adler32 for deterministic hashing of collections instead of
-        Python's hash() which is randomized across processes.
+        Uses SHA256 for deterministic hashing of collections and primitives
+        instead of Python's hash() which is randomized across processes.
         """
         properties = self._cache_name_pack(properties)
 
-        def deterministic_hash(obj: Any) -> int:
-            """Compute deterministic hash using adler32 and custom __hash__ methods.
+        def deterministic_hash(obj: Any) -> str:
+            """Compute deterministic hash using SHA256 and custom __hash__ methods.
 
             For objects with custom __hash__ (like Solution), uses their hash.
-            For collections and primitives, uses adler32 for deterministic hashing.
+            For collections and primitives, hashes their type and value so that
+            for example None and "None" produce different keys.
             """
             if isinstance(obj, (list, tuple)):
                 # Recursively hash elements and combine
-                element_hashes = [str(deterministic_hash(item)) for item in obj]
-                combined = "|".join(element_hashes)
-                return zlib.adler32(combined.encode("utf-8"))
+                element_hashes = [deterministic_hash(item) for item in obj]
+                combined = "list:" + "|".join(element_hashes)
             elif isinstance(obj, (str, int, float, bool, type(None))):
-                # Primitives: use adler32 for deterministic hashing
-                # (Python's hash() for str is randomized!)
-                return zlib.adler32(str(obj).encode("utf-8"))
+                # Primitives: (Python's hash() for str is randomized!)
+                combined = f"{type(obj).__name__}:{obj}"
+            elif isinstance(getattr(obj, "digest", None), str):
+                # Content digest (e.g., Solution, SourceFile), more bits than hash()
+                combined = f"digest:{obj.digest}"
             elif hasattr(obj, "__hash__") and type(obj).__hash__ is not object.__hash__:
                 # Object has custom __hash__ method (e.g., Solution, SourceFile)
                 # These are already content-based and deterministic (SHA256-based)
-                return hash(obj)
+                combined = f"hash:{hash(obj)}"
             else:
-                # Fallback: use adler32 of string representation
-                return zlib.adler32(str(obj).encode("utf-8"))
+                # Fallback: use string representation
+                combined = f"str:{obj}"
+            return sha256(combined.encode("utf-8")).hexdigest()
 
-        cache_hash = deterministic_hash(properties)
-        return sha256(str(cache_hash).encode("utf-8")).hexdigest()
+        return deterministic_hash(properties)
 
-    def _save_cached(self, properties: Any, result: Any) -> None:
-        """Saves the verification results to a cached directory to be loaded
-        later. Properties are going to be hashed to form the name of the file,
-        they should be anything that defines the file."""
+    def _save_cached(self, properties: Any, result: VerifierOutput) -> None:
+        """Saves the verification results to the cache to be loaded later.
+        Properties are going to be hashed to form the cache key, they should
+        be anything that defines the result."""
         file_id: str = self._compute_cache_id(properties)
         self.logger.info("Saving result to cache")
         self.logger.info(f"Cache ID: {file_id}")
 
-        cache: Path = Path(user_cache_dir("esbmc-ai", "Yiannis Charalambous"))
-        cache.mkdir(parents=True, exist_ok=True)
-        with open(cache / file_id, "wb") as file:
-            pickle.dump(obj=result, file=file, protocol=-1)
+        data: bytes = dumps(result)
+        self.cache.put(file_id, data, version=self.verifier_version)
 
-    def _load_cached(self, properties: Any) -> Any:
-        """Loads the verification results from a cached directory."""
+    def _load_cached(self, properties: Any) -> VerifierOutput | None:
+        """Loads the verification results from the cache. Entries that were
+        written in an older format or with a different schema are misses."""
         file_id: str = self._compute_cache_id(properties)
         self.logger.info(f"Searching cache ID: {file_id}")
 
-        cache: Path = Path(user_cache_dir("esbmc-ai", "Yiannis Charalambous"))
-        filename: Path = cache / file_id
-        if cache.exists() and filename.exists() and filename.is_file():
-            with open(filename, "rb") as file:
-                data: bytes = pickle.load(file=file)
+        data: bytes | None = self.cache.get(file_id)
+        if data is not None:
+            try:
+                result: VerifierOutput = loads(data)
+            except CacheFormatError as e:
+                self.logger.info(f"Ignoring incompatible cache entry: {e}")
+            else:
                 self.logger.info("Using cached result")
-                return data
+                return result
 
         self.logger.info("Cache not found...")
         return None
@@ -143,29 +312,183 @@ class BaseSourceVerifier(BaseComponent):
         _ = solution
         raise NotImplementedError()
 
+    def default_process_limits(self) -> ProcessLimits:
+        """The limits of the verifier processes started outside of a
+        `process_limits` scope, such as by a sequential repair, from the
+        verifier config. The processes are only pinned to CPUs when verifying
+        concurrently."""
+        config = self.global_config.verifier
+        return ProcessLimits(
+            memory_limit=config.memory_limit,
+            cpu_time_limit=config.cpu_time_limit,
+        )
+
+    CANCEL_POLL_INTERVAL: float = 0.1
+    """How often (seconds) a running verifier process checks its cancel event."""
+
     def run_command(
         self,
         cmd: list[str],
         cwd: Path,
         process_timeout: float | None,
-    ) -> tuple[CompletedProcess, float]:
-        """Runs the verifier."""
+        on_output: Callable[[bytes], None] | None = None,
+        stop_event: Event | None = None,
+    ) -> tuple[VerifierProcess, float]:
+        """Runs the verifier. The returned process has the resources used by
+        the verifier in resource_usage.
+
+        If on_output is given, it is called from a reader thread with each
+        chunk of output as the verifier writes it, and the output is not
+        collected: the stdout of the returned process is empty.
+
+        If stop_event is set while the process is running, the process group
+        of the verifier is killed and the result is returned as it is, this is
+        used to stop the verifier once the output has what is needed.
+
+        Raises:
+            TimeoutExpired: If the process exceeds the timeout (plus slack).
+            VerifierCancelledException: If the enclosing cancel scope is
+                cancelled while the process is running.
+
+        The process is started with the limits of the enclosing
+        `process_limits` scope, or the default_process_limits if there is
+        none, through a wrapper that applies them before executing the
+        verifier. A verifier that can't be executed then exits with 127
+        instead of raising FileNotFoundError."""
 
         # Add slack time to process to allow verifier to timeout and end gracefully.
         process_timeout = process_timeout + 5 if process_timeout else None
+        cancel_event: Event | None = _cancel_event.get()
+        limits: ProcessLimits = (
+            _process_limits.get() or self.default_process_limits()
+        )
+        if cancel_event is not None and cancel_event.is_set():
+            raise VerifierCancelledException()
+
         # Measure execution time
         start_time = perf_counter()
 
-        # Run ESBMC from solution working_dir and get output
-        process: CompletedProcess = run(
-            cmd,
+        # Run ESBMC from solution working_dir and get output. The output is
+        # read by a thread so that the cancel event can be polled, and the
+        # process is reaped with wait4 to get its resource usage.
+        chunks: list[bytes] = []
+        reader_errors: list[BaseException] = []
+        usage: ResourceUsage | None = None
+        kill_reason: str | None = None
+        # The verifier leads its own process group, so that any processes it
+        # starts (such as solvers) are killed with it.
+        with Popen(
+            _limited_command(cmd, limits) if limits.limited else cmd,
             cwd=cwd,
-            timeout=process_timeout,
             stdout=PIPE,
             stderr=STDOUT,
-            check=False,
-        )
+            process_group=0,
+        ) as proc:
+            reader: Thread = Thread(
+                target=_pump_output,
+                args=(proc.stdout, on_output or chunks.append, reader_errors),
+                daemon=True,
+            )
+            reader.start()
+
+            def reap() -> None:
+                """Waits for the process and reads its resource usage. The
+                return code is set on proc, so Popen doesn't wait for it."""
+                nonlocal usage
+                _, status, rusage = os.wait4(proc.pid, 0)
+                proc.returncode = os.waitstatus_to_exitcode(status)
+                usage = _resource_usage(rusage, proc.returncode, kill_reason)
+
+            def kill(reason: str) -> None:
+                """Kills the process group and waits for the rest of the
+                output."""
+                nonlocal kill_reason
+                kill_reason = reason
+                try:
+                    os.killpg(proc.pid, signal.SIGKILL)
+                except ProcessLookupError:
+                    pass
+                reap()
+                reader.join()
+
+            while True:
+                # The reader ends when the output is closed.
+                reader.join(timeout=self.CANCEL_POLL_INTERVAL)
+                if not reader.is_alive():
+                    reap()
+                    break
+                elapsed: float = perf_counter() - start_time
+                if process_timeout and elapsed > process_timeout:
+                    kill("timeout")
+                    self._log_usage("Timed out", proc.pid, usage)
+                    raise TimeoutExpired(cmd, process_timeout)
+                if cancel_event is not None and cancel_event.is_set():
+                    kill("cancelled")
+                    self._log_usage("Cancelled", proc.pid, usage)
+                    raise VerifierCancelledException()
+                if stop_event is not None and stop_event.is_set():
+                    self.logger.info(f"Stopped verifier process {proc.pid}")
+                    kill("stopped")
+                    break
 
         duration: float = perf_counter() - start_time
 
-        return process, duration
+        if reader_errors:
+            raise reader_errors[0]
+
+        return (
+            VerifierProcess(
+                args=cmd,
+                returncode=proc.returncode,
+                stdout=b"".join(chunks),
+                resource_usage=usage,
+            ),
+            duration,
+        )
+
+    def _log_usage(
+        self, action: str, pid: int, usage: ResourceUsage | None
+    ) -> None:
+        if usage is None:
+            self.logger.info(f"{action} verifier process {pid}")
+            return
+        self.logger.info(
+            f"{action} verifier process {pid} after {usage.user_time:.2f}s user, "
+            f"{usage.system_time:.2f}s system, {usage.max_rss} bytes peak RSS"
+        )
+
+
+def _resource_usage(
+    rusage: resource.struct_rusage, returncode: int, kill_reason: str | None
+) -> ResourceUsage:
+    """Converts the rusage of a reaped process. A process killed by a signal
+    that ESBMC-AI didn't send has the name of the signal as kill reason."""
+    if kill_reason is None and returncode < 0:
+        try:
+            kill_reason = signal.Signals(-returncode).name
+        except ValueError:
+            kill_reason = f"signal {-returncode}"
+    return ResourceUsage(
+        # ru_maxrss is in kilobytes on Linux and in bytes on macOS.
+        max_rss=rusage.ru_maxrss * (1 if sys.platform == "darwin" else 1024),
+        user_time=rusage.ru_utime,
+        system_time=rusage.ru_stime,
+        kill_reason=kill_reason,
+    )
+
+
+def _pump_output(
+    stream: IO[bytes],
+    on_output: Callable[[bytes], None],
+    errors: list[BaseException],
+) -> None:
+    """Passes the output of a process to on_output until it is closed. If
+    on_output raises, the rest of the output is drained so that the process
+    does not block on a full pipe."""
+    while chunk := stream.read1(1 << 16):  # type: ignore[attr-defined]
+        if errors:
+            continue
+        try:
+            on_output(chunk)
+        except BaseException as e:
+            errors.append(e)
@@ -3,18 +3,20 @@
 from collections import defaultdict
 import re
 from dataclasses import dataclass
-from subprocess import CompletedProcess
 from typing import DefaultDict, Literal, cast, override
 from pathlib import Path
 from pydantic import Field
 
+from esbmc_ai.cache.serialization import register_class
 from esbmc_ai.issue import Issue
 from esbmc_ai.solution import Solution
 from esbmc_ai.program_trace import ProgramTrace
 from esbmc_ai.verifier_output import VerifierOutput
 from esbmc_ai.verifiers import BaseSourceVerifier
+from esbmc_ai.verifiers.base_source_verifier import VerifierProcess
 
 
+@register_class
 class CommandOracleVerifierOutput(VerifierOutput):
     """
     Provides raw output, the issue will be 1 if successful is false.
@@ -280,7 +282,7 @@ class CommandOracle(BaseSourceVerifier):
         # Build the variables: {files} and {ifiles}
         cmd: str = self._cmd_formatted(solution)
 
-        result: CompletedProcess
+        result: VerifierProcess
         duration: float
         result, duration = self.run_command(
             cmd=cmd.split(" "),
@@ -298,9 +300,13 @@ class CommandOracle(BaseSourceVerifier):
                 "Please configure manually..."
             )
 
-        return CommandOracleOutputParser(spec).parse_output(
+        output: CommandOracleVerifierOutput = CommandOracleOutputParser(
+            spec
+        ).parse_output(
             exit_success=self._global_config.verifier.command_oracle.exit_success,
             return_code=result.returncode,
             output=result.stdout.decode("utf-8"),
             duration=duration,
         )
+        output.resource_usage = result.resource_usage
+        return output
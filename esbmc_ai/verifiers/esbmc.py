@@ -1,20 +1,59 @@
 # Author: Yiannis Charalambous
 
+from bisect import bisect_left
+import codecs
+from collections import deque
+from concurrent.futures import FIRST_COMPLETED, Future, ThreadPoolExecutor, wait
+from contextvars import copy_context
+from dataclasses import dataclass
+import os
 import signal
 import re
-from functools import cached_property
-from subprocess import CompletedProcess
+from hashlib import sha256
+import json
+from math import ceil, floor
+from functools import cache, cached_property, partial
+from subprocess import (
+    PIPE,
+    STDOUT,
+    CompletedProcess,
+    SubprocessError,
+    TimeoutExpired,
+    run,
+)
+from shutil import rmtree
+from tempfile import mkdtemp, mkstemp
 from pathlib import Path
-from typing import NamedTuple, cast
+from threading import Event
+from typing import Callable, NamedTuple, cast
 from typing_extensions import Any, override
 
 from pydantic import BaseModel
 
-from esbmc_ai.solution import Solution, SolutionIntegrityError
+from esbmc_ai.cache.serialization import register_class
+from esbmc_ai.config import ESBMC_ITERATIVE_PARAMS
+from esbmc_ai.function_slices import SolutionSlices
+from esbmc_ai.solution import (
+    Solution,
+    SolutionIntegrityError,
+    SourceFile,
+    file_digest,
+)
 
-from esbmc_ai.verifier_output import VerifierOutput
-from esbmc_ai.verifiers.base_source_verifier import BaseSourceVerifier
+from esbmc_ai.verifier_output import ResourceUsage, VerifierOutput
+from esbmc_ai.verifiers.base_source_verifier import (
+    BaseSourceVerifier,
+    VerifierCancelledException,
+    VerifierProcess,
+    cancel_scope,
+    current_cancel_event,
+)
 from esbmc_ai.verifiers.clang import ClangOutputParser
+from esbmc_ai.verifiers.esbmc_witness import (
+    ESBMCWitness,
+    WitnessParseError,
+    parse_witness,
+)
 from esbmc_ai.program_trace import ProgramTrace, CounterexampleProgramTrace
 from esbmc_ai.issue import Issue, VerifierIssue
 
@@ -25,20 +64,113 @@ _ANSI_ESCAPE_PATTERN = re.compile(r"\x1b\[[0-9;]*m")
 _STACK_TRACE_PATTERN = re.compile(
     r"\s+.+\s+at file (\S+) line (\d+) column \d+ function (\S+)"
 )
-_VIOLATED_PROPERTY_PATTERN = re.compile(
-    r"Violated property:\s+file (\S+) line (\d+) column \d+ function (\S+)",
-    re.DOTALL,
-)
 _TRACE_LINE_BASE_PATTERN = re.compile(
     r"State (\d+) file (\S+) line (\d+)(?:.+) thread (\d+)\n[-]+\n?(.*)?", re.DOTALL
 )
-# Pattern for finding counterexample states in full text (non-greedy, stops at blank lines)
-_COUNTEREXAMPLE_STATE_PATTERN = re.compile(
-    r"State (\d+) file (\S+) line (\d+)(?:.+?) thread (\d+)\n[-]+\n(.*?)(?=\n\n|\nViolated|\Z)",
-    re.DOTALL,
-)
 _TRACE_FUNCTION_PATTERN = re.compile(r" function (\S+)")
+# Line patterns of the streaming parser.
+_STATE_HEADER_PATTERN = re.compile(
+    r"State (\d+) file (\S+) line (\d+).+? thread (\d+)$"
+)
+_STATE_SEPARATOR_PATTERN = re.compile(r"-+")
+_VIOLATED_LOCATION_PATTERN = re.compile(
+    r"\s+file (\S+) line (\d+) column \d+ function (\S+)"
+)
 _TRACE_ERROR_LINE_PATTERN = re.compile(r"State (?:.+)\n[-]+\n?(.*)?", re.DOTALL)
+# Claims listed by --show-claims.
+_CLAIM_PATTERN = re.compile(r"^Claim (\d+):", re.MULTILINE)
+# Stands for the working dir in cached preprocessed units.
+_WORKING_DIR_PLACEHOLDER: str = "@ESBMC_AI_WORKING_DIR@/"
+# Line markers of preprocessed code, which name the files the code came from.
+_LINE_MARKER_PATTERN = re.compile(
+    r'^#(?:line)? \d+ "((?:[^"\\]|\\.)*)"', re.MULTILINE
+)
+# Parameters that don't change the preprocessed code, mapped to whether they
+# take a value.
+_NON_PREPROCESSING_PARAMS: dict[str, bool] = {
+    "--unwind": True,
+    "--claim": True,
+    "--memlimit": True,
+    "--multi-property": False,
+}
+
+
+# Consecutive lines that start with whitespace.
+_INDENTED_LINES_PATTERN = re.compile(r"(?:[^\S\n][^\n]*(?:\n|\Z))*")
+
+
+@dataclass(frozen=True)
+class ESBMCOutputIndex:
+    """Offsets of the sections of ESBMC output, recorded by ESBMCStreamParser
+    in the same pass that parses the issues. The sections slice the output
+    using the index rather than scanning it again for each marker."""
+
+    output: str
+    """The output without ANSI color codes, the offsets index this."""
+    counterexamples: list[int]
+    """Offsets of the [Counterexample] markers, each section ends at the
+    next one."""
+    violated_properties: list[int]
+    """Offsets of the "Violated property:" markers."""
+    stack_traces: list[int]
+    """Offsets of the "Stack trace:" markers."""
+    status: tuple[int, int] | None
+    """Span of the last VERIFICATION status, to the end of its line."""
+    parsing_error: bool
+    """ESBMC reported a parsing (compilation) error."""
+
+    @staticmethod
+    def build(output: str) -> "ESBMCOutputIndex":
+        """Indexes the raw output of ESBMC with ESBMCStreamParser, without
+        parsing the issues."""
+        parser = ESBMCStreamParser(parse_issues=False)
+        parser.feed(output)
+        parser.close()
+        return parser.index
+
+    def counterexample_sections(self) -> list[tuple[int, int]]:
+        """The spans of the counterexample sections."""
+        ends: list[int] = self.counterexamples[1:] + [len(self.output)]
+        return list(zip(self.counterexamples, ends))
+
+    @staticmethod
+    def _between(offsets: list[int], start: int, end: int) -> list[int]:
+        return offsets[bisect_left(offsets, start) : bisect_left(offsets, end)]
+
+    def _is_line(self, offset: int, marker: str, end: int) -> bool:
+        """The marker at offset is a line of its own."""
+        marker_end: int = offset + len(marker)
+        return (offset == 0 or self.output[offset - 1] == "\n") and (
+            marker_end == end or self.output[marker_end] == "\n"
+        )
+
+    def indented_lines_after(
+        self,
+        offsets: list[int],
+        marker: str,
+        start: int = 0,
+        end: int | None = None,
+    ) -> list[str]:
+        """The stripped indented lines after the first line in [start, end)
+        that is the marker, which ESBMC uses for sections such as:
+
+            Stack trace:
+              indented line 1
+              indented line 2"""
+        end = len(self.output) if end is None else end
+        for offset in self._between(offsets, start, end):
+            if self._is_line(offset, marker, end):
+                block_match = _INDENTED_LINES_PATTERN.match(
+                    self.output, offset + len(marker) + 1, end
+                )
+                if not block_match:
+                    return []
+                return [
+                    line.strip()
+                    for line in block_match.group(0).split("\n")
+                    if line
+                ]
+        return []
 
 
 class ESBMCOutputParser:
@@ -60,36 +192,6 @@ class ESBMCOutputParser:
         method_name: str
         thread_index: int
 
-    @staticmethod
-    def _extract_indented_lines_after(output: str, marker: str) -> list[str]:
-        """Extract indented lines after a marker.
-
-        This is a shared utility used by both ESBMCOutputParser and ESBMCOutputSections
-        to parse sections of ESBMC output that follow the pattern:
-            Marker:
-              indented line 1
-              indented line 2
-              ...
-
-        Args:
-            output: The text to search
-            marker: The marker line to find (exact match)
-
-        Returns:
-            List of indented lines (stripped) after the marker
-        """
-        lines = output.splitlines()
-        for i, line in enumerate(lines):
-            if line == marker:
-                indented_lines = []
-                for line in lines[i + 1 :]:
-                    if line and line[0].isspace():
-                        indented_lines.append(line.strip())
-                    else:
-                        break
-                return indented_lines
-        return []
-
     @staticmethod
     def parse_output(
         return_code: int,
@@ -109,48 +211,9 @@ class ESBMCOutputParser:
         Returns:
             ESBMCOutput with all parsed issues and traces
         """
-        # Strip ANSI color codes before parsing to ensure regex patterns match correctly
-        clean_output = _ANSI_ESCAPE_PATTERN.sub("", output)
-        issues = ESBMCOutputParser._parse_issues(clean_output)
-        return ESBMCOutput(
-            return_code=return_code,
-            output=clean_output,
-            issues=issues,
-            duration=duration,
-        )
-
-    @staticmethod
-    def _split_counterexample_sections(output: str) -> list[str]:
-        """Split ESBMC output into individual counterexample sections."""
-        parts = output.split("[Counterexample]")
-        if len(parts) <= 1:
-            return []
-        return ["[Counterexample]" + part for part in parts[1:]]
-
-    @staticmethod
-    def _parse_issues(output: str) -> list[Issue]:
-        """Parse ESBMC output and create Issue objects. Extracts all issues without filtering."""
-        # Check for parsing/compilation errors - delegate to Clang parser
-        if "ERROR: PARSING ERROR" in output:
-            return ClangOutputParser.parse_diagnostics(output)
-
-        # Check for verification failures (counterexamples)
-        if "[Counterexample]" in output:
-            counterexample_sections = ESBMCOutputParser._split_counterexample_sections(
-                output
-            )
-
-            # Parse each counterexample section into an issue
-            issues: list[Issue] = []
-            for section in counterexample_sections:
-                issue = ESBMCOutputParser._parse_verification_failure(section)
-                if issue:
-                    issues.append(issue)
-
-            return issues
-
-        # No issues found
-        return []
+        parser = ESBMCStreamParser()
+        parser.feed(output)
+        return parser.to_output(return_code, duration)
 
     @staticmethod
     def _should_include_trace(trace: ProgramTrace, solution: Solution) -> bool:
@@ -204,18 +267,92 @@ class ESBMCOutputParser:
             filtered_issues.append(new_issue)
 
         # Return new ESBMCOutput with filtered issues
-        return ESBMCOutput(
+        result = ESBMCOutput(
             return_code=esbmc_output.return_code,
             output=esbmc_output.output,
             issues=filtered_issues,
             duration=esbmc_output.duration,
+            resource_usage=esbmc_output.resource_usage,
+            truncated=esbmc_output.truncated,
+            profile=esbmc_output.profile,
+        )
+        # The output is the same, so is its index.
+        if "output_index" in esbmc_output.__dict__:
+            result.__dict__["output_index"] = esbmc_output.output_index
+        return result
+
+    @staticmethod
+    def merge_outputs(outputs: list["ESBMCOutput"]) -> "ESBMCOutput":
+        """Merges the outputs of ESBMC processes that checked different claims
+        of the same program into one output, as if one process had checked
+        them all.
+
+        The verification fails if any process found a violated property,
+        otherwise the first other error is kept. The outputs of the failed
+        processes are placed last, so that the status of the merged output is
+        the one of the verification. The duration is the one of the slowest
+        process, as they run at the same time, the resource usage is the one
+        of all the processes.
+        """
+        outputs = sorted(outputs, key=lambda output: output.return_code == 1)
+        return_codes: list[int] = [output.return_code for output in outputs]
+        durations: list[float] = [
+            output.duration for output in outputs if output.duration is not None
+        ]
+        return ESBMCOutput(
+            return_code=(
+                1
+                if 1 in return_codes
+                else next((code for code in return_codes if code != 0), 0)
+            ),
+            output="\n".join(output.output for output in outputs),
+            issues=[issue for output in outputs for issue in output.issues],
+            duration=max(durations) if durations else None,
+            resource_usage=ResourceUsage.combine(
+                [output.resource_usage for output in outputs]
+            ),
+            truncated=any(output.truncated for output in outputs),
         )
 
     @staticmethod
-    def _parse_verification_failure(output: str) -> Issue | None:
-        """Parse verification failure with counterexample into VerifierIssue."""
+    def apply_witness(
+        esbmc_output: "ESBMCOutput", witness: ESBMCWitness
+    ) -> "ESBMCOutput | None":
+        """Sets the counterexample of the witness to the issue of the violated
+        property. ESBMC writes the witness of the first violated property only,
+        which is the first issue with a stack trace.
+
+        Returns:
+            New ESBMCOutput with the counterexample of the witness, or None if
+            the output has no issue for the witness.
+        """
+        issues: list[Issue] = list(esbmc_output.issues)
+        for idx, issue in enumerate(issues):
+            if isinstance(issue, VerifierIssue):
+                issues[idx] = issue.model_copy(
+                    update={"counterexample": witness.counterexample}
+                )
+                break
+        else:
+            return None
+
+        result = esbmc_output.model_copy(update={"issues": issues})
+        result.__dict__.pop("primary_issue", None)
+        return result
+
+    @staticmethod
+    def _make_verification_failure(
+        stack_trace_lines: list[str],
+        violated_property: str | None,
+        stack_trace: list[ProgramTrace],
+        counterexample: list[CounterexampleProgramTrace],
+    ) -> Issue | None:
+        """Creates the VerifierIssue of a counterexample section from its
+        parsed parts, shared by the batch and the streaming parsers."""
         # Extract both error type and message in one pass
-        error_type, message = ESBMCOutputParser._extract_error_info(output)
+        error_type, message = ESBMCOutputParser._error_info_from_lines(
+            stack_trace_lines
+        )
 
         # Apply fallbacks if extraction failed
         if not error_type:
@@ -223,14 +360,7 @@ class ESBMCOutputParser:
 
         if not message:
             # Fallback to violated property or error type
-            violated_prop = ESBMCOutputParser._extract_violated_property_section(output)
-            message = violated_prop or error_type
-
-        # Parse stack trace (from --show-stacktrace output)
-        stack_trace = ESBMCOutputParser._parse_stack_trace(output)
-
-        # Parse counterexample traces
-        counterexample = ESBMCOutputParser._parse_counterexample_traces(output)
+            message = violated_property or error_type
 
         # If no explicit stack trace, use only the final counterexample element (error location)
         if not stack_trace and counterexample:
@@ -249,25 +379,19 @@ class ESBMCOutputParser:
         return None
 
     @staticmethod
-    def _extract_error_info(output: str) -> tuple[str | None, str | None]:
-        """Extract both error type and message from Stack trace section.
-
-        Returns error type (category) and message (details) from the error
-        description lines. Parses once and extracts both pieces of information.
-
-        Returns:
-            Tuple of (error_type, error_message)
+    def _error_info_from_lines(
+        indented_lines: list[str],
+    ) -> tuple[str | None, str | None]:
+        """Extract the error type and message from the indented lines of the
+        Stack trace section. The error type is the category before the first
+        colon and the message the rest, with the following lines.
 
         Examples:
             "dereference failure: array bounds violated":
                 ("dereference failure", "array bounds violated")
-            "array bounds violated: array `dist' upper bound" + "(signed long int)i < 5":
-                ("array bounds violated", "array `dist' upper bound: (signed long int)i < 5")
+            "array bounds violated: array `dist' upper bound", "i < 5":
+                ("array bounds violated", "array `dist' upper bound: i < 5")
         """
-        indented_lines = ESBMCOutputParser._extract_indented_lines_after(
-            output, "Stack trace:"
-        )
-
         if not indented_lines:
             return None, None
 
@@ -296,137 +420,6 @@ class ESBMCOutputParser:
 
         return error_type, error_message
 
-    @staticmethod
-    def _parse_counterexample_traces(output: str) -> list[CounterexampleProgramTrace]:
-        """Parse counterexample section into CounterexampleProgramTrace objects.
-        Extracts ALL traces without filtering.
-        """
-        # Find counterexample section
-        try:
-            ce_start = output.index("[Counterexample]")
-        except ValueError:
-            return []
-
-        counterexample_section = output[ce_start:]
-        traces: list[CounterexampleProgramTrace] = []
-
-        # Use regex to find all state blocks in the counterexample
-        for trace_idx, match in enumerate(
-            _COUNTEREXAMPLE_STATE_PATTERN.finditer(counterexample_section)
-        ):
-            try:
-                trace_results = ESBMCOutputParser._parse_trace_line(match.group(0))
-            except ValueError:
-                # Skip trace lines that cannot be parsed
-                continue
-
-            if trace_results:
-                # Clean up the assignment string
-                assignment = (
-                    trace_results.error_line.strip()
-                    if trace_results.error_line
-                    else None
-                )
-
-                traces.append(
-                    CounterexampleProgramTrace(
-                        trace_index=trace_idx,
-                        path=trace_results.filename,
-                        line_idx=trace_results.line_number - 1,  # Convert to 0-based
-                        name=(
-                            trace_results.method_name
-                            if trace_results.method_name
-                            else None
-                        ),
-                        assignment=assignment,
-                    )
-                )
-
-        return traces
-
-    @staticmethod
-    def _parse_stack_trace(output: str) -> list[ProgramTrace]:
-        """Parse stack trace section from ESBMC output (--show-stacktrace).
-
-        Extracts ALL traces without filtering.
-
-        Expected format:
-            Violated property:
-              file <path> line <num> column <col> function <func>
-            Stack trace:
-              c:@F@function_name at file path.c line N column C function caller
-              c:@F@main
-
-        Returns:
-            List of ProgramTrace objects representing the call stack,
-            with the error location (from Violated property) as the final element
-        """
-        # Find "Stack trace:" marker
-        try:
-            stack_idx = output.index("Stack trace:")
-        except ValueError:
-            # No stack trace present (--show-stacktrace not used)
-            return []
-
-        # Find the end of the stack trace section (next blank line or end of counterexample)
-        stack_start = stack_idx + len("Stack trace:\n")
-        lines = output[stack_start:].split("\n")
-
-        traces: list[ProgramTrace] = []
-        trace_idx = 0
-
-        # Pattern to match stack trace lines with file information
-        # Format: "  symbol at file <path> line <num> column <col> function <func>"
-        for line in lines:
-            # Stop at blank line or end of section
-            if not line.strip():
-                break
-
-            # Try to parse the line
-            match = _STACK_TRACE_PATTERN.search(line)
-            if match:
-                file_path = Path(match.group(1))
-                line_number = int(match.group(2))
-                function_name = match.group(3)
-
-                traces.append(
-                    ProgramTrace(
-                        trace_index=trace_idx,
-                        path=file_path,
-                        line_idx=line_number - 1,  # Convert to 0-based
-                        name=function_name,
-                    )
-                )
-                trace_idx += 1
-
-        # Extract error location from "Violated property:" line and add as final trace
-        # Format: "  file <path> line <num> column <col> function <func>"
-        match = _VIOLATED_PROPERTY_PATTERN.search(output[:stack_idx])
-        if match:
-            file_path = Path(match.group(1))
-            line_number = int(match.group(2))
-            function_name = match.group(3)
-
-            traces.append(
-                ProgramTrace(
-                    trace_index=trace_idx,
-                    path=file_path,
-                    line_idx=line_number - 1,  # Convert to 0-based
-                    name=function_name,
-                )
-            )
-
-        return traces
-
-    @staticmethod
-    def _extract_violated_property_section(output: str) -> str | None:
-        """Gets the violated property line from ESBMC output string."""
-        indented_lines = ESBMCOutputParser._extract_indented_lines_after(
-            output, "Violated property:"
-        )
-        # Return the first indented line (the file/line/function info)
-        return indented_lines[0] if indented_lines else None
-
     @staticmethod
     def _parse_trace_line(
         line: str,
@@ -484,6 +477,386 @@ class ESBMCOutputParser:
         )
 
 
+class _CounterexampleSection:
+    """Parse state of one counterexample section of the streaming parser. Holds
+    only the parsed traces and the few lines needed to build the issue."""
+
+    def __init__(self) -> None:
+        self.counterexample: list[CounterexampleProgramTrace] = []
+        self.state_count: int = 0
+        # Header of the state block being parsed and its body lines, body is
+        # None until the separator line is seen.
+        self.state_header: str | None = None
+        self.state_separator: str = ""
+        self.state_body: list[str] | None = None
+
+        self.stack_trace: list[ProgramTrace] | None = None
+        self.in_stack_trace: bool = False
+        self.violated_location: ProgramTrace | None = None
+        self.expect_violated_location: bool = False
+
+        self.stack_trace_lines: list[str] | None = None
+        self.in_stack_trace_lines: bool = False
+        self.violated_property: str | None = None
+        self.expect_violated_property: bool = False
+        self.seen_violated_property: bool = False
+
+
+class ESBMCStreamParser:
+    """Parser of the output of ESBMC that consumes it as it is written, one
+    line at a time, and indexes its sections (ESBMCOutputIndex) in the same
+    pass. ESBMCOutputParser.parse_output feeds it the complete output.
+
+    Counterexample states are parsed as soon as they are complete and
+    reported through on_trace, complete issues are reported through on_issue.
+    on_violation is called as soon as the stack trace of a violated property
+    has been read, which is the end of the counterexample, ESBMC may keep
+    running after it.
+    With parse_states off the counterexample states are skipped, for when
+    they are read from the witness instead. With parse_issues off only the
+    index is built.
+    Only the last max_output_size characters of the raw output are kept, so
+    the memory used does not grow with the size of the counterexample.
+
+    Usage: call feed with chunks of output, then close, then to_output."""
+
+    def __init__(
+        self,
+        on_trace: Callable[[CounterexampleProgramTrace], None] | None = None,
+        on_issue: Callable[[Issue], None] | None = None,
+        on_violation: Callable[[], None] | None = None,
+        max_output_size: int | None = None,
+        parse_states: bool = True,
+        parse_issues: bool = True,
+    ) -> None:
+        self.on_trace = on_trace
+        self.on_issue = on_issue
+        self.on_violation = on_violation
+        self.max_output_size: int | None = max_output_size
+        self.parse_states: bool = parse_states
+        self.parse_issues: bool = parse_issues
+        self.issues: list[Issue] = []
+        self.parsing_error: bool = False
+        self.omitted_chars: int = 0
+        """Number of characters dropped from the start of the output."""
+
+        self._decoder = codecs.getincrementaldecoder("utf-8")(errors="replace")
+        self._partial_line: str = ""
+        self._tail: deque[str] = deque()
+        self._tail_size: int = 0
+        self._section: _CounterexampleSection | None = None
+        self._closed: bool = False
+
+        # Offsets of the markers in the whole output, see ESBMCOutputIndex.
+        self._offset: int = 0
+        self._counterexamples: list[int] = []
+        self._violated_properties: list[int] = []
+        self._stack_traces: list[int] = []
+        self._status: tuple[int, int] | None = None
+
+    @property
+    def output(self) -> str:
+        """The retained output, without ANSI color codes."""
+        tail: str = "".join(self._tail)
+        if self.omitted_chars:
+            return f"[... {self.omitted_chars} characters omitted ...]\n" + tail
+        return tail
+
+    @property
+    def index(self) -> ESBMCOutputIndex:
+        """The index of the retained output, complete once the parser is
+        closed. Markers in the omitted part of the output are left out."""
+        output: str = self.output
+        # Offset in the whole output of the start of the retained output.
+        start: int = self.omitted_chars - (len(output) - self._tail_size)
+
+        def retained(offsets: list[int]) -> list[int]:
+            return [
+                offset - start
+                for offset in offsets[bisect_left(offsets, self.omitted_chars) :]
+            ]
+
+        return ESBMCOutputIndex(
+            output=output,
+            counterexamples=retained(self._counterexamples),
+            violated_properties=retained(self._violated_properties),
+            stack_traces=retained(self._stack_traces),
+            status=(
+                (self._status[0] - start, self._status[1] - start)
+                if self._status and self._status[0] >= self.omitted_chars
+                else None
+            ),
+            parsing_error=self.parsing_error,
+        )
+
+    def feed(self, data: bytes | str) -> None:
+        """Parses a chunk of output. Chunks don't need to end at a line."""
+        text: str = self._decoder.decode(data) if isinstance(data, bytes) else data
+        if not text:
+            return
+        lines: list[str] = (self._partial_line + text).split("\n")
+        self._partial_line = lines.pop()
+        for line in lines:
+            if "\x1b" in line:
+                line = _ANSI_ESCAPE_PATTERN.sub("", line)
+            self._feed_line(line, "\n")
+
+    def close(self) -> None:
+        """Parses the rest of the output and completes the last issue."""
+        if self._closed:
+            return
+        self._closed = True
+        self._partial_line += self._decoder.decode(b"", final=True)
+        if self._partial_line:
+            self._feed_line(_ANSI_ESCAPE_PATTERN.sub("", self._partial_line), "")
+            self._partial_line = ""
+        self._end_section()
+
+        # Compilation errors take precedence.
+        if self.parsing_error and self.parse_issues:
+            self.issues = ClangOutputParser.parse_diagnostics(self.output)
+
+    def to_output(
+        self,
+        return_code: int,
+        duration: float | None = None,
+        truncated: bool = False,
+    ) -> "ESBMCOutput":
+        """Closes the parser and returns the parsed output."""
+        self.close()
+        index: ESBMCOutputIndex = self.index
+        result = ESBMCOutput(
+            return_code=return_code,
+            output=index.output,
+            issues=self.issues,
+            duration=duration,
+            truncated=truncated,
+        )
+        result.__dict__["output_index"] = index
+        return result
+
+    def _keep(self, text: str) -> None:
+        self._tail.append(text)
+        self._tail_size += len(text)
+        if self.max_output_size is None:
+            return
+        while self._tail_size > self.max_output_size and len(self._tail) > 1:
+            dropped: str = self._tail.popleft()
+            self._tail_size -= len(dropped)
+            self.omitted_chars += len(dropped)
+
+    def _feed_line(self, line: str, end: str) -> None:
+        self._keep(line + end)
+        self._index_line(line)
+        self._offset += len(line) + len(end)
+        if line.endswith("\r"):
+            line = line[:-1]
+
+        if "ERROR: PARSING ERROR" in line:
+            self.parsing_error = True
+        if not self.parse_issues:
+            return
+
+        if "[Counterexample]" in line:
+            before, _, after = line.partition("[Counterexample]")
+            if self._section is not None:
+                self._parse_section_line(before)
+            self._end_section()
+            self._section = _CounterexampleSection()
+            line = "[Counterexample]" + after
+
+        if self._section is not None:
+            self._parse_section_line(line)
+
+    def _index_line(self, line: str) -> None:
+        for marker, offsets in (
+            ("[Counterexample]", self._counterexamples),
+            ("Violated property:", self._violated_properties),
+            ("Stack trace:", self._stack_traces),
+        ):
+            offset: int = line.find(marker)
+            while offset >= 0:
+                offsets.append(self._offset + offset)
+                offset = line.find(marker, offset + len(marker))
+        status: int = line.rfind("VERIFICATION ")
+        if status >= 0:
+            self._status = (self._offset + status, self._offset + len(line))
+
+    def _end_section(self) -> None:
+        section: _CounterexampleSection | None = self._section
+        if section is None:
+            return
+        self._section = None
+        self._end_state(section)
+
+        stack_trace: list[ProgramTrace] = []
+        if section.stack_trace is not None:
+            stack_trace = section.stack_trace
+            if section.violated_location is not None:
+                stack_trace.append(
+                    section.violated_location.model_copy(
+                        update={"trace_index": len(stack_trace)}
+                    )
+                )
+
+        issue: Issue | None = ESBMCOutputParser._make_verification_failure(
+            stack_trace_lines=section.stack_trace_lines or [],
+            violated_property=section.violated_property,
+            stack_trace=stack_trace,
+            counterexample=section.counterexample,
+        )
+        if issue is not None:
+            self.issues.append(issue)
+            if self.on_issue is not None:
+                self.on_issue(issue)
+
+    def _end_state(self, section: _CounterexampleSection) -> None:
+        """Parses the state block that is being collected, if any."""
+        if section.state_header is None or section.state_body is None:
+            section.state_header = None
+            section.state_body = None
+            return
+        block: str = "\n".join(
+            [section.state_header, section.state_separator, *section.state_body]
+        )
+        section.state_header = None
+        section.state_body = None
+
+        trace_index: int = section.state_count
+        section.state_count += 1
+        try:
+            trace_results = ESBMCOutputParser._parse_trace_line(block)
+        except ValueError:
+            return
+        if not trace_results:
+            return
+        trace = CounterexampleProgramTrace(
+            trace_index=trace_index,
+            path=trace_results.filename,
+            line_idx=trace_results.line_number - 1,
+            name=trace_results.method_name or None,
+            assignment=(
+                trace_results.error_line.strip() if trace_results.error_line else None
+            ),
+        )
+        section.counterexample.append(trace)
+        if self.on_trace is not None:
+            self.on_trace(trace)
+
+    def _parse_section_line(self, line: str) -> None:
+        section: _CounterexampleSection = cast(_CounterexampleSection, self._section)
+        if self.parse_states:
+            self._parse_state_line(section, line)
+        self._parse_stack_trace_line(section, line)
+        self._parse_indented_line(section, line)
+
+    @staticmethod
+    def _parse_violated_location(text: str) -> ProgramTrace | None:
+        match = _VIOLATED_LOCATION_PATTERN.match(text)
+        if not match:
+            return None
+        return ProgramTrace(
+            trace_index=0,
+            path=Path(match.group(1)),
+            line_idx=int(match.group(2)) - 1,
+            name=match.group(3),
+        )
+
+    def _parse_state_line(self, section: _CounterexampleSection, line: str) -> None:
+        """Counterexample states: a header line, a separator line of dashes
+        and a body that always has its first line and ends before an empty
+        line or a line starting with Violated."""
+        if section.state_body is not None:
+            if section.state_body and (not line or line.startswith("Violated")):
+                self._end_state(section)
+            else:
+                section.state_body.append(line)
+                return
+        elif section.state_header is not None:
+            if _STATE_SEPARATOR_PATTERN.fullmatch(line):
+                section.state_separator = line
+                section.state_body = []
+                return
+            section.state_header = None
+
+        match = _STATE_HEADER_PATTERN.search(line)
+        if match:
+            section.state_header = line[match.start() :]
+
+    def _parse_stack_trace_line(
+        self, section: _CounterexampleSection, line: str
+    ) -> None:
+        """The stack trace (--show-stacktrace) up to the first blank line, and
+        the location of the violated property before it, which becomes its
+        last element."""
+        if section.in_stack_trace:
+            if not line.strip():
+                section.in_stack_trace = False
+                if self.on_violation is not None:
+                    self.on_violation()
+                return
+            match = _STACK_TRACE_PATTERN.search(line)
+            if match:
+                assert section.stack_trace is not None
+                section.stack_trace.append(
+                    ProgramTrace(
+                        trace_index=len(section.stack_trace),
+                        path=Path(match.group(1)),
+                        line_idx=int(match.group(2)) - 1,
+                        name=match.group(3),
+                    )
+                )
+            return
+
+        if section.stack_trace is not None:
+            return
+
+        marker: int = line.find("Stack trace:")
+        if marker >= 0:
+            section.stack_trace = []
+            section.in_stack_trace = True
+            rest: str = line[marker + len("Stack trace:") :]
+            if rest:
+                self._parse_stack_trace_line(section, rest[1:])
+            return
+
+        if section.violated_location is not None:
+            return
+        if section.expect_violated_location and line.strip():
+            section.expect_violated_location = False
+            section.violated_location = self._parse_violated_location("\n" + line)
+        marker = line.find("Violated property:")
+        if marker >= 0 and section.violated_location is None:
+            rest = line[marker + len("Violated property:") :]
+            if rest.strip():
+                section.violated_location = self._parse_violated_location(rest)
+            else:
+                section.expect_violated_location = True
+
+    @staticmethod
+    def _parse_indented_line(section: _CounterexampleSection, line: str) -> None:
+        """The indented lines after the Stack trace and Violated property
+        markers, see ESBMCOutputIndex.indented_lines_after."""
+        indented: bool = bool(line) and line[0].isspace()
+        if section.in_stack_trace_lines:
+            assert section.stack_trace_lines is not None
+            if indented:
+                section.stack_trace_lines.append(line.strip())
+            else:
+                section.in_stack_trace_lines = False
+        elif section.stack_trace_lines is None and line == "Stack trace:":
+            section.stack_trace_lines = []
+            section.in_stack_trace_lines = True
+
+        if section.expect_violated_property:
+            section.expect_violated_property = False
+            if indented:
+                section.violated_property = line.strip()
+        elif not section.seen_violated_property and line == "Violated property:":
+            section.seen_violated_property = True
+            section.expect_violated_property = True
+
+
 class ESBMCOutputSections(BaseModel):
     """Provides access to raw text sections of ESBMC output.
 
@@ -499,6 +872,8 @@ class ESBMCOutputSections(BaseModel):
     """Raw counterexample section from [Counterexample] marker to end."""
     stack_trace: str | None
     """Raw stack trace lines (without header, excluding violated property message)."""
+    status: str | None = None
+    """The last VERIFICATION status line, such as VERIFICATION FAILED."""
 
     @staticmethod
     def from_output(output: str) -> "ESBMCOutputSections":
@@ -510,48 +885,50 @@ class ESBMCOutputSections(BaseModel):
         Returns:
             ESBMCOutputSections with parsed and cached sections
         """
-        return ESBMCOutputSections(
-            violated_property=ESBMCOutputSections._parse_violated_property(output),
-            counterexample=ESBMCOutputSections._parse_counterexample(output),
-            stack_trace=ESBMCOutputSections._parse_stack_trace(output),
-        )
+        return ESBMCOutputSections.from_index(ESBMCOutputIndex.build(output))
 
     @staticmethod
-    def _parse_violated_property(output: str) -> str | None:
-        """Extract violated property message from output."""
-        indented_lines = ESBMCOutputParser._extract_indented_lines_after(
-            output, "Stack trace:"
+    def from_index(index: ESBMCOutputIndex) -> "ESBMCOutputSections":
+        """Extract all sections by slicing the indexed output."""
+        stack_trace_lines: list[str] = index.indented_lines_after(
+            index.stack_traces, "Stack trace:"
         )
-        # Return the last indented line (the violated property message)
-        return indented_lines[-1] if indented_lines else None
-
-    @staticmethod
-    def _parse_counterexample(output: str) -> str | None:
-        """Extract counterexample section from output."""
-        try:
-            start = output.index("[Counterexample]")
-            return output[start:]
-        except ValueError:
-            return None
-
-    @staticmethod
-    def _parse_stack_trace(output: str) -> str | None:
-        """Extract stack trace lines from output."""
-        indented_lines = ESBMCOutputParser._extract_indented_lines_after(
-            output, "Stack trace:"
+        return ESBMCOutputSections(
+            # The last indented line is the violated property message.
+            violated_property=stack_trace_lines[-1] if stack_trace_lines else None,
+            counterexample=(
+                index.output[index.counterexamples[0] :]
+                if index.counterexamples
+                else None
+            ),
+            stack_trace=(
+                "\n".join(stack_trace_lines[:-1])
+                if len(stack_trace_lines) > 1
+                else None
+            ),
+            status=(
+                index.output[index.status[0] : index.status[1]]
+                if index.status
+                else None
+            ),
         )
-        # Return all but the last line (which is the violated property message)
-        if len(indented_lines) > 1:
-            return "\n".join(indented_lines[:-1])
-        return None
 
 
+@register_class
 class ESBMCOutput(VerifierOutput):
     """Pure data model for ESBMC verification output.
 
     Use ESBMCOutputParser to construct instances from raw ESBMC output.
     """
 
+    truncated: bool = False
+    """ESBMC was stopped once the first violated property was read (early
+    exit), so the output ends there, or the witness could not be read and the
+    output was cut to max_output_size, so the counterexample is missing."""
+    profile: str | None = None
+    """The portfolio profile that produced the output, None if no portfolio
+    was used."""
+
     @property
     @override
     def successful(self) -> bool:
@@ -564,18 +941,82 @@ class ESBMCOutput(VerifierOutput):
         Returns:
             ESBMCOutputSections object providing access to raw parts of the output.
         """
-        return ESBMCOutputSections.from_output(self.output)
+        return ESBMCOutputSections.from_index(self.output_index)
+
+    @cached_property
+    def output_index(self) -> ESBMCOutputIndex:
+        """Offsets of the sections of the output, set by the parser and built
+        on first access when the output is restored from the cache."""
+        return ESBMCOutputIndex.build(self.output)
+
+
+@cache
+def _query_esbmc_version(
+    esbmc_path: Path, mtime_ns: int, inode: int, size: int
+) -> str:
+    """Returns the first line reported by `esbmc --version`. The stat fields
+    are part of the memoization key so that a binary upgraded in place is
+    queried again."""
+    _ = mtime_ns, inode, size
+    try:
+        process: CompletedProcess = run(
+            [str(esbmc_path), "--version"],
+            stdout=PIPE,
+            stderr=STDOUT,
+            timeout=10,
+            check=False,
+        )
+    except (OSError, SubprocessError):
+        return ""
+    output: str = process.stdout.decode("utf-8", errors="replace").strip()
+    return output.splitlines()[0] if output else ""
+
+
+def _get_esbmc_version(esbmc_path: Path) -> str:
+    """Returns the version of the ESBMC binary, memoized until the binary is
+    replaced since it's queried every time a result is cached. Empty if it
+    can't be queried."""
+    try:
+        stat: os.stat_result = esbmc_path.stat()
+    except OSError:
+        return ""
+    return _query_esbmc_version(
+        esbmc_path, stat.st_mtime_ns, stat.st_ino, stat.st_size
+    )
+
+
+@cache
+def _hash_binary(esbmc_path: Path, mtime_ns: int, inode: int, size: int) -> str:
+    """Hashes the contents of the ESBMC binary. The stat fields are part of the
+    memoization key so that the binary is only rehashed when it's replaced."""
+    _ = mtime_ns, inode, size
+    digest = sha256()
+    with open(esbmc_path, "rb") as file:
+        while chunk := file.read(1 << 20):
+            digest.update(chunk)
+    return digest.hexdigest()
+
+
+def _get_esbmc_fingerprint(esbmc_path: Path) -> str:
+    """Returns a content fingerprint of the ESBMC binary, or an empty string if
+    it can't be read."""
+    try:
+        stat: os.stat_result = esbmc_path.stat()
+        return _hash_binary(esbmc_path, stat.st_mtime_ns, stat.st_ino, stat.st_size)
+    except OSError:
+        return ""
 
 
 class ESBMC(BaseSourceVerifier):
     """Verifier class that uses ESBMC."""
 
     FORBIDDEN_PARAMS = {
-        "--multi-property": "it is not yet supported!",
+        "--multi-property": "instead set multi_property.",
         "--input-file": "",
         "--timeout": "instead specify it in its own field.",
         "--function": "instead specify it in its own field.",
         "--show-stacktrace": "it is added automatically.",
+        "--witness-output": "instead set output_format to witness.",
     }
 
     def __init__(self) -> None:
@@ -588,6 +1029,17 @@ class ESBMC(BaseSourceVerifier):
             raise ValueError("No esbmc path set.")
         return self.global_config.verifier.esbmc.path.absolute()
 
+    @property
+    @override
+    def verifier_version(self) -> str:
+        return _get_esbmc_version(self.esbmc_path)
+
+    @property
+    def esbmc_fingerprint(self) -> str:
+        """Content fingerprint of the ESBMC binary, part of the cache key so
+        that results from other builds of ESBMC are never reused."""
+        return _get_esbmc_fingerprint(self.esbmc_path)
+
     @override
     def verify_source(
         self,
@@ -596,54 +1048,173 @@ class ESBMC(BaseSourceVerifier):
         timeout: int | None = None,
         entry_function: str | None = None,
         params: list[str] | None = None,
+        early_exit: bool | None = None,
+        multi_property: bool | None = None,
+        parallel_claims: int | None = None,
+        portfolio: dict[str, list[str]] | None = None,
+        incremental: bool | None = None,
+        solution_key: str | None = None,
     ) -> ESBMCOutput:
-        timeout = timeout or self.global_config.verifier.esbmc.timeout
+        """Verifies the solution with ESBMC. The arguments left as None take
+        their value from the config. With early_exit, ESBMC is stopped as soon
+        as the first violated property and its trace are read, and the result
+        is marked as truncated.
+
+        With multi_property, ESBMC checks every property instead of stopping at
+        the first violated one, and an issue is returned for each violated
+        property, early_exit is then ignored. If parallel_claims is more than
+        1, the claims are split in that many groups that are checked by
+        parallel ESBMC processes, and their results are merged.
+
+        With a portfolio, ESBMC is run with each of its parameter profiles at
+        the same time instead of params, and the first conclusive result is
+        returned with the name of its profile. The portfolio of the config is
+        used unless params are given.
+        Parallel claims are not used with a portfolio.
+
+        With incremental, the solution is verified from each of the incremental
+        entry points of the config (the entry function if there are none), and
+        only the entry points whose call trees changed since they were last
+        verified are run again, see _verify_incremental.
+
+        solution_key is used in place of the solution in the cache key, for
+        callers that know which part of the solution the verification depends
+        on."""
+        config = self.global_config.verifier.esbmc
+        timeout = timeout or config.timeout
+        if multi_property is None:
+            multi_property = config.multi_property
+        if parallel_claims is None:
+            parallel_claims = config.parallel_claims
+        if early_exit is None:
+            early_exit = config.early_exit
+        early_exit = early_exit and not multi_property
         entry_function = entry_function or self.global_config.solution.entry_function
-        esbmc_params: list[str] = params or self.global_config.verifier.esbmc.params
+        esbmc_params: list[str] = params or config.params
+        if portfolio is None:
+            portfolio = {} if params else config.portfolio
+        if incremental is None:
+            incremental = config.incremental
+        if incremental:
+            return self._verify_incremental(
+                solution=solution,
+                entry_points=config.incremental_entry_points or [entry_function],
+                timeout=timeout,
+                params=params,
+                early_exit=early_exit,
+                multi_property=multi_property,
+                parallel_claims=parallel_claims,
+                portfolio=portfolio,
+            )
 
-        # Validate forbidden parameters
-        for param, reason in self.FORBIDDEN_PARAMS.items():
-            if param in esbmc_params:
-                msg = f"Do not add {param} to ESBMC parameters"
-                if reason:
-                    msg += f", {reason}"
-                else:
-                    msg += "."
-                raise ValueError(msg)
+        for profile_params in [esbmc_params, *portfolio.values()]:
+            self._check_params(profile_params)
+        if multi_property:
+            esbmc_params = esbmc_params + ["--multi-property"]
+            portfolio = {
+                name: profile_params + ["--multi-property"]
+                for name, profile_params in portfolio.items()
+            }
+        if not multi_property or portfolio:
+            parallel_claims = 1
+        if config.escalation.enabled and config.escalation.start_unwind is not None:
+            # The escalation sets the unwind bound of every run.
+            esbmc_params = self._escalation_params(esbmc_params)
+            portfolio = {
+                name: self._escalation_params(profile_params)
+                for name, profile_params in portfolio.items()
+            }
 
         # Verify source is not responsible for saving the solution.
         if not solution.verify_solution_integrity():
             raise SolutionIntegrityError(solution.files)
 
-        # Check if cached version exists.
+        # Check if cached version exists. The key uses the resolved parameters
+        # and the binary that will run, so the cache stays valid across config
+        # and ESBMC changes.
         enable_cache: bool = self.global_config.verifier.enable_cache
-        cache_properties: Any = [solution, entry_function, timeout, params]
+        cache_properties: Any = [
+            solution if solution_key is None else solution_key,
+            entry_function,
+            timeout,
+            ["portfolio", sorted(portfolio.items())] if portfolio else esbmc_params,
+            self.esbmc_fingerprint,
+        ]
+        # Early exit only changes how much output is kept, so it doesn't change
+        # the key of the default mode.
+        if early_exit:
+            cache_properties.append("early_exit")
+        output_format: str = config.output_format
+        if output_format != "text":
+            cache_properties.append(output_format)
+        # The claims checked by each process change the layout of the output.
+        if parallel_claims > 1:
+            cache_properties.append(f"parallel_claims={parallel_claims}")
+        if config.escalation.enabled:
+            cache_properties.append(
+                [
+                    "escalation",
+                    config.escalation.start_unwind,
+                    config.escalation.max_unwind,
+                ]
+            )
         if enable_cache:
             cached_result: Any = self._load_cached(cache_properties)
             if cached_result is not None:
                 return cached_result
 
-        # Call ESBMC to temporary folder.
-        return_code, output, duration = self._esbmc(
-            solution=solution,
-            esbmc_params=esbmc_params,
-            entry_function=entry_function,
-            timeout=timeout,
-        )
+        def run_esbmc(extra_params: list[str], run_timeout: int | None) -> ESBMCOutput:
+            if portfolio:
+                return self._esbmc_portfolio(
+                    solution=solution,
+                    portfolio={
+                        name: profile_params + extra_params
+                        for name, profile_params in portfolio.items()
+                    },
+                    entry_function=entry_function,
+                    timeout=run_timeout,
+                    early_exit=early_exit,
+                )
+            if parallel_claims > 1:
+                return self._esbmc_parallel_claims(
+                    solution=solution,
+                    esbmc_params=esbmc_params + extra_params,
+                    entry_function=entry_function,
+                    timeout=run_timeout,
+                    groups=parallel_claims,
+                )
+            return self._esbmc(
+                solution=solution,
+                esbmc_params=esbmc_params + extra_params,
+                entry_function=entry_function,
+                timeout=run_timeout,
+                early_exit=early_exit,
+            )
 
-        # Parse output and construct result
-        result: ESBMCOutput = ESBMCOutputParser.parse_output(
-            return_code=return_code,
-            output=output,
-            duration=duration,
-        )
+        # Call ESBMC to temporary folder, the output is parsed as it is written.
+        result: ESBMCOutput
+        if config.escalation.enabled:
+            result = self._escalate(
+                solution=solution,
+                entry_function=entry_function,
+                history_params=(
+                    ["portfolio", sorted(portfolio.items())]
+                    if portfolio
+                    else esbmc_params
+                ),
+                timeout=timeout,
+                run_esbmc=run_esbmc,
+            )
+        else:
+            result = run_esbmc([], timeout)
+        return_code: int = result.return_code
 
         # Filter traces to only include files from the solution
         result = ESBMCOutputParser.filter_traces(result, solution)
 
         self.logger.debug(f"Verification Successful: {result.successful}")
         self.logger.debug(f"ESBMC Exit Code: {return_code}")
-        self.logger.debug(f"ESBMC Output: {output}")
+        self.logger.debug(f"ESBMC Output: {result.output}")
 
         if enable_cache:
             self._save_cached(cache_properties, result)
@@ -663,26 +1234,655 @@ class ESBMC(BaseSourceVerifier):
 
         return result
 
+    def _verify_incremental(
+        self, solution: Solution, entry_points: list[str], **kwargs: Any
+    ) -> ESBMCOutput:
+        """Verifies the solution from each entry point in parallel, and merges
+        the results. The result of each entry point is cached by the digest of
+        its call tree rather than of the whole solution, so when a repair
+        changes one function, only the entry points that reach it are verified
+        again and the others reuse their cached results."""
+        slices: SolutionSlices = SolutionSlices(solution)
+        self._logger.info(
+            "Verifying incrementally from entry points: " + ", ".join(entry_points)
+        )
+        with ThreadPoolExecutor(max_workers=len(entry_points)) as executor:
+            futures: list[Future[ESBMCOutput]] = [
+                executor.submit(
+                    copy_context().run,
+                    partial(
+                        self.verify_source,
+                        solution=solution,
+                        entry_function=entry_point,
+                        incremental=False,
+                        solution_key=slices.call_tree_digest(entry_point),
+                        **kwargs,
+                    ),
+                )
+                for entry_point in entry_points
+            ]
+            results: list[ESBMCOutput] = [future.result() for future in futures]
+        if len(results) == 1:
+            return results[0]
+        return ESBMCOutputParser.merge_outputs(results)
+
+    def _check_params(self, esbmc_params: list[str]) -> None:
+        """Raises ValueError if the params have forbidden parameters."""
+        for param, reason in self.FORBIDDEN_PARAMS.items():
+            if param in esbmc_params:
+                msg = f"Do not add {param} to ESBMC parameters"
+                if reason:
+                    msg += f", {reason}"
+                else:
+                    msg += "."
+                raise ValueError(msg)
+
+    @staticmethod
+    def _escalation_params(esbmc_params: list[str]) -> list[str]:
+        """The params without their --unwind bound, which the escalation
+        replaces. Raises ValueError if they use a mode that grows the bound
+        itself."""
+        iterative: set[str] = ESBMC_ITERATIVE_PARAMS & set(esbmc_params)
+        if iterative:
+            raise ValueError(
+                "The unwind bound can't be escalated with "
+                f"{", ".join(sorted(iterative))}, remove them from the ESBMC "
+                "params or leave start_unwind empty."
+            )
+        params: list[str] = []
+        skip_value: bool = False
+        for param in esbmc_params:
+            if skip_value:
+                skip_value = False
+            elif param == "--unwind":
+                skip_value = True
+            elif not param.startswith("--unwind="):
+                params.append(param)
+        return params
+
     def _esbmc(
         self,
         solution: Solution,
         esbmc_params: list[str],
         entry_function: str,
         timeout: int | None = None,
-    ) -> tuple[int, str, float]:
+        early_exit: bool = False,
+    ) -> ESBMCOutput:
         """Exit code will be 0 if verification successful, 1 if verification
         failed. And any other number for compilation error/general errors.
 
+        The output is parsed with ESBMCStreamParser while ESBMC runs, so only
+        the last verifier.esbmc.max_output_size characters of it are kept.
+        With early_exit, ESBMC is killed once the first violated property is
+        read, the exit code is then 1 as if ESBMC had ended there.
+        With the witness output format, the counterexample is read from the
+        witness ESBMC writes instead of its text output.
+
         Returns:
-            Tuple of (return_code, output, duration_seconds)
+            The parsed output of ESBMC, unfiltered.
         """
+        units: dict[Path, Path] = {}
+        units_dir: Path | None = None
+        if (
+            self.global_config.verifier.esbmc.preprocess_cache
+            and self.global_config.verifier.enable_cache
+        ):
+            units_dir = Path(
+                mkdtemp(prefix="esbmc-units-", dir=self.global_config.temp_file_dir)
+            )
+            try:
+                units = self._preprocessed_units(
+                    solution, esbmc_params, units_dir, timeout
+                )
+            except BaseException:
+                rmtree(units_dir, ignore_errors=True)
+                raise
+
+        esbmc_cmd: list[str] = self._esbmc_command(
+            solution, esbmc_params, entry_function, timeout, units
+        )
+
+        witness_path: Path | None = None
+        if self.global_config.verifier.esbmc.output_format == "witness":
+            fd, name = mkstemp(
+                prefix="esbmc-witness-",
+                suffix=".graphml",
+                dir=self.global_config.temp_file_dir,
+            )
+            os.close(fd)
+            witness_path = Path(name)
+            esbmc_cmd.extend(["--witness-output", str(witness_path)])
+
+        self._logger.info("Running ESBMC: " + " ".join(esbmc_cmd))
+
+        stop_event: Event = Event()
+        parser: ESBMCStreamParser = ESBMCStreamParser(
+            on_violation=stop_event.set if early_exit else None,
+            max_output_size=self.global_config.verifier.esbmc.max_output_size,
+            # ESBMC doesn't write the witness when it is stopped early, the
+            # states are then parsed from the text output as it is read.
+            parse_states=witness_path is None or early_exit,
+        )
+        try:
+            process: VerifierProcess
+            duration: float
+            process, duration = self.run_command(
+                cmd=esbmc_cmd,
+                process_timeout=timeout,
+                cwd=solution.working_dir,
+                on_output=parser.feed,
+                stop_event=stop_event,
+            )
 
+            result: ESBMCOutput
+            if stop_event.is_set() and process.returncode < 0:
+                self._logger.info("Stopped ESBMC after the first violated property")
+                result = parser.to_output(
+                    return_code=1, duration=duration, truncated=True
+                )
+            else:
+                # Check segfault.
+                if process.returncode == -signal.SIGSEGV:
+                    raise RuntimeError(
+                        "ESBMC has segfaulted. Please report the issue "
+                        "to developers: https://www.github.com/esbmc/esbmc/issues"
+                    )
+                result = parser.to_output(
+                    return_code=process.returncode, duration=duration
+                )
+
+            if witness_path is not None:
+                result = self._read_witness(result, witness_path, parser)
+            result.resource_usage = process.resource_usage
+            return result
+        finally:
+            if witness_path is not None:
+                witness_path.unlink(missing_ok=True)
+            if units_dir is not None:
+                rmtree(units_dir, ignore_errors=True)
+
+    @staticmethod
+    def _preprocessing_params(esbmc_params: list[str]) -> list[str]:
+        """The parameters that can change the preprocessed code, the ones that
+        only change what is checked (such as the unwind bound that escalation
+        grows) are left out so that they don't invalidate cached units."""
+        params: list[str] = []
+        skip: bool = False
+        for param in esbmc_params:
+            if skip:
+                skip = False
+            elif param in _NON_PREPROCESSING_PARAMS:
+                skip = _NON_PREPROCESSING_PARAMS[param]
+            else:
+                params.append(param)
+        return params
+
+    def _preprocessed_units(
+        self,
+        solution: Solution,
+        esbmc_params: list[str],
+        directory: Path,
+        timeout: int | None = None,
+    ) -> dict[Path, Path]:
+        """Writes the preprocessed translation unit of each C/C++ source file
+        of the solution into directory. Units are taken from the cache when
+        the file, the headers of the solution and the include dirs have not
+        changed, so only the edited files are preprocessed. The digests of the
+        files named in the line markers of a unit are recorded with it, and
+        checked before it is reused, which covers the headers found next to
+        the source or in the system include dirs. Units that name a file that
+        can't be read are not cached.
+
+        The working dir is replaced by a placeholder in the cached units, so
+        that a unit made in the directory of one attempt can be reused in
+        another and the traces of ESBMC still point to the current files.
+
+        Returns:
+            The source files mapped to their units. Files that fail to
+            preprocess are left out, ESBMC then reports their errors."""
+        params: list[str] = self._preprocessing_params(esbmc_params)
+        prefix: str = str(solution.working_dir) + os.sep
+        headers: list[tuple[str, str]] = sorted(
+            (str(f.file_path.relative_to(solution.working_dir)), f.digest)
+            for f in solution.get_files_by_ext(["h", "hpp", "hxx", "h++"])
+        )
+        include_dirs_digest: str = solution.include_dirs_digest
+
+        units: dict[Path, Path] = {}
+        for source_file in solution.get_files_by_ext(["c", "cpp", "cc", "cxx", "c++"]):
+            relative: Path = source_file.file_path.relative_to(solution.working_dir)
+            key: str = self._compute_cache_id(
+                [
+                    "preprocessed_unit",
+                    str(relative),
+                    source_file.digest,
+                    headers,
+                    include_dirs_digest,
+                    params,
+                    self.esbmc_fingerprint,
+                ]
+            )
+            unit: str | None = self._load_unit(key, solution.working_dir)
+            if unit is None:
+                unit = self._preprocess(solution, source_file, params, timeout)
+                if unit is None:
+                    continue
+                unit = unit.replace(prefix, _WORKING_DIR_PLACEHOLDER)
+                files: dict[str, str] | None = self._unit_files(
+                    unit, solution.working_dir
+                )
+                if files is not None:
+                    self.cache.put(
+                        key,
+                        json.dumps({"unit": unit, "files": files}).encode("utf-8"),
+                        version=self.verifier_version,
+                    )
+            else:
+                self._logger.debug(f"Reusing the preprocessed unit of {relative}")
+
+            unit_path: Path = directory / relative.with_suffix(
+                ".i" if source_file.file_path.suffix == ".c" else ".ii"
+            )
+            unit_path.parent.mkdir(parents=True, exist_ok=True)
+            unit_path.write_text(unit.replace(_WORKING_DIR_PLACEHOLDER, prefix))
+            units[source_file.file_path] = unit_path
+        return units
+
+    @staticmethod
+    def _unit_files(unit: str, working_dir: Path) -> dict[str, str] | None:
+        """The files named in the line markers of a unit (with the working dir
+        as a placeholder) mapped to their digests. None if one of them can't
+        be read."""
+        files: dict[str, str] = {}
+        for name in set(_LINE_MARKER_PATTERN.findall(unit)):
+            # Such as <built-in> and <command-line>.
+            if name.startswith("<"):
+                continue
+            path: Path = working_dir / name.replace(
+                _WORKING_DIR_PLACEHOLDER, str(working_dir) + os.sep
+            ).replace("\\\\", "\\")
+            digest: str | None = file_digest(path)
+            if digest is None:
+                return None
+            files[name] = digest
+        return files
+
+    def _load_unit(self, key: str, working_dir: Path) -> str | None:
+        """The cached unit (with the working dir as a placeholder), None if it
+        is not cached or one of the files it was made from has changed."""
+        data: bytes | None = self.cache.get(key)
+        if data is None:
+            return None
+        try:
+            entry: Any = json.loads(data)
+            unit: str = entry["unit"]
+            files: dict[str, str] = entry["files"]
+        except (ValueError, KeyError, TypeError):
+            return None
+        if self._unit_files(unit, working_dir) != files:
+            self._logger.debug("A file of a cached preprocessed unit has changed")
+            return None
+        return unit
+
+    def _preprocess(
+        self,
+        solution: Solution,
+        source_file: SourceFile,
+        params: list[str],
+        timeout: int | None = None,
+    ) -> str | None:
+        """Preprocesses a source file of the solution with ESBMC, None if it
+        fails."""
+        cmd: list[str] = [
+            str(self.esbmc_path),
+            *params,
+            "--preprocess",
+            "--input-file",
+            str(source_file.file_path),
+            *("-I" + str(d) for d in solution.include_dirs),
+        ]
+        self._logger.info("Preprocessing: " + " ".join(cmd))
+        process, _ = self.run_command(
+            cmd=cmd, cwd=solution.working_dir, process_timeout=timeout
+        )
+        if process.returncode != 0:
+            self._logger.warn(
+                f"Could not preprocess {source_file.file_path}, it is passed "
+                "to ESBMC as it is"
+            )
+            return None
+        return process.stdout.decode("utf-8", errors="replace")
+
+    def _read_witness(
+        self, result: ESBMCOutput, witness_path: Path, parser: ESBMCStreamParser
+    ) -> ESBMCOutput:
+        """Takes the counterexample of a failed verification from the witness.
+        Falls back to the text output when the witness is missing or can't be
+        read, such as when ESBMC was stopped early: to the states parser read
+        if it parsed them, otherwise to parsing the retained output. If the
+        start of the output was dropped the issues parser read are returned
+        without a counterexample, marked as truncated."""
+        if result.return_code != 1:
+            return result
+
+        try:
+            with_witness: ESBMCOutput | None = ESBMCOutputParser.apply_witness(
+                result, parse_witness(witness_path)
+            )
+            if with_witness is not None:
+                return with_witness
+            self._logger.warn("The witness has no matching issue in the output")
+        except WitnessParseError as e:
+            self._logger.warn(f"Falling back to the text output: {e}")
+
+        if parser.parse_states:
+            return result
+        if parser.omitted_chars:
+            # The issues parser read are kept, without their states.
+            self._logger.warn(
+                f"{parser.omitted_chars} characters of the output were dropped "
+                "before the witness could be read, the counterexample is "
+                "missing. Raise verifier.esbmc.max_output_size to keep them."
+            )
+            result.truncated = True
+            return result
+        fallback: ESBMCOutput = ESBMCOutputParser.parse_output(
+            return_code=result.return_code,
+            output=result.output,
+            duration=result.duration,
+        )
+        fallback.truncated = result.truncated
+        return fallback
+
+    def _escalate(
+        self,
+        solution: Solution,
+        entry_function: str,
+        history_params: Any,
+        timeout: int | None,
+        run_esbmc: Callable[[list[str], int | None], ESBMCOutput],
+    ) -> ESBMCOutput:
+        """Runs ESBMC with a growing budget. The first run has a small timeout
+        (and unwind bound, if one is set), they are multiplied by the factor
+        of the escalation each time a run times out (or hits the bound) up to
+        the timeout of the verification (and max_unwind). If timeout is None
+        the runs have no timeout and only the unwind bound grows.
+
+        The smallest budget known to be enough is recorded in the cache by the
+        program (the program digest of the solution, which the attempts of a
+        repair share with the original), the entry function and the
+        parameters. The next verification of the program, such as the next
+        repair attempt, starts from it. The edited code may need a different
+        budget, so the recorded budget is only where the escalation starts and
+        it can shrink: the timeout recorded is the duration of the run that
+        decided the verification, and after an unwind bound was enough from
+        the start, the next verification first tries one step smaller."""
+        escalation = self.global_config.verifier.esbmc.escalation
+        history_key: str | None = None
+        history: dict[str, Any] = {}
+        if escalation.use_history and self.global_config.verifier.enable_cache:
+            history_key = self._compute_cache_id(
+                [
+                    "escalation_history",
+                    solution.program_digest,
+                    entry_function,
+                    history_params,
+                ]
+            )
+            history = self._load_escalation_history(history_key)
+
+        run_timeout: int | None = None
+        if timeout is not None:
+            run_timeout = min(
+                timeout, max(escalation.start_timeout, history.get("timeout", 0))
+            )
+        unwind: int | None = escalation.start_unwind
+        if unwind is not None:
+            recorded_unwind: int = history.get("unwind", 0)
+            if not history.get("escalated", True):
+                # The recorded bound was enough from the start, try a smaller
+                # one in case the program needs less now.
+                recorded_unwind = floor(recorded_unwind / escalation.factor)
+            unwind = min(escalation.max_unwind, max(unwind, recorded_unwind))
+        start_unwind: int | None = unwind
+
+        while True:
+            self._logger.info(
+                f"Running ESBMC with timeout {run_timeout} and unwind {unwind}"
+            )
+            extra_params: list[str] = (
+                [] if unwind is None else ["--unwind", str(unwind)]
+            )
+            try:
+                result: ESBMCOutput = run_esbmc(extra_params, run_timeout)
+                timed_out: bool = "[ERROR] Timed out" in result.output
+            except TimeoutExpired:
+                if run_timeout is None or timeout is None or run_timeout >= timeout:
+                    raise
+                timed_out = True
+
+            if timed_out and run_timeout is not None and timeout is not None:
+                if run_timeout < timeout:
+                    run_timeout = min(timeout, ceil(run_timeout * escalation.factor))
+                    continue
+            elif (
+                unwind is not None
+                and unwind < escalation.max_unwind
+                and self._hit_unwind_bound(result)
+            ):
+                unwind = min(escalation.max_unwind, ceil(unwind * escalation.factor))
+                continue
+            break
+
+        if history_key is not None and not timed_out:
+            # The run took duration, so a timeout just above it is enough.
+            if run_timeout is not None and result.duration is not None:
+                run_timeout = min(
+                    run_timeout,
+                    max(escalation.start_timeout, ceil(result.duration) + 1),
+                )
+            history = {
+                "timeout": run_timeout,
+                "unwind": unwind,
+                "escalated": unwind != start_unwind,
+            }
+            self.cache.put(
+                history_key,
+                json.dumps(history | {"duration": result.duration}).encode("utf-8"),
+                version=self.verifier_version,
+            )
+        return result
+
+    def _load_escalation_history(self, key: str) -> dict[str, Any]:
+        data: bytes | None = self.cache.get(key)
+        if data is None:
+            return {}
+        try:
+            history: Any = json.loads(data)
+        except ValueError:
+            return {}
+        if not isinstance(history, dict):
+            return {}
+        return {
+            name: value
+            for name, value in history.items()
+            if (name in ("timeout", "unwind") and isinstance(value, int))
+            or (name == "escalated" and isinstance(value, bool))
+        }
+
+    @staticmethod
+    def _hit_unwind_bound(result: ESBMCOutput) -> bool:
+        """If the verification failed on an unwinding assertion, meaning that
+        the unwind bound was too small to decide it."""
+        return any(
+            "unwinding assertion" in issue.error_type
+            or "unwinding assertion" in issue.message
+            for issue in result.issues
+        )
+
+    @staticmethod
+    def _is_conclusive(result: ESBMCOutput) -> bool:
+        """If the result answers the verification: it succeeded, or it found a
+        violated property with its counterexample."""
+        if result.successful:
+            return result.sections.status != "VERIFICATION UNKNOWN"
+        return result.return_code == 1 and any(
+            isinstance(issue, VerifierIssue) for issue in result.issues
+        )
+
+    def _esbmc_portfolio(
+        self,
+        solution: Solution,
+        portfolio: dict[str, list[str]],
+        entry_function: str,
+        timeout: int | None,
+        early_exit: bool,
+    ) -> ESBMCOutput:
+        """Runs ESBMC with every profile of the portfolio at the same time. The
+        first conclusive result is returned and the other processes are
+        killed. If no result is conclusive, the result of the first profile of
+        the portfolio that didn't fail is returned.
+
+        Raises:
+            VerifierCancelledException: If the enclosing cancel scope is
+                cancelled, the processes of all the profiles are killed.
+        """
+        self._logger.info("Running ESBMC portfolio: " + ", ".join(portfolio))
+        outer_cancel_event: Event | None = current_cancel_event()
+        cancel_events: dict[str, Event] = {name: Event() for name in portfolio}
+
+        def run_profile(name: str) -> ESBMCOutput:
+            with cancel_scope(cancel_events[name]):
+                result: ESBMCOutput = self._esbmc(
+                    solution, portfolio[name], entry_function, timeout, early_exit
+                )
+            result.profile = name
+            return result
+
+        with ThreadPoolExecutor(max_workers=len(portfolio)) as executor:
+            futures: dict[str, Future[ESBMCOutput]] = {
+                name: executor.submit(copy_context().run, run_profile, name)
+                for name in portfolio
+            }
+            try:
+                pending: set[Future[ESBMCOutput]] = set(futures.values())
+                while pending:
+                    done, pending = wait(
+                        pending,
+                        timeout=self.CANCEL_POLL_INTERVAL,
+                        return_when=FIRST_COMPLETED,
+                    )
+                    if outer_cancel_event is not None and outer_cancel_event.is_set():
+                        raise VerifierCancelledException()
+                    for future in done:
+                        if future.exception() is None and self._is_conclusive(
+                            future.result()
+                        ):
+                            result: ESBMCOutput = future.result()
+                            self._logger.info(
+                                f"Portfolio profile {result.profile} won after "
+                                f"{result.duration or 0:.2f}s"
+                            )
+                            return result
+            finally:
+                # Kills the processes of the profiles that are still running.
+                for event in cancel_events.values():
+                    event.set()
+
+        self._logger.warn("No portfolio profile was conclusive")
+        for future in futures.values():
+            if future.exception() is None:
+                return future.result()
+        raise cast(BaseException, next(iter(futures.values())).exception())
+
+    def _esbmc_parallel_claims(
+        self,
+        solution: Solution,
+        esbmc_params: list[str],
+        entry_function: str,
+        timeout: int | None,
+        groups: int,
+    ) -> ESBMCOutput:
+        """Splits the claims of the solution in groups that are checked by
+        parallel ESBMC processes, then merges their results as if they were
+        checked by one process. The processes run with the cancel scope and
+        process limits of the caller.
+
+        Falls back to one process if the claims can't be listed, or if the
+        params already select claims."""
+        claims: list[int] = []
+        if "--claim" not in esbmc_params:
+            claims = self._list_claims(
+                solution, esbmc_params, entry_function, timeout
+            )
+        claim_groups: list[list[int]] = [
+            claims[i::groups] for i in range(min(groups, len(claims)))
+        ]
+        if len(claim_groups) < 2:
+            return self._esbmc(solution, esbmc_params, entry_function, timeout)
+
+        self._logger.info(
+            f"Checking {len(claims)} claims in {len(claim_groups)} processes"
+        )
+        with ThreadPoolExecutor(max_workers=len(claim_groups)) as executor:
+            futures: list[Future[ESBMCOutput]] = [
+                executor.submit(
+                    copy_context().run,
+                    self._esbmc,
+                    solution,
+                    esbmc_params
+                    + [arg for claim in group for arg in ("--claim", str(claim))],
+                    entry_function,
+                    timeout,
+                )
+                for group in claim_groups
+            ]
+            results: list[ESBMCOutput] = [future.result() for future in futures]
+        return ESBMCOutputParser.merge_outputs(results)
+
+    def _list_claims(
+        self,
+        solution: Solution,
+        esbmc_params: list[str],
+        entry_function: str,
+        timeout: int | None,
+    ) -> list[int]:
+        """The numbers of the claims ESBMC would check, from --show-claims."""
+        esbmc_cmd: list[str] = self._esbmc_command(
+            solution,
+            [p for p in esbmc_params if p != "--multi-property"],
+            entry_function,
+            timeout,
+        )
+        esbmc_cmd.append("--show-claims")
+        process, _ = self.run_command(
+            cmd=esbmc_cmd, process_timeout=timeout, cwd=solution.working_dir
+        )
+        if process.returncode != 0:
+            self._logger.warn(
+                f"Could not list the claims, ESBMC exited with {process.returncode}"
+            )
+            return []
+        output: str = process.stdout.decode("utf-8", errors="replace")
+        return [int(n) for n in _CLAIM_PATTERN.findall(output)]
+
+    def _esbmc_command(
+        self,
+        solution: Solution,
+        esbmc_params: list[str],
+        entry_function: str,
+        timeout: int | None,
+        units: dict[Path, Path] | None = None,
+    ) -> list[str]:
+        """The command that runs ESBMC on the solution. Source files that have
+        a preprocessed unit in units are replaced by it."""
+        units = units or {}
         # Build parameters list
         esbmc_cmd: list[str] = [str(self.esbmc_path)] + esbmc_params
         # Source code files (only accept valid ones)
         esbmc_cmd.append("--input-file")
         esbmc_cmd.extend(
-            str(file.file_path)
+            str(units.get(file.file_path, file.file_path))
             for file in solution.get_files_by_ext(
                 ["c", "cpp", "i", "ii", "cc", "cxx", "c++", "h", "hpp", "hxx", "h++"]
             )
@@ -697,23 +1897,4 @@ class ESBMC(BaseSourceVerifier):
         esbmc_cmd.extend(["--function", entry_function])
         # Add stack trace output (always enabled)
         esbmc_cmd.append("--show-stacktrace")
-
-        self._logger.info("Running ESBMC: " + " ".join(esbmc_cmd))
-
-        process: CompletedProcess
-        duration: float
-        process, duration = self.run_command(
-            cmd=esbmc_cmd,
-            process_timeout=timeout,
-            cwd=solution.working_dir,
-        )
-
-        # Check segfault.
-        if process.returncode == -signal.SIGSEGV:
-            raise RuntimeError(
-                "ESBMC has segfaulted. Please report the issue "
-                "to developers: https://www.github.com/esbmc/esbmc/issues"
-            )
-
-        output: str = process.stdout.decode("utf-8")
-        return process.returncode, output, duration
+        return esbmc_cmd
@@ -0,0 +1,142 @@
+# Author: Yiannis Charalambous
+
+"""Parser of the GraphML violation witnesses written by ESBMC with
+--witness-output. The witness holds the counterexample in a structured form,
+so it doesn't depend on the wording of the text output of ESBMC."""
+
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import IO
+from xml.etree.ElementTree import Element, ParseError, iterparse
+
+from esbmc_ai.program_trace import CounterexampleProgramTrace, ProgramTrace
+
+_GRAPHML_NAMESPACE: str = "{http://graphml.graphdrawing.org/xmlns}"
+
+
+class WitnessParseError(Exception):
+    """The witness is missing, malformed or not a violation witness."""
+
+
+@dataclass
+class ESBMCWitness:
+    """The counterexample of a violation witness."""
+
+    counterexample: list[CounterexampleProgramTrace] = field(default_factory=list)
+    """The assignments of the counterexample in order, followed by the location
+    of the violated property with no assignment, like in the text output."""
+    violation: ProgramTrace | None = None
+    """Location of the violated property."""
+
+
+def _local_name(tag: str) -> str:
+    return tag.removeprefix(_GRAPHML_NAMESPACE)
+
+
+def _data(element: Element, keys: dict[str, str]) -> dict[str, str]:
+    """The data of a node or edge by the name of their key."""
+    return {
+        keys.get(data.get("key", ""), data.get("key", "")): (data.text or "").strip()
+        for data in element
+        if _local_name(data.tag) == "data"
+    }
+
+
+def _location(data: dict[str, str]) -> tuple[Path, int] | None:
+    if "originfile" not in data or "startline" not in data:
+        return None
+    try:
+        return Path(data["originfile"]), int(data["startline"]) - 1
+    except ValueError:
+        return None
+
+
+def parse_witness(source: Path | IO[bytes]) -> ESBMCWitness:
+    """Reads a violation witness incrementally: each edge is converted to a
+    trace and discarded once it has been read, so large witnesses are not held
+    in memory as a tree.
+
+    Raises:
+        WitnessParseError: If the witness can't be read or is a correctness
+            witness."""
+    keys: dict[str, str] = {}
+    violation_nodes: set[str] = set()
+    # Target node and location of the edges that have a location, to find the
+    # edge that leads to the violation once all the nodes are known.
+    edge_locations: list[tuple[str, Path, int, str | None]] = []
+    # The functions entered by each thread, the edges of the threads are
+    # interleaved in multi-threaded witnesses.
+    functions: dict[str, list[str]] = {}
+    witness: ESBMCWitness = ESBMCWitness()
+
+    try:
+        graph: Element | None = None
+        depth: int = 0
+        for event, element in iterparse(source, events=("start", "end")):
+            tag: str = _local_name(element.tag)
+            if event == "start":
+                depth += 1
+                if tag == "graph":
+                    graph = element
+                continue
+            depth -= 1
+
+            if tag == "key":
+                keys[element.get("id", "")] = element.get("attr.name", "")
+            elif tag == "data" and depth == 2:
+                # Data of the graph itself.
+                if (
+                    keys.get(element.get("key", "")) == "witness-type"
+                    and (element.text or "").strip() == "correctness_witness"
+                ):
+                    raise WitnessParseError("The witness is a correctness witness.")
+            elif tag == "node":
+                if _data(element, keys).get("violation") == "true":
+                    violation_nodes.add(element.get("id", ""))
+            elif tag == "edge":
+                data: dict[str, str] = _data(element, keys)
+                stack: list[str] = functions.setdefault(data.get("threadId", "0"), [])
+                if "enterFunction" in data:
+                    stack.append(data["enterFunction"])
+
+                location = _location(data)
+                name: str | None = data.get("assumption.scope") or (
+                    stack[-1] if stack else None
+                )
+                if location is not None:
+                    edge_locations.append((element.get("target", ""), *location, name))
+                    if data.get("assumption"):
+                        witness.counterexample.append(
+                            CounterexampleProgramTrace(
+                                trace_index=len(witness.counterexample),
+                                path=location[0],
+                                line_idx=location[1],
+                                name=name,
+                                assignment=data["assumption"],
+                            )
+                        )
+
+                if "returnFromFunction" in data and stack:
+                    stack.pop()
+
+            # Nodes and edges are not needed once read.
+            if tag in ("node", "edge") and graph is not None:
+                graph.clear()
+    except (OSError, ParseError) as e:
+        raise WitnessParseError(f"Could not read the witness: {e}") from e
+
+    for target, path, line_idx, name in reversed(edge_locations):
+        if target in violation_nodes:
+            witness.violation = ProgramTrace(
+                trace_index=0, path=path, line_idx=line_idx, name=name
+            )
+            witness.counterexample.append(
+                CounterexampleProgramTrace(
+                    trace_index=len(witness.counterexample),
+                    path=path,
+                    line_idx=line_idx,
+                    name=name,
+                )
+            )
+            break
+    return witness
@@ -0,0 +1,176 @@
+# Author: Yiannis Charalambous
+
+"""Service that runs many verifications at the same time on a fixed number of
+worker slots."""
+
+from concurrent.futures import Future
+from dataclasses import dataclass, field
+import os
+from queue import SimpleQueue
+from threading import Event, Lock, Thread
+from typing import Any
+
+from esbmc_ai.solution import Solution
+from esbmc_ai.verifier_output import VerifierOutput
+from esbmc_ai.verifiers.base_source_verifier import (
+    BaseSourceVerifier,
+    ProcessLimits,
+    cancel_scope,
+    process_limits,
+)
+
+
+@dataclass
+class VerificationJob:
+    """A work item of the verifier service. The arguments are passed to the
+    verify_source method of the verifier, the ones that are None are left to
+    the verifier to default."""
+
+    solution: Solution
+    params: list[str] | None = None
+    timeout: int | None = None
+    kwargs: dict[str, Any] = field(default_factory=dict)
+    cancel_event: Event | None = None
+    """Kills the verifier process of the job when set."""
+    future: Future[VerifierOutput] = field(default_factory=Future)
+
+
+def available_cpus() -> list[int]:
+    """The CPUs this process is allowed to run on."""
+    if hasattr(os, "sched_getaffinity"):
+        return sorted(os.sched_getaffinity(0))
+    return list(range(os.cpu_count() or 1))
+
+
+class VerifierService:
+    """Runs verifications submitted from any thread on a fixed number of worker
+    slots, each running one verifier process at a time. Jobs are queued and
+    started in the order they were submitted, their results are delivered
+    through futures, so they can be consumed with
+    `concurrent.futures.as_completed` or `wait`.
+
+    Each worker slot can be pinned to a CPU so that the verifier processes
+    don't migrate between cores, and the address space and CPU time of each
+    process can be limited so that a runaway verification doesn't take down the
+    machine.
+
+    Cancelling the future of a job that has not started removes it from the
+    queue, setting the cancel event of a job kills its verifier process."""
+
+    def __init__(
+        self,
+        verifier: BaseSourceVerifier,
+        workers: int | None = None,
+        cpu_affinity: bool = False,
+        memory_limit: int | None = None,
+        cpu_time_limit: int | None = None,
+    ) -> None:
+        cpus: list[int] = available_cpus()
+        self.verifier: BaseSourceVerifier = verifier
+        self.workers: int = workers or len(cpus)
+        if self.workers < 1:
+            raise ValueError("The verifier service needs at least one worker.")
+
+        self._queue: SimpleQueue[VerificationJob | None] = SimpleQueue()
+        self._lock: Lock = Lock()
+        self._closed: bool = False
+        self._threads: list[Thread] = []
+        for slot in range(self.workers):
+            limits: ProcessLimits = ProcessLimits(
+                cpus=frozenset([cpus[slot % len(cpus)]]) if cpu_affinity else None,
+                memory_limit=memory_limit,
+                cpu_time_limit=cpu_time_limit,
+            )
+            thread: Thread = Thread(
+                target=self._work,
+                args=(limits,),
+                name=f"verifier-worker-{slot}",
+                daemon=True,
+            )
+            thread.start()
+            self._threads.append(thread)
+
+    @classmethod
+    def from_config(
+        cls, verifier: BaseSourceVerifier, workers: int | None = None
+    ) -> "VerifierService":
+        """Creates a service with the options of the verifier config. The
+        number of workers can be overridden."""
+        config = verifier.global_config.verifier
+        return cls(
+            verifier=verifier,
+            workers=workers or config.workers,
+            cpu_affinity=config.cpu_affinity,
+            memory_limit=config.memory_limit,
+            cpu_time_limit=config.cpu_time_limit,
+        )
+
+    def _work(self, limits: ProcessLimits) -> None:
+        with process_limits(limits):
+            while True:
+                job: VerificationJob | None = self._queue.get()
+                if job is None:
+                    return
+                if not job.future.set_running_or_notify_cancel():
+                    continue
+                try:
+                    job.future.set_result(self._run(job))
+                except BaseException as e:
+                    job.future.set_exception(e)
+
+    def _run(self, job: VerificationJob) -> VerifierOutput:
+        kwargs: dict[str, Any] = dict(job.kwargs)
+        if job.params is not None:
+            kwargs["params"] = job.params
+        if job.timeout is not None:
+            kwargs["timeout"] = job.timeout
+        if job.cancel_event is None:
+            return self.verifier.verify_source(solution=job.solution, **kwargs)
+        with cancel_scope(job.cancel_event):
+            return self.verifier.verify_source(solution=job.solution, **kwargs)
+
+    def submit_job(self, job: VerificationJob) -> Future[VerifierOutput]:
+        """Queues a job and returns its future."""
+        with self._lock:
+            if self._closed:
+                raise RuntimeError("The verifier service is closed.")
+            self._queue.put(job)
+        return job.future
+
+    def submit(
+        self,
+        solution: Solution,
+        params: list[str] | None = None,
+        timeout: int | None = None,
+        cancel_event: Event | None = None,
+        **kwargs: Any,
+    ) -> Future[VerifierOutput]:
+        """Queues the verification of a solution and returns its future."""
+        return self.submit_job(
+            VerificationJob(
+                solution=solution,
+                params=params,
+                timeout=timeout,
+                kwargs=kwargs,
+                cancel_event=cancel_event,
+            )
+        )
+
+    def close(self, wait: bool = True) -> None:
+        """Stops accepting jobs. The queued jobs are still run, if wait is set
+        this blocks until they have finished."""
+        with self._lock:
+            if self._closed:
+                return
+            self._closed = True
+            for _ in self._threads:
+                self._queue.put(None)
+        if wait:
+            for thread in self._threads:
+                thread.join()
+
+    def __enter__(self) -> "VerifierService":
+        return self
+
+    def __exit__(self, *_) -> None:
+        self.close()
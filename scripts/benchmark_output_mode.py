@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+
+# Author: Yiannis Charalambous
+
+"""Compares the full and diff output modes of the fix-code command end to end.
+Each sample is repaired with esbmc-ai in both modes, using the config file in
+ESBMCAI_CONFIG_FILE (or the environment), and the output tokens, time taken,
+attempts and diff fallbacks are reported.
+
+Usage: benchmark_output_mode.py [--runs N] [samples...]
+Defaults to the C programs in samples/."""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+from pathlib import Path
+from statistics import mean
+from tempfile import TemporaryDirectory
+
+MODES: tuple[str, ...] = ("full", "diff")
+
+
+def run(sample: Path, mode: str, json_path: Path) -> dict | None:
+    """Repairs the sample with esbmc-ai in the output mode, returns the JSON
+    result or None if esbmc-ai failed."""
+    env: dict[str, str] = dict(os.environ, ESBMCAI_OUTPUT_MODE=mode)
+    process = subprocess.run(
+        ["esbmc-ai", "fix-code", str(sample), "--json", "--json-path", str(json_path)],
+        env=env,
+        capture_output=True,
+        text=True,
+        check=False,
+    )
+    if process.returncode != 0 or not json_path.exists():
+        print(f"{sample.name} ({mode}) failed:\n{process.stderr}", file=sys.stderr)
+        return None
+    return json.loads(json_path.read_text())
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--runs", type=int, default=1, help="Runs per sample.")
+    parser.add_argument("samples", nargs="*", type=Path)
+    args = parser.parse_args()
+
+    samples: list[Path] = args.samples or sorted(
+        (Path(__file__).parent.parent / "samples").glob("*.c")
+    )
+    print(
+        f"{'sample':<28}{'mode':<6}{'repaired':>10}{'attempts':>10}"
+        f"{'out tokens':>12}{'seconds':>10}{'fallbacks':>11}"
+    )
+    totals: dict[str, list[float]] = {mode: [0, 0] for mode in MODES}
+    with TemporaryDirectory() as temp_dir:
+        for sample in samples:
+            for mode in MODES:
+                results: list[dict] = []
+                for idx in range(args.runs):
+                    json_path: Path = Path(temp_dir) / f"{sample.stem}_{mode}_{idx}"
+                    result: dict | None = run(sample, mode, json_path)
+                    if result is not None:
+                        results.append(result)
+                if not results:
+                    continue
+                if all(r["attempts"] == 0 for r in results):
+                    # Verifies without a repair, nothing to compare.
+                    break
+
+                output_tokens: float = mean(
+                    (r["token_usage"] or {}).get("output_tokens", 0) for r in results
+                )
+                seconds: float = mean(r["time_taken_seconds"] for r in results)
+                totals[mode][0] += output_tokens
+                totals[mode][1] += seconds
+                print(
+                    f"{sample.name:<28}{mode:<6}"
+                    f"{sum(r['successful'] for r in results):>6}/{len(results):<3}"
+                    f"{mean(r['attempts'] for r in results):>10.1f}"
+                    f"{output_tokens:>12.0f}{seconds:>10.1f}"
+                    f"{sum(r['diff_fallbacks'] for r in results):>11}"
+                )
+
+    for mode in MODES:
+        print(
+            f"Total {mode}: {totals[mode][0]:.0f} output tokens, "
+            f"{totals[mode][1]:.1f} seconds"
+        )
+
+
+if __name__ == "__main__":
+    main()
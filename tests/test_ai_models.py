@@ -1,9 +1,15 @@
 # Author: Yiannis Charalambous
 
 from dataclasses import dataclass, field
-from langchain_core.messages import BaseMessage
+import json
+
+from langchain_core.messages import AIMessage, BaseMessage, HumanMessage, SystemMessage
 from langchain_core.language_models import BaseChatModel, FakeListChatModel
 
+from esbmc_ai.ai_models import AIModel, TokenUsage
+from esbmc_ai.chats.conversation_memory import ConversationTurn
+from esbmc_ai.chats.solution_generator import SolutionGenerator
+
 
 @dataclass(frozen=True, kw_only=True)
 class MockAIModel:
@@ -30,3 +36,67 @@ def test_mock_ai_model_creation() -> None:
     llm = mock_model.create_llm()
     assert llm is not None
     assert isinstance(llm, FakeListChatModel)
+
+
+def test_token_usage() -> None:
+    message = AIMessage(
+        content="",
+        usage_metadata={
+            "input_tokens": 1000,
+            "output_tokens": 50,
+            "total_tokens": 1050,
+            "input_token_details": {"cache_read": 800, "cache_creation": 100},
+        },
+    )
+    usage = TokenUsage.from_message(message)
+    assert usage is not None
+    assert usage.uncached_input_tokens == 100
+
+    total = TokenUsage()
+    total.add(usage)
+    total.add(usage)
+    assert total.calls == 2 and total.cache_read_tokens == 1600
+    assert json.loads(total.model_dump_json())["uncached_input_tokens"] == 200
+
+    assert TokenUsage.from_message(AIMessage(content="")) is None
+
+
+def test_with_cache_control() -> None:
+    message = HumanMessage(content="prompt")
+    marked = AIModel.with_cache_control(message)
+    assert marked.content == [
+        {"type": "text", "text": "prompt", "cache_control": {"type": "ephemeral"}}
+    ]
+    # The original message is left as it is.
+    assert message.content == "prompt"
+
+
+class ChatAnthropic(FakeListChatModel):
+    """Fake model with the name of a model that takes cache markers."""
+
+
+def _marked(messages: list[BaseMessage]) -> list[bool]:
+    return [isinstance(m.content, list) for m in messages]
+
+
+def test_prompt_cache_layout() -> None:
+    generator = SolutionGenerator(
+        ai_model=ChatAnthropic(responses=["a"]),
+        system_message=[SystemMessage(content="system")],
+        prompt_cache=True,
+    )
+    generator.turns = [
+        ConversationTurn(
+            messages=[HumanMessage(content=f"prompt {i}"), AIMessage(content="a")]
+        )
+        for i in range(3)
+    ] + [ConversationTurn(messages=[HumanMessage(content="current")])]
+
+    # The system messages, the pinned first turn and the previous turn.
+    expected = [True, False, True, False, False, False, True, False]
+    assert _marked(generator._request()) == expected
+    assert not any(_marked(generator.messages))
+
+    # Models that cache without markers get the messages as they are.
+    generator.ai_model = FakeListChatModel(responses=["a"])
+    assert not any(_marked(generator._request()))
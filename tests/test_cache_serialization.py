@@ -0,0 +1,173 @@
+# Author: Yiannis Charalambous
+
+"""Tests for the compact serialization of verifier outputs used by the cache."""
+
+import json
+import pickle
+import struct
+import sys
+import zlib
+
+import pytest
+
+from esbmc_ai.cache.serialization import (
+    CODEC_ZLIB,
+    CacheFormatError,
+    dumps,
+    loads,
+)
+from esbmc_ai.issue import VerifierIssue
+from esbmc_ai.verifier_output import ResourceUsage
+from esbmc_ai.verifiers.esbmc import ESBMCOutput, ESBMCOutputParser
+
+
+@pytest.fixture(scope="module")
+def bubble_sort_output() -> ESBMCOutput:
+    with open("./tests/samples/esbmc_output/bubble_sort.txt") as file:
+        return ESBMCOutputParser.parse_output(
+            return_code=1,
+            output=file.read(),
+            duration=1.5,
+        )
+
+
+def test_round_trip(bubble_sort_output: ESBMCOutput) -> None:
+    restored = loads(dumps(bubble_sort_output))
+
+    assert isinstance(restored, ESBMCOutput)
+    assert restored.return_code == bubble_sort_output.return_code
+    assert restored.duration == bubble_sort_output.duration
+    assert restored.issues == bubble_sort_output.issues
+    assert restored.output == bubble_sort_output.output
+    assert restored == bubble_sort_output
+
+
+def test_round_trip_resource_usage(bubble_sort_output: ESBMCOutput) -> None:
+    output = bubble_sort_output.model_copy(
+        update={
+            "resource_usage": ResourceUsage(
+                max_rss=1 << 20, user_time=1.25, system_time=0.5, kill_reason="SIGXCPU"
+            )
+        }
+    )
+    restored = loads(dumps(output))
+    assert restored.resource_usage == output.resource_usage
+    assert restored == output
+
+
+def test_round_trip_zlib(bubble_sort_output: ESBMCOutput) -> None:
+    restored = loads(dumps(bubble_sort_output, codec=CODEC_ZLIB))
+    assert restored == bubble_sort_output
+
+
+def test_output_is_loaded_lazily(bubble_sort_output: ESBMCOutput) -> None:
+    restored = loads(dumps(bubble_sort_output))
+
+    assert "output" not in restored.__dict__
+    assert not restored.successful
+    issue = restored.primary_issue
+    assert isinstance(issue, VerifierIssue)
+    assert issue.counterexample
+    assert "output" not in restored.__dict__
+
+    assert restored.sections.counterexample is not None
+    assert "output" in restored.__dict__
+
+
+def test_dump_loads_output(bubble_sort_output: ESBMCOutput) -> None:
+    restored = loads(dumps(bubble_sort_output))
+    assert restored.model_dump()["output"] == bubble_sort_output.output
+
+
+def test_smaller_than_pickle(bubble_sort_output: ESBMCOutput) -> None:
+    assert len(dumps(bubble_sort_output)) < len(pickle.dumps(bubble_sort_output))
+
+
+def test_rejects_pickle(bubble_sort_output: ESBMCOutput) -> None:
+    with pytest.raises(CacheFormatError):
+        loads(pickle.dumps(bubble_sort_output))
+
+
+def test_rejects_other_version(bubble_sort_output: ESBMCOutput) -> None:
+    data = bytearray(dumps(bubble_sort_output))
+    struct.pack_into("<H", data, 4, 999)
+    with pytest.raises(CacheFormatError):
+        loads(bytes(data))
+
+
+def test_rejects_other_schema(
+    bubble_sort_output: ESBMCOutput, monkeypatch: pytest.MonkeyPatch
+) -> None:
+    data = dumps(bubble_sort_output)
+    monkeypatch.setattr(
+        "esbmc_ai.cache.serialization.schema_fingerprint", lambda _: "changed"
+    )
+    with pytest.raises(CacheFormatError):
+        loads(data)
+
+
+_HEADER: str = "<4sHBII"
+
+
+def _with_meta(data: bytes, **changes) -> bytes:
+    """Rewrites the meta block of a zlib entry, None values remove the key."""
+    magic, version, codec, meta_len, output_crc = struct.unpack_from(_HEADER, data)
+    header_size: int = struct.calcsize(_HEADER)
+    meta = json.loads(zlib.decompress(data[header_size : header_size + meta_len]))
+    for key, value in changes.items():
+        if value is None:
+            del meta[key]
+        else:
+            meta[key] = value
+    meta_blob: bytes = zlib.compress(json.dumps(meta).encode("utf-8"))
+    return (
+        struct.pack(_HEADER, magic, version, codec, len(meta_blob), output_crc)
+        + meta_blob
+        + data[header_size + meta_len :]
+    )
+
+
+def _with_class(data: bytes, class_path: str) -> bytes:
+    """Rewrites the output class named by a zlib entry."""
+    return _with_meta(data, **{"class": class_path})
+
+
+def test_rejects_unknown_class(bubble_sort_output: ESBMCOutput) -> None:
+    """Entries from a shared store can't make the reader import modules."""
+    data = dumps(bubble_sort_output, codec=CODEC_ZLIB)
+    assert "this" not in sys.modules
+    with pytest.raises(CacheFormatError):
+        loads(_with_class(data, "this:VerifierOutput"))
+    assert "this" not in sys.modules
+
+    # Known classes that are not verifier outputs are rejected too.
+    with pytest.raises(CacheFormatError):
+        loads(_with_class(data, "esbmc_ai.issue:Issue"))
+
+
+@pytest.mark.parametrize("codec", [None, CODEC_ZLIB])
+def test_rejects_corrupt_meta(bubble_sort_output: ESBMCOutput, codec) -> None:
+    data = bytearray(dumps(bubble_sort_output, codec=codec))
+    header_size: int = struct.calcsize(_HEADER)
+    data[header_size + 4 : header_size + 12] = b"\xff" * 8
+    with pytest.raises(CacheFormatError):
+        loads(bytes(data))
+
+
+@pytest.mark.parametrize("key", ["class", "schema", "fields", "paths", "issues"])
+def test_rejects_missing_meta_key(bubble_sort_output: ESBMCOutput, key: str) -> None:
+    data = dumps(bubble_sort_output, codec=CODEC_ZLIB)
+    with pytest.raises(CacheFormatError):
+        loads(_with_meta(data, **{key: None}))
+
+
+def test_rejects_corrupt_output(bubble_sort_output: ESBMCOutput) -> None:
+    """A corrupt output is found when the entry is loaded, not when the output
+    is first accessed."""
+    data = bytearray(dumps(bubble_sort_output))
+    data[-8:] = b"\xff" * 8
+    with pytest.raises(CacheFormatError):
+        loads(bytes(data))
+
+    with pytest.raises(CacheFormatError):
+        loads(dumps(bubble_sort_output)[:-1])
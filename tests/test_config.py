@@ -3,7 +3,7 @@
 from pytest import raises
 from pydantic import ValidationError
 
-from esbmc_ai.config import AICustomModelConfig
+from esbmc_ai.config import AICustomModelConfig, ESBMCConfig
 
 
 def test_load_custom_ai() -> None:
@@ -45,3 +45,21 @@ def test_load_custom_ai_fail() -> None:
             max_tokens=100,
             url="www.example.com",
         )
+
+
+def test_escalation_unwind_rejects_iterative_params() -> None:
+    """The unwind bound can't be escalated with the default params, which use
+    k-induction."""
+    escalation = {"enabled": True, "start_unwind": 2}
+    with raises(ValidationError):
+        ESBMCConfig(escalation=escalation)  # type: ignore
+    with raises(ValidationError):
+        ESBMCConfig(
+            params=["--floatbv"],
+            portfolio={"kind": ["--k-induction"]},
+            escalation=escalation,  # type: ignore
+        )
+
+    config = ESBMCConfig(params=["--floatbv"], escalation=escalation)  # type: ignore
+    assert config.escalation.start_unwind == 2
+    ESBMCConfig(escalation={"enabled": True})  # type: ignore
@@ -0,0 +1,96 @@
+# Author: Yiannis Charalambous
+
+"""Tests for the memory policies of the repair conversation."""
+
+from langchain_core.messages import AIMessage, HumanMessage, SystemMessage
+
+from esbmc_ai.chats.conversation_memory import (
+    ConversationTurn,
+    FullMemory,
+    LastTurnsMemory,
+    SummaryMemory,
+    TokenBudgetMemory,
+    create_memory,
+)
+
+SYSTEM = [SystemMessage(content="system")]
+
+
+def _turns(count: int) -> list[ConversationTurn]:
+    """Completed turns followed by the current turn, which has no response."""
+    turns = [
+        ConversationTurn(
+            messages=[
+                HumanMessage(content=f"prompt {i} " + "code " * 20),
+                AIMessage(content=f"response {i}"),
+            ],
+            summary=f"summary {i}",
+        )
+        for i in range(count - 1)
+    ]
+    turns.append(ConversationTurn(messages=[HumanMessage(content="current")]))
+    return turns
+
+
+def _texts(turns: list[ConversationTurn]) -> list[str]:
+    return [message.text for turn in turns for message in turn.messages]
+
+
+def test_full_memory() -> None:
+    turns = _turns(4)
+    assert FullMemory().prune(SYSTEM, turns) == turns
+
+
+def test_last_turns_memory() -> None:
+    kept = LastTurnsMemory(1).prune(SYSTEM, _turns(4))
+    assert [t.messages[0].text.split(" ")[1] for t in kept[:-1]] == ["2"]
+    assert kept[-1].messages[0].text == "current"
+    # The current turn is kept with no previous turns.
+    assert _texts(LastTurnsMemory(0).prune(SYSTEM, _turns(4))) == ["current"]
+
+
+def test_summary_memory() -> None:
+    kept = SummaryMemory(1).prune(SYSTEM, _turns(4))
+    assert len(kept) == 4
+    assert _texts(kept[:2]) == ["summary 0", "summary 1"]
+    assert kept[2].messages[1].text == "response 2"
+    assert not kept[2].collapsed and kept[0].collapsed
+
+    # Collapsing again leaves the summaries as they are.
+    assert _texts(SummaryMemory(1).prune(SYSTEM, kept)[:2]) == [
+        "summary 0",
+        "summary 1",
+    ]
+
+
+def test_token_budget_memory() -> None:
+    def count_tokens(text: str) -> int:
+        return len(text.split())
+
+    turns = _turns(4)
+    # The system message and the current turn take 2 tokens, each completed
+    # turn takes 24.
+    memory = TokenBudgetMemory(FullMemory(), 40, count_tokens)
+    kept = memory.prune(SYSTEM, turns)
+    assert kept == turns[2:]
+
+    # The current turn is kept even when it doesn't fit.
+    assert TokenBudgetMemory(FullMemory(), 1, count_tokens).prune(
+        SYSTEM, turns
+    ) == [turns[-1]]
+
+    # Summarized turns take less space, so more of them fit.
+    memory = TokenBudgetMemory(SummaryMemory(0), 40, count_tokens)
+    assert _texts(memory.prune(SYSTEM, _turns(4))) == [
+        "summary 0",
+        "summary 1",
+        "summary 2",
+        "current",
+    ]
+
+
+def test_create_memory() -> None:
+    assert isinstance(create_memory("summarize", 2), SummaryMemory)
+    memory = create_memory("last_turns", 2, token_budget=100, count_tokens=len)
+    assert isinstance(memory, TokenBudgetMemory)
+    assert isinstance(memory.memory, LastTurnsMemory)
@@ -0,0 +1,128 @@
+# Author: Yiannis Charalambous
+
+import os
+from pathlib import Path
+
+from esbmc_ai.cache import DiskCache
+
+KEY_A: str = "a" * 64
+KEY_B: str = "b" * 64
+KEY_C: str = "c" * 64
+
+
+def test_put_get_sharded(tmp_path: Path) -> None:
+    cache = DiskCache(directory=tmp_path)
+    cache.put(KEY_A, b"result", version="ESBMC version 7.8.0")
+
+    assert cache.get(KEY_A) == b"result"
+    assert (tmp_path / "aa" / "aa" / KEY_A).is_file()
+
+
+def test_get_missing(tmp_path: Path) -> None:
+    cache = DiskCache(directory=tmp_path)
+    assert cache.get(KEY_A) is None
+
+
+def test_stats_hit_rate(tmp_path: Path) -> None:
+    cache = DiskCache(directory=tmp_path)
+    cache.put(KEY_A, b"1234", version="v1")
+    cache.put(KEY_B, b"56", version="v2")
+    cache.get(KEY_A)
+    cache.get(KEY_C)
+
+    stats = cache.stats()
+    assert stats.entries == 2
+    assert stats.total_bytes == 6
+    assert stats.hits == 1
+    assert stats.misses == 1
+    assert stats.hit_rate == 0.5
+    assert stats.versions == {"v1": 1, "v2": 1}
+
+
+def test_lru_eviction(tmp_path: Path) -> None:
+    cache = DiskCache(directory=tmp_path, max_bytes=8)
+    cache.put(KEY_A, b"aaaa")
+    cache.put(KEY_B, b"bbbb")
+    # Access A so that B becomes the least recently used entry.
+    assert cache.get(KEY_A) == b"aaaa"
+    cache.put(KEY_C, b"cccc")
+
+    assert cache.get(KEY_B) is None
+    assert cache.get(KEY_A) == b"aaaa"
+    assert cache.get(KEY_C) == b"cccc"
+    assert cache.stats().total_bytes == 8
+
+
+def test_lru_order_without_clock(tmp_path: Path) -> None:
+    """Accesses made in quick succession are still ordered."""
+    keys = [f"{idx:064x}" for idx in range(10)]
+    cache = DiskCache(directory=tmp_path, max_bytes=10)
+    for key in keys:
+        cache.put(key, b"x")
+    for key in reversed(keys):
+        assert cache.get(key) == b"x"
+    cache.put("f" * 64, b"x")
+
+    # The last key put was the first one read, the least recently used.
+    assert cache.get(keys[-1]) is None
+    assert all(cache.get(key) == b"x" for key in keys[:-1])
+
+
+def test_total_bytes_kept_up_to_date(tmp_path: Path) -> None:
+    """The total size stays in step with the entries when they are replaced
+    and when more entries than a batch are evicted at once."""
+    keys = [f"{idx:064x}" for idx in range(200)]
+    cache = DiskCache(directory=tmp_path)
+    for key in keys:
+        cache.put(key, b"xx")
+    cache.put(keys[0], b"xxxxxx")
+    assert cache.stats().total_bytes == 2 * 200 + 4
+
+    removed, freed = cache.prune(max_bytes=10)
+    assert (removed, freed) == (197, 2 * 197)
+    stats = cache.stats()
+    assert stats.entries == 3
+    assert stats.total_bytes == 10
+    assert cache.get(keys[1]) is None
+    assert cache.get(keys[0]) == b"xxxxxx"
+
+
+def test_prune_to_budget(tmp_path: Path) -> None:
+    cache = DiskCache(directory=tmp_path)
+    cache.put(KEY_A, b"aaaa")
+    cache.put(KEY_B, b"bbbb")
+
+    removed, freed = cache.prune(max_bytes=4)
+    assert (removed, freed) == (1, 4)
+    assert cache.get(KEY_A) is None
+    assert cache.get(KEY_B) == b"bbbb"
+
+
+def test_prune_stale_entries(tmp_path: Path) -> None:
+    # Flat file left by the old cache layout.
+    (tmp_path / KEY_C).write_bytes(b"old")
+    cache = DiskCache(directory=tmp_path)
+    cache.put(KEY_A, b"aaaa")
+    (tmp_path / "aa" / "aa" / KEY_A).unlink()
+
+    removed, _ = cache.prune()
+    assert removed == 2
+    assert not (tmp_path / KEY_C).exists()
+    assert cache.stats().entries == 0
+
+
+def test_prune_stale_temp_files(tmp_path: Path) -> None:
+    """Temporary files left by interrupted puts are removed once they are
+    stale, recent ones may still be written by another process."""
+    cache = DiskCache(directory=tmp_path)
+    cache.put(KEY_A, b"aaaa")
+    stale = tmp_path / "aa" / "aa" / "tmpstale"
+    stale.write_bytes(b"partial")
+    os.utime(stale, (0, 0))
+    recent = tmp_path / "aa" / "aa" / "tmprecent"
+    recent.write_bytes(b"partial")
+
+    assert cache.prune() == (1, 7)
+    assert not stale.exists()
+    assert recent.exists()
+    assert cache.get(KEY_A) == b"aaaa"
@@ -10,10 +10,27 @@ This module tests all aspects of the ESBMC verifier integration including:
 - Error handling for various output formats
 """
 
-from esbmc_ai.verifiers.esbmc import ESBMCOutput, ESBMCOutputParser, ESBMCOutputSections
+from esbmc_ai.verifiers.esbmc import (
+    ESBMC,
+    ESBMCOutput,
+    ESBMCOutputIndex,
+    ESBMCOutputParser,
+    ESBMCOutputSections,
+    ESBMCStreamParser,
+    _get_esbmc_fingerprint,
+    _get_esbmc_version,
+)
 from esbmc_ai.issue import Issue, VerifierIssue
-from esbmc_ai.program_trace import ProgramTrace
+from esbmc_ai.program_trace import CounterexampleProgramTrace, ProgramTrace
+from esbmc_ai.cache import DiskCache
+from esbmc_ai.config import ESBMCConfig
+from esbmc_ai.solution import Solution, SourceFile
+from esbmc_ai.solution_workspace import SolutionWorkspace
 from pathlib import Path
+from shutil import rmtree
+import random
+import re
+from types import SimpleNamespace
 import pytest
 
 
@@ -303,25 +320,28 @@ def test_counterexample_contains_error_location(
 # =============================================================================
 
 
+def _counterexample_sections(output: str) -> list[str]:
+    index = ESBMCOutputIndex.build(output)
+    return [output[start:end] for start, end in index.counterexample_sections()]
+
+
 def test_split_counterexample_sections_single(bubble_sort_raw_output: str) -> None:
     """Test splitting output with single counterexample."""
-    sections = ESBMCOutputParser._split_counterexample_sections(bubble_sort_raw_output)
+    sections = _counterexample_sections(bubble_sort_raw_output)
     assert len(sections) == 1
     assert sections[0].startswith("[Counterexample]")
 
 
 def test_split_counterexample_sections_none() -> None:
     """Test splitting output with no counterexample."""
-    sections = ESBMCOutputParser._split_counterexample_sections(
-        "VERIFICATION SUCCESSFUL"
-    )
+    sections = _counterexample_sections("VERIFICATION SUCCESSFUL")
     assert len(sections) == 0
 
 
 def test_split_counterexample_sections_multiple() -> None:
     """Test splitting output with multiple counterexamples."""
     output = "[Counterexample]\nError 1\n[Counterexample]\nError 2"
-    sections = ESBMCOutputParser._split_counterexample_sections(output)
+    sections = _counterexample_sections(output)
     assert len(sections) == 2
     assert sections[0].startswith("[Counterexample]")
     assert "Error 1" in sections[0]
@@ -334,11 +354,16 @@ def test_split_counterexample_sections_multiple() -> None:
 # =============================================================================
 
 
+def _error_info(output: str) -> tuple[str | None, str | None]:
+    index = ESBMCOutputIndex.build(output)
+    return ESBMCOutputParser._error_info_from_lines(
+        index.indented_lines_after(index.stack_traces, "Stack trace:")
+    )
+
+
 def test_extract_error_type(bubble_sort_raw_output: str) -> None:
     """Test error type and message extraction from violated property."""
-    error_type, error_message = ESBMCOutputParser._extract_error_info(
-        bubble_sort_raw_output
-    )
+    error_type, error_message = _error_info(bubble_sort_raw_output)
     # Should extract the base category (before the colon)
     assert error_type == "dereference failure"
     # Should extract the message (after the colon)
@@ -347,9 +372,7 @@ def test_extract_error_type(bubble_sort_raw_output: str) -> None:
 
 def test_extract_error_type_not_found() -> None:
     """Test error info extraction when not found."""
-    error_type, error_message = ESBMCOutputParser._extract_error_info(
-        "No violated property"
-    )
+    error_type, error_message = _error_info("No violated property")
     assert error_type is None
     assert error_message is None
 
@@ -357,7 +380,7 @@ def test_extract_error_type_not_found() -> None:
 def test_extract_error_type_incomplete_output() -> None:
     """Test error info extraction with incomplete output."""
     output = "Violated property:\n"
-    error_type, error_message = ESBMCOutputParser._extract_error_info(output)
+    error_type, error_message = _error_info(output)
     assert error_type is None
     assert error_message is None
 
@@ -367,11 +390,17 @@ def test_extract_error_type_incomplete_output() -> None:
 # =============================================================================
 
 
+def _violated_property(output: str) -> str | None:
+    index = ESBMCOutputIndex.build(output)
+    lines = index.indented_lines_after(
+        index.violated_properties, "Violated property:"
+    )
+    return lines[0] if lines else None
+
+
 def test_extract_violated_property_section(bubble_sort_raw_output: str) -> None:
     """Test violated property section extraction."""
-    section = ESBMCOutputParser._extract_violated_property_section(
-        bubble_sort_raw_output
-    )
+    section = _violated_property(bubble_sort_raw_output)
     assert section is not None
     # Should return only the property line (stripped), not the headers
     assert (
@@ -384,9 +413,7 @@ def test_extract_violated_property_section(bubble_sort_raw_output: str) -> None:
 
 def test_extract_violated_property_section_not_found() -> None:
     """Test violated property extraction when not found."""
-    section = ESBMCOutputParser._extract_violated_property_section(
-        "No violated property"
-    )
+    section = _violated_property("No violated property")
     assert section is None
 
 
@@ -902,3 +929,591 @@ def test_dijkstra_error_type_and_message(dijkstra_unsafe_output: ESBMCOutput) ->
     # Verify the output contains array bounds violation details
     assert "array bounds violated" in dijkstra_unsafe_output.output
     assert "array `dist' upper bound" in dijkstra_unsafe_output.output
+
+
+# =============================================================================
+# Cache Key Tests
+# =============================================================================
+
+
+def test_esbmc_fingerprint_tracks_binary(tmp_path: Path) -> None:
+    """The fingerprint changes when the binary is replaced."""
+    binary = tmp_path / "esbmc"
+    binary.write_bytes(b"build 1")
+    first = _get_esbmc_fingerprint(binary)
+    assert first and first == _get_esbmc_fingerprint(binary)
+
+    replacement = tmp_path / "esbmc.new"
+    replacement.write_bytes(b"build 2")
+    replacement.replace(binary)
+    assert _get_esbmc_fingerprint(binary) not in ("", first)
+
+
+def test_esbmc_fingerprint_missing_binary(tmp_path: Path) -> None:
+    assert _get_esbmc_fingerprint(tmp_path / "missing") == ""
+
+
+def test_esbmc_version_tracks_binary(tmp_path: Path) -> None:
+    """The version is queried again when the binary is upgraded in place."""
+    binary = tmp_path / "esbmc"
+    binary.write_text("#!/bin/sh\necho 'ESBMC version 7.8.0'\n")
+    binary.chmod(0o755)
+    assert _get_esbmc_version(binary) == "ESBMC version 7.8.0"
+
+    replacement = tmp_path / "esbmc.new"
+    replacement.write_text("#!/bin/sh\necho 'ESBMC version 7.9.0 (upgraded)'\n")
+    replacement.chmod(0o755)
+    replacement.replace(binary)
+    assert _get_esbmc_version(binary) == "ESBMC version 7.9.0 (upgraded)"
+    assert _get_esbmc_version(tmp_path / "missing") == ""
+
+
+def test_cache_id_distinguishes_properties() -> None:
+    """Cache IDs are stable and depend on the type and order of properties."""
+    verifier = ESBMC()
+    key = verifier._compute_cache_id(["main", 30, ["--unwind", "5"], "abc"])
+    assert key == verifier._compute_cache_id(["main", 30, ["--unwind", "5"], "abc"])
+    assert key != verifier._compute_cache_id(["main", 30, ["--unwind", "6"], "abc"])
+    assert key != verifier._compute_cache_id(["main", 30, ["--unwind", "5"], "def"])
+    assert verifier._compute_cache_id([None]) != verifier._compute_cache_id(["None"])
+    assert verifier._compute_cache_id([["a", "b"]]) != verifier._compute_cache_id(
+        [["b", "a"]]
+    )
+
+
+# =============================================================================
+# Streaming Parser Tests
+# =============================================================================
+
+SAMPLE_OUTPUTS: list[str] = [
+    "./tests/samples/esbmc_output/bubble_sort.txt",
+    "./tests/samples/esbmc_output/dijkstra_unsafe.txt",
+    "./tests/samples/esbmc_output/clang_parse_errors/threading.txt",
+]
+
+
+def _stream(output: str, chunk_sizes: random.Random, **kwargs) -> ESBMCStreamParser:
+    parser = ESBMCStreamParser(**kwargs)
+    data = output.encode("utf-8")
+    position = 0
+    while position < len(data):
+        size = chunk_sizes.randint(1, 256)
+        parser.feed(data[position : position + size])
+        position += size
+    parser.close()
+    return parser
+
+
+def test_stream_parser_matches_parse_output() -> None:
+    """Feeding the output in arbitrary chunks gives the same result as parsing
+    it at once."""
+    rng = random.Random(0)
+    for path in SAMPLE_OUTPUTS:
+        with open(path) as file:
+            raw_output = file.read()
+        # Also two counterexamples with color codes.
+        for output in (raw_output, f"\x1b[1m{raw_output}\x1b[0m\n{raw_output}"):
+            expected = ESBMCOutputParser.parse_output(return_code=1, output=output)
+            for _ in range(10):
+                result = _stream(output, rng).to_output(return_code=1)
+                assert result.output == expected.output
+                assert result.issues == expected.issues
+
+
+def test_stream_parser_reports_traces(dijkstra_unsafe_raw_output: str) -> None:
+    traces: list[CounterexampleProgramTrace] = []
+    issues: list[Issue] = []
+    parser = _stream(
+        dijkstra_unsafe_raw_output,
+        random.Random(0),
+        on_trace=traces.append,
+        on_issue=issues.append,
+    )
+    assert issues == parser.issues and len(issues) == 1
+    assert isinstance(issues[0], VerifierIssue)
+    assert traces == issues[0].counterexample
+    assert [t.trace_index for t in traces] == list(range(14))
+
+
+def test_stream_parser_keeps_tail(dijkstra_unsafe_raw_output: str) -> None:
+    parser = _stream(dijkstra_unsafe_raw_output, random.Random(0), max_output_size=500)
+    assert parser.omitted_chars > 0
+    assert parser.output.endswith("Bug found (k = 1)")
+    assert len(parser.output) < 600
+    # The traces are parsed before the output is dropped.
+    assert len(parser.issues[0].counterexample) == 14
+
+
+def _fake_esbmc(tmp_path: Path, script: str, **esbmc_config) -> ESBMC:
+    """ESBMC verifier that runs a shell script in place of ESBMC."""
+    esbmc_path = tmp_path / "esbmc"
+    esbmc_path.write_text("#!/bin/sh\n" + script)
+    esbmc_path.chmod(0o755)
+    verifier = ESBMC()
+    verifier.global_config = SimpleNamespace(  # type: ignore[assignment]
+        temp_file_dir=tmp_path,
+        solution=SimpleNamespace(entry_function="main"),
+        verifier=SimpleNamespace(
+            enable_cache=False,
+            memory_limit=None,
+            cpu_time_limit=None,
+            esbmc=SimpleNamespace(
+                **{
+                    "path": esbmc_path,
+                    "params": [],
+                    "timeout": None,
+                    "max_output_size": None,
+                    "early_exit": False,
+                    "output_format": "text",
+                    "multi_property": False,
+                    "parallel_claims": 1,
+                    "portfolio": {},
+                    "incremental": False,
+                    "incremental_entry_points": [],
+                    "preprocess_cache": False,
+                    "escalation": SimpleNamespace(
+                        enabled=False,
+                        start_timeout=5,
+                        factor=2.0,
+                        start_unwind=None,
+                        max_unwind=64,
+                        use_history=True,
+                    ),
+                }
+                | esbmc_config
+            ),
+        ),
+    )
+    return verifier
+
+
+def _source(tmp_path: Path) -> Solution:
+    source = tmp_path / "bubble_sort.c"
+    source.write_text("int main(void) { return 0; }\n")
+    return Solution([source])
+
+
+def test_esbmc_streams_output(tmp_path: Path) -> None:
+    """ESBMC is run with its output parsed as it is written."""
+    sample = Path(SAMPLE_OUTPUTS[0]).absolute()
+    verifier = _fake_esbmc(tmp_path, f"cat {sample}\nexit 1\n")
+    result = verifier.verify_source(solution=_source(tmp_path))
+    assert result.output == sample.read_text()
+    assert result.return_code == 1 and len(result.issues) == 1
+    assert not result.truncated
+
+
+def test_esbmc_early_exit(tmp_path: Path) -> None:
+    """ESBMC is stopped, along with the processes it started, once the first
+    violated property is read."""
+    sample = Path(SAMPLE_OUTPUTS[0]).absolute()
+    script = f"cat {sample}\nsleep 30\necho done\n"
+
+    verifier = _fake_esbmc(tmp_path, script, early_exit=True)
+    result = verifier.verify_source(solution=_source(tmp_path))
+    assert result.truncated and not result.successful
+    assert result.duration is not None and result.duration < 10
+    assert len(result.issues) == 1
+    assert result.issues[0].error_type == "dereference failure"
+
+    # Runs without a violated property are not stopped. The verify_source
+    # argument takes precedence over the config.
+    verifier = _fake_esbmc(tmp_path, "echo VERIFICATION SUCCESSFUL\n")
+    result = verifier.verify_source(solution=_source(tmp_path), early_exit=True)
+    assert result.successful and not result.truncated
+
+
+def test_esbmc_witness_output(
+    tmp_path: Path, monkeypatch: pytest.MonkeyPatch
+) -> None:
+    """The counterexample is read from the witness ESBMC writes."""
+    sample = Path("./tests/samples/esbmc_output/dijkstra_unsafe.txt").absolute()
+    witness = Path(
+        "./tests/samples/esbmc_output/witness/dijkstra_unsafe.graphml"
+    ).absolute()
+    # The traces are kept if their paths lead to a file of the solution.
+    monkeypatch.chdir(tmp_path)
+    (tmp_path / "samples").mkdir()
+    (tmp_path / "samples" / "dijkstra_unsafe.c").write_text("int main(void);\n")
+    (tmp_path / "main.c").write_text("int main(void) { return 0; }\n")
+    solution = Solution(
+        [tmp_path / "samples" / "dijkstra_unsafe.c", tmp_path / "main.c"]
+    )
+    script = (
+        'while [ "$1" != --witness-output ]; do shift; done\n'
+        f'cp {witness} "$2"\ncat {sample}\nexit 1\n'
+    )
+    verifier = _fake_esbmc(tmp_path, script, output_format="witness")
+    result = verifier.verify_source(solution=solution)
+    (issue,) = result.issues
+    assert isinstance(issue, VerifierIssue)
+    assert issue.error_type == "array bounds violated"
+    assert len(issue.counterexample) == 14
+    assert issue.counterexample[3].assignment == "dist[0] = 2147483647;"
+    # The witness is deleted after it's read.
+    assert not list(tmp_path.glob("*.graphml"))
+
+    # Without a witness the text output is parsed.
+    verifier = _fake_esbmc(
+        tmp_path, f"cat {sample}\nexit 1\n", output_format="witness"
+    )
+    result = verifier.verify_source(solution=solution)
+    (issue,) = result.issues
+    assert isinstance(issue, VerifierIssue)
+    assert len(issue.counterexample) == 14
+    assert issue.counterexample[3].assignment == (
+        "dist[0] = 2147483647 (01111111 11111111 11111111 11111111)"
+    )
+
+    # The output was cut, the issue is kept without its counterexample and
+    # marked as truncated.
+    verifier = _fake_esbmc(
+        tmp_path,
+        f"cat {sample}\nexit 1\n",
+        output_format="witness",
+        max_output_size=2000,
+    )
+    result = verifier.verify_source(solution=solution)
+    (issue,) = result.issues
+    assert isinstance(issue, VerifierIssue)
+    assert issue.error_type == "array bounds violated"
+    assert not issue.counterexample
+    assert result.truncated
+
+    # ESBMC doesn't write a witness when it is stopped early, the states are
+    # parsed from the output as it is read, before it is cut.
+    result = verifier.verify_source(solution=solution, early_exit=True)
+    (issue,) = result.issues
+    assert isinstance(issue, VerifierIssue)
+    assert len(issue.counterexample) == 14
+
+
+def test_esbmc_multi_property(tmp_path: Path) -> None:
+    """Every violated property is reported as an issue."""
+    bubble_sort = Path(SAMPLE_OUTPUTS[0]).absolute()
+    dijkstra = Path("./tests/samples/esbmc_output/dijkstra_unsafe.txt").absolute()
+    script = (
+        'case " $* " in *" --multi-property "*) ;; *) exit 6 ;; esac\n'
+        f"sed '/^VERIFICATION/,$d' {bubble_sort}\n"
+        f"sed -n '/Counterexample/,$p' {dijkstra}\nexit 1\n"
+    )
+    verifier = _fake_esbmc(tmp_path, script, multi_property=True, early_exit=True)
+    result = verifier.verify_source(solution=_source(tmp_path))
+    assert not result.truncated
+    assert [issue.error_type for issue in result.issues] == [
+        "dereference failure",
+        "array bounds violated",
+    ]
+
+    with pytest.raises(ValueError):
+        verifier.verify_source(
+            solution=_source(tmp_path), params=["--multi-property"]
+        )
+
+
+def test_esbmc_parallel_claims(tmp_path: Path) -> None:
+    """The claims are checked in groups by parallel processes, and their
+    results are merged."""
+    sample = Path(SAMPLE_OUTPUTS[0]).absolute()
+    log = tmp_path / "log"
+    script = (
+        f'echo "$@" >> {log}\n'
+        'case " $* " in\n'
+        '*" --show-claims "*) printf "Claim 1:\\nClaim 2:\\nClaim 3:\\n"; exit 0 ;;\n'
+        f'*" --claim 2 "*) cat {sample}; exit 1 ;;\n'
+        "esac\n"
+        "echo VERIFICATION SUCCESSFUL\n"
+    )
+    verifier = _fake_esbmc(tmp_path, script, multi_property=True, parallel_claims=2)
+    result = verifier.verify_source(solution=_source(tmp_path))
+    assert result.return_code == 1 and not result.successful
+    assert [issue.error_type for issue in result.issues] == ["dereference failure"]
+    assert result.sections.status == "VERIFICATION FAILED"
+
+    runs = log.read_text().splitlines()
+    assert sum("--show-claims" in run for run in runs) == 1
+    claim_groups = sorted(re.findall(r"--claim (\d+)", run) for run in runs)
+    assert claim_groups == [[], ["1", "3"], ["2"]]
+    assert result.resource_usage is not None
+
+
+def test_esbmc_portfolio(tmp_path: Path) -> None:
+    """The first conclusive profile wins and the other processes are killed."""
+    sample = Path(SAMPLE_OUTPUTS[0]).absolute()
+    script = (
+        'case " $* " in\n'
+        f'*" --fast "*) cat {sample}; exit 1 ;;\n'
+        '*" --unknown "*) echo VERIFICATION UNKNOWN; exit 0 ;;\n'
+        '*" --slow "*) sleep 30 ;;\n'
+        "esac\n"
+        "echo VERIFICATION SUCCESSFUL\n"
+    )
+    verifier = _fake_esbmc(
+        tmp_path,
+        script,
+        portfolio={"slow": ["--slow"], "fast": ["--fast"], "unknown": ["--unknown"]},
+    )
+    result = verifier.verify_source(solution=_source(tmp_path))
+    assert result.profile == "fast"
+    assert result.issues[0].error_type == "dereference failure"
+    assert result.duration is not None and result.duration < 10
+
+    # Inconclusive results don't win, and explicit params don't use the
+    # portfolio.
+    result = verifier.verify_source(
+        solution=_source(tmp_path),
+        portfolio={"unknown": ["--unknown"], "success": ["--success"]},
+    )
+    assert result.profile == "success" and result.successful
+    result = verifier.verify_source(solution=_source(tmp_path), params=["--fast"])
+    assert result.profile is None
+
+    with pytest.raises(ValueError):
+        verifier.verify_source(
+            solution=_source(tmp_path), portfolio={"bad": ["--function", "f"]}
+        )
+
+
+def test_esbmc_escalation(tmp_path: Path) -> None:
+    """The timeout and unwind bound grow until the verification is decided,
+    and the next verification of the same program starts from the smallest
+    budget known to be enough."""
+    sample = Path(SAMPLE_OUTPUTS[0]).read_text()
+    unwinding = tmp_path / "unwinding.txt"
+    unwinding.write_text(
+        sample.replace(
+            "dereference failure: array bounds violated", "unwinding assertion loop 0"
+        )
+    )
+    log = tmp_path / "log"
+    # Deciding the verification takes 1.5s, so 1s is not enough.
+    script = (
+        'case " $* " in *" --version "*) echo ESBMC version 7.6.1; exit 0 ;; esac\n'
+        f'echo "$@" >> {log}\n'
+        'case " $* " in\n'
+        '*" --timeout 1s "*) echo "[ERROR] Timed out"; exit 1 ;;\n'
+        f'*" --unwind 2 "*|*" --unwind 4 "*) cat {unwinding}; exit 1 ;;\n'
+        "esac\n"
+        "sleep 1.5\n"
+        "echo VERIFICATION SUCCESSFUL\n"
+    )
+    verifier = _fake_esbmc(tmp_path, script, timeout=60)
+    config = verifier.global_config.verifier
+    config.esbmc.escalation.enabled = True
+    config.esbmc.escalation.start_timeout = 1
+    config.esbmc.escalation.start_unwind = 2
+    config.enable_cache = True
+    verifier.cache = DiskCache(directory=tmp_path / "cache")
+
+    def runs() -> list[tuple[str, str]]:
+        """The timeout and unwind bound of each run since the last call."""
+        found = [
+            (
+                re.findall(r"--timeout (\S+)", run)[0],
+                re.findall(r"--unwind (\S+)", run)[0],
+            )
+            for run in log.read_text().splitlines()
+        ]
+        log.unlink()
+        return found
+
+    result = verifier.verify_source(solution=_source(tmp_path))
+    assert result.successful
+    assert runs() == [("1s", "2"), ("2s", "2"), ("2s", "4"), ("2s", "8")]
+
+    # The same code with another timeout is not in the cache, it starts from
+    # the budget that was enough.
+    result = verifier.verify_source(solution=_source(tmp_path), timeout=30)
+    assert result.successful
+    assert runs() == [("2s", "8")]
+
+    # An edited attempt of the program, in a workspace, starts from the budget
+    # that was enough. The bound was enough from the start last time, so a
+    # smaller one is tried first.
+    solution = _source(tmp_path)
+    with SolutionWorkspace(solution, temp_dir=tmp_path) as workspace:
+        attempt = Solution([])
+        attempt.add_source_file(
+            SourceFile(
+                file_path=solution.files[0].file_path,
+                content="int main(void) { return 1; }\n",
+            )
+        )
+        with workspace.attempt(attempt) as materialized:
+            assert materialized.program_digest == solution.digest
+            result = verifier.verify_source(solution=materialized)
+    assert result.successful
+    assert runs() == [("2s", "4"), ("2s", "8")]
+
+    # Another program, even with the same file name and entry function,
+    # starts from the beginning.
+    other = tmp_path / "other" / "bubble_sort.c"
+    other.parent.mkdir()
+    other.write_text("int main(void) { return 2; }\n")
+    result = verifier.verify_source(solution=Solution([other]))
+    assert result.successful
+    assert runs() == [("1s", "2"), ("2s", "2"), ("2s", "4"), ("2s", "8")]
+
+
+def test_esbmc_escalation_params(tmp_path: Path) -> None:
+    """The escalation replaces the unwind bound of the params, and rejects
+    params that grow the bound themselves, such as the default ones."""
+    log = tmp_path / "log"
+    script = (
+        'case " $* " in *" --version "*) echo ESBMC version 7.6.1; exit 0 ;; esac\n'
+        f'echo "$@" >> {log}\n'
+        "echo VERIFICATION SUCCESSFUL\n"
+    )
+    verifier = _fake_esbmc(
+        tmp_path,
+        script,
+        params=["--floatbv", "--unwind", "10", "--unwind=20"],
+        portfolio={"bmc": ["--unwind", "5"], "float": ["--floatbv"]},
+    )
+    escalation = verifier.global_config.verifier.esbmc.escalation
+    escalation.enabled = True
+    escalation.start_unwind = 2
+
+    result = verifier.verify_source(solution=_source(tmp_path), portfolio={})
+    assert result.successful
+    assert re.findall(r"--unwind\S*(?: \d+)?", log.read_text()) == ["--unwind 2"]
+    log.unlink()
+
+    result = verifier.verify_source(solution=_source(tmp_path))
+    assert result.successful
+    # The profile that lost may have been stopped before it started.
+    runs = log.read_text().splitlines()
+    assert runs
+    for run in runs:
+        assert re.findall(r"--unwind\S*(?: \d+)?", run) == ["--unwind 2"]
+
+    with pytest.raises(ValueError):
+        verifier.verify_source(
+            solution=_source(tmp_path),
+            params=ESBMCConfig.model_fields["params"].default,
+        )
+
+
+def test_esbmc_incremental(tmp_path: Path) -> None:
+    """Only the entry points that reach a changed function are verified
+    again."""
+    log = tmp_path / "log"
+    script = (
+        'case " $* " in *" --version "*) echo ESBMC version 7.6.1; exit 0 ;; esac\n'
+        f'echo "$@" >> {log}\n'
+        "echo VERIFICATION SUCCESSFUL\n"
+    )
+    verifier = _fake_esbmc(
+        tmp_path, script, incremental=True, incremental_entry_points=["f", "g"]
+    )
+    verifier.global_config.verifier.enable_cache = True
+    verifier.cache = DiskCache(directory=tmp_path / "cache")
+
+    source = tmp_path / "program.c"
+
+    def verify(content: str) -> list[str]:
+        """The entry points that were run."""
+        source.write_text(content)
+        log.write_text("")
+        result = verifier.verify_source(solution=Solution([source]))
+        assert result.successful
+        return sorted(re.findall(r"--function (\w+)", log.read_text()))
+
+    program = (
+        "int h(int x) {\n  return x;\n}\n\n"
+        "int f(int x) {\n  return h(x);\n}\n\n"
+        "int g(int x) {\n  return x + 1;\n}\n"
+    )
+    assert verify(program) == ["f", "g"]
+    assert verify(program.replace("return x;", "return x * 2;")) == ["f"]
+    assert verify(program.replace("x + 1", "x + 2")) == ["g"]
+
+
+def test_esbmc_preprocess_cache(tmp_path: Path) -> None:
+    """Only the edited files are preprocessed again, the units of the others
+    are reused from the cache with the paths of the current working dir."""
+    log = tmp_path / "log"
+    script = (
+        'case " $* " in *" --version "*) echo ESBMC version 7.6.1; exit 0 ;; esac\n'
+        'case " $* " in *" --preprocess "*)\n'
+        f'  echo "preprocess $3" >> {log}\n'
+        '  echo "# 1 \\"$3\\""\n'
+        "  echo 'int x;'\n"
+        "  exit 0 ;;\n"
+        "esac\n"
+        f'for arg; do case "$arg" in *.i) cat "$arg" >> {log} ;; esac; done\n'
+        "echo VERIFICATION SUCCESSFUL\n"
+    )
+    verifier = _fake_esbmc(tmp_path, script, preprocess_cache=True)
+    verifier.global_config.verifier.enable_cache = True
+    verifier.cache = DiskCache(directory=tmp_path / "cache")
+
+    def verify(directory: Path, b: str) -> list[str]:
+        directory.mkdir()
+        (directory / "a.c").write_text("int main(void) { return 0; }\n")
+        (directory / "b.c").write_text(b)
+        log.write_text("")
+        result = verifier.verify_source(
+            solution=Solution([directory / "a.c", directory / "b.c"])
+        )
+        assert result.successful
+        return log.read_text().splitlines()
+
+    first = tmp_path / "attempt-1"
+    assert verify(first, "int b;\n") == [
+        f"preprocess {first / 'a.c'}",
+        f"preprocess {first / 'b.c'}",
+        f'# 1 "{first / "a.c"}"',
+        "int x;",
+        f'# 1 "{first / "b.c"}"',
+        "int x;",
+    ]
+    second = tmp_path / "attempt-2"
+    assert verify(second, "long b;\n") == [
+        f"preprocess {second / 'b.c'}",
+        f'# 1 "{second / "a.c"}"',
+        "int x;",
+        f'# 1 "{second / "b.c"}"',
+        "int x;",
+    ]
+    assert not list(tmp_path.glob("esbmc-units-*"))
+
+
+def test_esbmc_preprocess_cache_headers(tmp_path: Path) -> None:
+    """A cached unit is preprocessed again when a header it was made from
+    changes, even one that is not part of the solution or its include dirs."""
+    log = tmp_path / "log"
+    header = tmp_path / "local.h"
+    header.write_text("int local;\n")
+    script = (
+        'case " $* " in *" --version "*) echo ESBMC version 7.6.1; exit 0 ;; esac\n'
+        f'echo "preprocess $3" >> {log}\n'
+        'echo "# 1 \\"$3\\""\n'
+        "echo '# 1 \"<built-in>\" 1'\n"
+        'echo "# 1 \\"local.h\\" 1"\n'
+        "echo 'int local;'\n"
+    )
+    verifier = _fake_esbmc(tmp_path, script, preprocess_cache=True)
+    verifier.global_config.verifier.enable_cache = True
+    verifier.cache = DiskCache(directory=tmp_path / "cache")
+    (tmp_path / "a.c").write_text('#include "local.h"\n')
+    solution = Solution([tmp_path / "a.c"])
+
+    def preprocessed() -> int:
+        log.write_text("")
+        units_dir = tmp_path / "units"
+        units_dir.mkdir()
+        verifier._preprocessed_units(solution, [], units_dir)
+        rmtree(units_dir)
+        return len(log.read_text().splitlines())
+
+    assert preprocessed() == 1
+    assert preprocessed() == 0
+    header.write_text("long local;\n")
+    assert preprocessed() == 1
+    assert preprocessed() == 0
+
+    # Units that name a file that can't be read are not cached.
+    header.unlink()
+    assert preprocessed() == 1
+    assert preprocessed() == 1
@@ -0,0 +1,182 @@
+# Author: Yiannis Charalambous
+
+"""Tests and benchmark of the ESBMC output index, which ESBMCStreamParser
+builds in the same pass that parses the issues. The benchmark compares
+wall-clock times, so it only runs with ESBMCAI_BENCHMARK=1."""
+
+import os
+from pathlib import Path
+from time import perf_counter
+from typing import Callable
+
+import pytest
+
+from esbmc_ai.verifiers.esbmc import (
+    ESBMCOutputIndex,
+    ESBMCOutputParser,
+    ESBMCOutputSections,
+    ESBMCStreamParser,
+)
+
+SAMPLES_DIR: Path = Path("./tests/samples/esbmc_output")
+
+
+def _corpus() -> dict[str, str]:
+    """The sample outputs, plus a large counterexample made from the states
+    of dijkstra_unsafe."""
+    corpus: dict[str, str] = {
+        str(path.relative_to(SAMPLES_DIR)): path.read_text()
+        for path in sorted(SAMPLES_DIR.rglob("*.txt"))
+    }
+    head, counterexample = corpus["dijkstra_unsafe.txt"].split("[Counterexample]")
+    states, last_state = counterexample.split("\n\nState 14")
+    corpus["large_counterexample"] = (
+        head * 100 + "[Counterexample]" + states * 300 + "\n\nState 14" + last_state
+    )
+    return corpus
+
+
+def _assert_markers(index: ESBMCOutputIndex) -> None:
+    for offsets, marker in (
+        (index.counterexamples, "[Counterexample]"),
+        (index.violated_properties, "Violated property:"),
+        (index.stack_traces, "Stack trace:"),
+    ):
+        for offset in offsets:
+            assert index.output.startswith(marker, offset)
+
+
+def test_index_bubble_sort() -> None:
+    result = ESBMCOutputParser.parse_output(
+        1, (SAMPLES_DIR / "bubble_sort.txt").read_text()
+    )
+    index = result.output_index
+    assert index.output == result.output
+    assert len(index.counterexamples) == 1
+    assert len(index.violated_properties) == 1
+    assert len(index.stack_traces) == 1
+    _assert_markers(index)
+    assert not index.parsing_error
+
+    (issue,) = result.issues
+    assert issue.error_type == "dereference failure"
+    assert issue.message == "array bounds violated"
+    assert [(t.name, t.line_idx) for t in issue.stack_trace] == [
+        ("main", 18),
+        ("buggy_bubble_sort", 6),
+    ]
+
+    sections = ESBMCOutputSections.from_index(index)
+    assert sections.violated_property == "dereference failure: array bounds violated"
+    assert sections.stack_trace == (
+        "c:@F@buggy_bubble_sort at file samples/bubble_sort.c line 19 column 3 "
+        "function main\nc:@F@main"
+    )
+    assert sections.status == "VERIFICATION FAILED"
+    assert sections.counterexample is not None
+    assert sections.counterexample.startswith("[Counterexample]\n\n\nState 1 ")
+    assert sections.counterexample.endswith("VERIFICATION FAILED\n\nBug found (k = 5)")
+
+
+def test_index_dijkstra() -> None:
+    result = ESBMCOutputParser.parse_output(
+        1, (SAMPLES_DIR / "dijkstra_unsafe.txt").read_text()
+    )
+    (issue,) = result.issues
+    assert issue.error_type == "array bounds violated"
+    assert issue.message == "array `dist' upper bound: (signed long int)i < 5"
+    assert len(issue.counterexample) == 14
+    first, last = issue.counterexample[0], issue.counterexample[-1]
+    assert (first.name, first.line_idx) == ("main", 54)
+    assert first.assignment is not None and first.assignment.startswith("graph = ")
+    assert (last.name, last.line_idx, last.assignment) == ("dijkstra", 32, None)
+
+    sections = result.sections
+    assert sections.violated_property == "(signed long int)i < 5"
+    assert sections.status == "VERIFICATION FAILED"
+
+
+def test_index_variants() -> None:
+    """Colored, CRLF and repeated outputs are parsed like the plain output."""
+    for name, output in _corpus().items():
+        plain = ESBMCOutputParser.parse_output(1, output)
+        colored = ESBMCOutputParser.parse_output(
+            1, output.replace("[Counterexample]", "\x1b[1m[Counterexample]\x1b[0m")
+        )
+        assert colored.output == plain.output, name
+        assert colored.issues == plain.issues, name
+        assert colored.output_index == plain.output_index, name
+
+        crlf = ESBMCOutputParser.parse_output(1, output.replace("\n", "\r\n"))
+        assert crlf.issues == plain.issues, name
+        _assert_markers(crlf.output_index)
+
+        twice = ESBMCOutputParser.parse_output(1, output + "\n" + output)
+        assert len(twice.output_index.counterexamples) == 2 * len(
+            plain.output_index.counterexamples
+        )
+        _assert_markers(twice.output_index)
+        if not plain.output_index.parsing_error:
+            assert len(twice.issues) == 2 * len(plain.issues), name
+
+
+def test_index_truncated_output() -> None:
+    """Only the markers of the retained output are indexed."""
+    output: str = (SAMPLES_DIR / "bubble_sort.txt").read_text()
+    parser = ESBMCStreamParser(max_output_size=len(output))
+    parser.feed(output + output)
+    result = parser.to_output(1)
+    index = result.output_index
+    assert parser.omitted_chars > 0
+    assert index.output == result.output
+    assert len(index.counterexamples) == 1
+    _assert_markers(index)
+    assert ESBMCOutputSections.from_index(index).status == "VERIFICATION FAILED"
+    assert len(result.issues) == 2
+
+
+def test_index_chunks() -> None:
+    """The index does not depend on where the chunks of output end."""
+    output: str = (SAMPLES_DIR / "dijkstra_unsafe.txt").read_text()
+    parser = ESBMCStreamParser()
+    for start in range(0, len(output), 7):
+        parser.feed(output[start : start + 7].encode())
+    parser.close()
+    assert parser.index == ESBMCOutputIndex.build(output)
+
+
+def test_index_parsing_error() -> None:
+    output: str = (SAMPLES_DIR / "clang_parse_errors" / "threading.txt").read_text()
+    index = ESBMCOutputIndex.build(output)
+    assert index.parsing_error
+    assert len(ESBMCOutputParser.parse_output(1, output).issues) == 2
+    assert ESBMCOutputIndex.build("VERIFICATION SUCCESSFUL").status == (0, 23)
+
+
+def _best_time(parse: Callable[[str], object], output: str) -> float:
+    repeat: int = max(1, 200_000 // len(output))
+    best: float = float("inf")
+    for _ in range(5):
+        start = perf_counter()
+        for _ in range(repeat):
+            parse(output)
+        best = min(best, (perf_counter() - start) / repeat)
+    return best
+
+
+@pytest.mark.skipif(
+    os.environ.get("ESBMCAI_BENCHMARK") != "1", reason="Set ESBMCAI_BENCHMARK=1"
+)
+def test_benchmark_index() -> None:
+    """Prints the time to index and to parse each output of the corpus, run
+    with -s to see it."""
+    print()
+    print(f"{'output':<40}{'size':>10}{'index (ms)':>12}{'parse (ms)':>12}")
+    for name, output in _corpus().items():
+        index: float = _best_time(ESBMCOutputIndex.build, output)
+        parse: float = _best_time(
+            lambda text: ESBMCOutputParser.parse_output(1, text), output
+        )
+        print(
+            f"{name:<40}{len(output):>10}{index * 1e3:>12.3f}{parse * 1e3:>12.3f}"
+        )
@@ -0,0 +1,170 @@
+# Author: Yiannis Charalambous
+
+"""Tests for the parser of the GraphML witnesses of ESBMC. The witnesses of
+ESBMC itself are checked by the tests that run it, which are skipped when
+esbmc is not on the PATH."""
+
+from io import BytesIO
+from pathlib import Path
+import shutil
+import subprocess
+
+import pytest
+
+from esbmc_ai.verifiers.esbmc import ESBMCOutput, ESBMCOutputParser
+from esbmc_ai.verifiers.esbmc_witness import (
+    ESBMCWitness,
+    WitnessParseError,
+    parse_witness,
+)
+
+WITNESS: Path = Path("./tests/samples/esbmc_output/witness/dijkstra_unsafe.graphml")
+
+needs_esbmc = pytest.mark.skipif(
+    shutil.which("esbmc") is None, reason="esbmc is not installed"
+)
+
+
+def test_witness_matches_text_output() -> None:
+    """The states of the witness are the ones of the text output, with the
+    assignments written as C statements. The witness is written by hand after
+    the text output, see the tests that run ESBMC for its own witnesses."""
+    witness = parse_witness(WITNESS)
+    with open("./tests/samples/esbmc_output/dijkstra_unsafe.txt") as file:
+        output = ESBMCOutputParser.parse_output(return_code=1, output=file.read())
+
+    counterexample = output.issues[0].counterexample  # type: ignore[attr-defined]
+    assert len(witness.counterexample) == len(counterexample)
+    for parsed, expected in zip(witness.counterexample, counterexample):
+        assert parsed.trace_index == expected.trace_index
+        assert parsed.path == expected.path
+        assert parsed.line_idx == expected.line_idx
+        assert parsed.name == expected.name
+        assert (parsed.assignment is None) == (expected.assignment is None)
+
+    assert witness.counterexample[1].assignment == "dist = { 0, 0, 0, 0, 0 };"
+    assert witness.violation is not None
+    assert witness.violation.line_idx == 32
+    assert witness.violation.name == "dijkstra"
+
+
+def test_witness_function_scope() -> None:
+    """Without assumption.scope the function comes from the call edges."""
+    witness = parse_witness(
+        BytesIO(
+            b'<graphml xmlns="http://graphml.graphdrawing.org/xmlns">'
+            b'<key id="d1" attr.name="originfile" for="edge"/>'
+            b'<key id="d2" attr.name="startline" for="edge"/>'
+            b'<key id="d3" attr.name="assumption" for="edge"/>'
+            b'<key id="d4" attr.name="enterFunction" for="edge"/>'
+            b'<key id="d5" attr.name="returnFromFunction" for="edge"/>'
+            b'<key id="d6" attr.name="violation" for="node"/>'
+            b'<graph edgedefault="directed"><node id="A"/><node id="B"/>'
+            b'<edge source="A" target="B"><data key="d4">f</data>'
+            b'<data key="d1">a.c</data><data key="d2">3</data>'
+            b'<data key="d3">x = 1;</data><data key="d5">f</data></edge>'
+            b'<node id="C"><data key="d6">true</data></node>'
+            b'<edge source="B" target="C"><data key="d1">a.c</data>'
+            b'<data key="d2">9</data><data key="d3">y = 2;</data></edge>'
+            b"</graph></graphml>"
+        )
+    )
+    assert [(t.name, t.line_idx, t.assignment) for t in witness.counterexample] == [
+        ("f", 2, "x = 1;"),
+        (None, 8, "y = 2;"),
+        (None, 8, None),
+    ]
+
+
+def test_witness_threads() -> None:
+    """The calls of each thread are tracked on their own, as the edges of the
+    threads are interleaved."""
+    witness = parse_witness(
+        BytesIO(
+            b'<graphml xmlns="http://graphml.graphdrawing.org/xmlns">'
+            b'<key id="d1" attr.name="originfile" for="edge"/>'
+            b'<key id="d2" attr.name="startline" for="edge"/>'
+            b'<key id="d3" attr.name="assumption" for="edge"/>'
+            b'<key id="d4" attr.name="enterFunction" for="edge"/>'
+            b'<key id="d5" attr.name="returnFromFunction" for="edge"/>'
+            b'<key id="d6" attr.name="threadId" for="edge"/>'
+            b'<graph edgedefault="directed">'
+            b'<edge source="A" target="B"><data key="d6">0</data>'
+            b'<data key="d4">main</data></edge>'
+            b'<edge source="B" target="C"><data key="d6">1</data>'
+            b'<data key="d4">worker</data><data key="d1">a.c</data>'
+            b'<data key="d2">3</data><data key="d3">b = 1;</data></edge>'
+            b'<edge source="C" target="D"><data key="d6">0</data>'
+            b'<data key="d1">a.c</data><data key="d2">9</data>'
+            b'<data key="d3">a = 1;</data></edge>'
+            b'<edge source="D" target="E"><data key="d6">1</data>'
+            b'<data key="d5">worker</data></edge>'
+            b'<edge source="E" target="F"><data key="d6">0</data>'
+            b'<data key="d1">a.c</data><data key="d2">10</data>'
+            b'<data key="d3">a = 2;</data></edge>'
+            b"</graph></graphml>"
+        )
+    )
+    assert [(t.name, t.assignment) for t in witness.counterexample] == [
+        ("worker", "b = 1;"),
+        ("main", "a = 1;"),
+        ("main", "a = 2;"),
+    ]
+
+
+def _run_esbmc(tmp_path: Path, source: Path) -> tuple[ESBMCWitness, ESBMCOutput]:
+    """Runs ESBMC on source, returns its witness and its text output."""
+    witness_path: Path = tmp_path / f"{source.stem}.graphml"
+    process = subprocess.run(
+        ["esbmc", str(source), "--witness-output", str(witness_path)],
+        capture_output=True,
+        text=True,
+        timeout=300,
+        check=False,
+    )
+    output = ESBMCOutputParser.parse_output(
+        return_code=process.returncode, output=process.stdout
+    )
+    return parse_witness(witness_path), output
+
+
+@needs_esbmc
+def test_esbmc_witness_function_calls(tmp_path: Path) -> None:
+    """The witness of ESBMC, where the functions come from the call edges,
+    matches its text output."""
+    witness, output = _run_esbmc(tmp_path, Path("samples/dijkstra_unsafe.c"))
+    counterexample = output.issues[0].counterexample  # type: ignore[attr-defined]
+    assert [(t.line_idx, t.name) for t in witness.counterexample] == [
+        (t.line_idx, t.name) for t in counterexample
+    ]
+    assert witness.violation is not None
+    assert witness.violation.line_idx == 32
+    assert witness.violation.name == "dijkstra"
+
+
+@needs_esbmc
+def test_esbmc_witness_threads(tmp_path: Path) -> None:
+    """The witness of a multi-threaded program, where the edges of the threads
+    are interleaved, leads to the violated assertion of main."""
+    witness, output = _run_esbmc(tmp_path, Path("samples/threading.c"))
+    assert not output.successful
+    assert witness.counterexample
+    assert witness.violation is not None
+    assert witness.violation.line_idx == 22
+    assert witness.violation.name == "main"
+
+
+def test_witness_errors() -> None:
+    with pytest.raises(WitnessParseError):
+        parse_witness(BytesIO(b""))
+    with pytest.raises(WitnessParseError):
+        parse_witness(BytesIO(b"<graphml><graph>"))
+    with pytest.raises(WitnessParseError):
+        parse_witness(Path("./tests/samples/esbmc_output/missing.graphml"))
+    with pytest.raises(WitnessParseError):
+        parse_witness(
+            BytesIO(
+                b'<graphml><key id="t" attr.name="witness-type" for="graph"/>'
+                b'<graph><data key="t">correctness_witness</data></graph></graphml>'
+            )
+        )
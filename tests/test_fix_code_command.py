@@ -0,0 +1,260 @@
+# Author: Yiannis Charalambous
+
+"""Tests for the parallel repair of the fix code command, with a fake LLM and
+a fake verifier."""
+
+from pathlib import Path
+from time import sleep
+from types import SimpleNamespace
+from typing import override
+
+import pytest
+from langchain_core.messages import AIMessage, BaseMessage, HumanMessage
+from langchain_core.prompts import PromptTemplate
+
+from esbmc_ai.chats.conversation_memory import ConversationTurn
+from esbmc_ai.chats.solution_generator import SolutionGenerator
+from esbmc_ai.commands.fix_code_command import FixCodeCommand, FixCodeCommandConfig
+from esbmc_ai.loading_widget import BaseLoadingWidget
+from esbmc_ai.solution import Solution, SourceFile
+from esbmc_ai.solution_workspace import SolutionWorkspace
+from esbmc_ai.verifier_output import VerifierOutput
+from esbmc_ai.verifiers.base_source_verifier import (
+    BaseSourceVerifier,
+    VerifierCancelledException,
+    current_cancel_event,
+)
+
+# The template is not rendered, see _generator.
+PROMPT = PromptTemplate(template="", input_variables=[])
+
+
+class FakeOutput(VerifierOutput):
+    @property
+    @override
+    def successful(self) -> bool:
+        return self.return_code == 0
+
+
+class FakeVerifier(BaseSourceVerifier):
+    """Verifies code without running anything: code that contains "fixed"
+    verifies. Code that contains "slow" runs until it is cancelled, code that
+    contains "delay" takes a little longer than the rest, and code that
+    contains "error" fails to verify."""
+
+    def __init__(self) -> None:
+        super().__init__(verifier_name="fake", authors="")
+        self.global_config = SimpleNamespace(  # type: ignore[assignment]
+            verifier=SimpleNamespace(
+                workers=None, cpu_affinity=None, memory_limit=None, cpu_time_limit=None
+            )
+        )
+        self.verified: list[str] = []
+        self.cancelled: list[str] = []
+
+    @override
+    def verify_source(self, *, solution: Solution, **_) -> VerifierOutput:
+        code: str = solution.files[0].content
+        self.verified.append(code)
+        if "slow" in code:
+            cancel_event = current_cancel_event()
+            assert cancel_event is not None and cancel_event.wait(10)
+            self.cancelled.append(code)
+            raise VerifierCancelledException()
+        if "error" in code:
+            raise RuntimeError("The verifier failed")
+        if "delay" in code:
+            sleep(0.2)
+        return FakeOutput(
+            return_code=0 if "fixed" in code else 1, output=code, duration=0
+        )
+
+
+class BatchModel:
+    """Stands in for a chat model, each batch is answered with the next list
+    of candidates."""
+
+    def __init__(self, batches: list[list[str]]) -> None:
+        self.batches: list[list[str]] = batches
+
+    def batch(self, requests: list[list[BaseMessage]]) -> list[AIMessage]:
+        candidates: list[str] = self.batches.pop(0)
+        assert len(requests) == len(candidates)
+        return [AIMessage(content=f"```c\n{code}\n```") for code in candidates]
+
+
+def _generator(
+    monkeypatch: pytest.MonkeyPatch, batches: list[list[str]]
+) -> tuple[SolutionGenerator, list[VerifierOutput]]:
+    """The generator and the verifier outputs its prompts were rendered
+    with."""
+    generator = SolutionGenerator(ai_model=BatchModel(batches))  # type: ignore
+    prompted: list[VerifierOutput] = []
+
+    def push_prompt(_, __, verifier_output: VerifierOutput) -> ConversationTurn:
+        # Skips rendering the template.
+        prompted.append(verifier_output)
+        turn = ConversationTurn(messages=[HumanMessage(content="prompt")])
+        generator.turns.append(turn)
+        return turn
+
+    monkeypatch.setattr(generator, "_push_prompt", push_prompt)
+    return generator, prompted
+
+
+def _command(monkeypatch: pytest.MonkeyPatch, candidates: int) -> FixCodeCommand:
+    # The default config of the command is created without a config file.
+    monkeypatch.setattr(
+        "esbmc_ai.base_component.Config", lambda: SimpleNamespace(config_file=None)
+    )
+    command = FixCodeCommand()
+    command.global_config = SimpleNamespace(  # type: ignore[assignment]
+        solution=SimpleNamespace(output_dir=None), generate_patches=False
+    )
+    command.config = FixCodeCommandConfig.model_construct(
+        candidates=candidates, max_attempts=2
+    )
+    command.anim = BaseLoadingWidget()
+    return command
+
+
+def _solution(tmp_path: Path) -> Solution:
+    path = tmp_path / "main.c"
+    path.write_text("int broken;\n")
+    solution = Solution([])
+    solution.add_source_file(SourceFile(file_path=path, content="int broken;\n"))
+    return solution
+
+
+def _repair(
+    command: FixCodeCommand,
+    generator: SolutionGenerator,
+    verifier: FakeVerifier,
+    solution: Solution,
+    workspace: SolutionWorkspace,
+    attempt: int,
+    verifier_output: VerifierOutput,
+):
+    return command._attempt_parallel_repair(
+        attempt=attempt,
+        solution_generator=generator,
+        prompt=PROMPT,
+        solution=solution,
+        verifier=verifier,
+        verifier_output=verifier_output,
+        workspace=workspace,
+    )
+
+
+def test_stops_at_first_verified_candidate(
+    tmp_path: Path, monkeypatch: pytest.MonkeyPatch
+) -> None:
+    generator, _ = _generator(monkeypatch, [["slow 0", "fixed", "slow 2"]])
+    verifier = FakeVerifier()
+    solution = _solution(tmp_path)
+    initial = FakeOutput(return_code=1, output="", duration=0)
+
+    with SolutionWorkspace(solution, temp_dir=tmp_path) as workspace:
+        result, output = _repair(
+            _command(monkeypatch, 3),
+            generator,
+            verifier,
+            solution,
+            workspace,
+            1,
+            initial,
+        )
+
+    assert result is not None and result.successful and result.attempts == 1
+    assert result.repaired_source == "fixed"
+    assert output.output == "fixed"
+    assert solution.files[0].content == "fixed"
+    # The conversation continues with the response of the winner.
+    assert generator.turns[0].messages[-1].text == "```c\nfixed\n```"
+    # The candidates that were still running were cancelled, the ones that
+    # had not started were not run.
+    assert sorted(verifier.cancelled) == sorted(
+        code for code in verifier.verified if "slow" in code
+    )
+
+
+def test_retry_feeds_back_first_candidate(
+    tmp_path: Path, monkeypatch: pytest.MonkeyPatch
+) -> None:
+    # The first candidate is the last to finish verifying.
+    generator, prompted = _generator(
+        monkeypatch, [["delay 0", "bad 1", "bad 2"], ["fixed", "bad 3", "bad 4"]]
+    )
+    verifier = FakeVerifier()
+    solution = _solution(tmp_path)
+    command = _command(monkeypatch, 3)
+    initial = FakeOutput(return_code=1, output="", duration=0)
+
+    with SolutionWorkspace(solution, temp_dir=tmp_path) as workspace:
+        result, output = _repair(
+            command, generator, verifier, solution, workspace, 1, initial
+        )
+        assert result is None
+        assert output.output == "delay 0"
+        assert solution.files[0].content == "delay 0"
+
+        result, output = _repair(
+            command, generator, verifier, solution, workspace, 2, output
+        )
+
+    assert result is not None and result.attempts == 2
+    # The retry was prompted with the output of the first candidate, which is
+    # the only one kept in the conversation.
+    assert prompted[1].output == "delay 0"
+    assert generator.turns[0].messages[-1].text == "```c\ndelay 0\n```"
+
+
+def test_all_candidates_fail(tmp_path: Path, monkeypatch: pytest.MonkeyPatch) -> None:
+    generator, _ = _generator(monkeypatch, [["bad 0", "bad 1", "bad 1"]])
+    verifier = FakeVerifier()
+    solution = _solution(tmp_path)
+    initial = FakeOutput(return_code=1, output="", duration=0)
+
+    with SolutionWorkspace(solution, temp_dir=tmp_path) as workspace:
+        result, output = _repair(
+            _command(monkeypatch, 3),
+            generator,
+            verifier,
+            solution,
+            workspace,
+            1,
+            initial,
+        )
+
+    assert result is None
+    assert output.output == "bad 0" and not output.successful
+    assert solution.files[0].content == "bad 0"
+    # Identical candidates are verified once.
+    assert sorted(verifier.verified) == ["bad 0", "bad 1"]
+
+
+def test_first_candidate_fails_to_verify(
+    tmp_path: Path, monkeypatch: pytest.MonkeyPatch
+) -> None:
+    """When the first candidate has no verifier output, the code of the
+    candidate whose output is fed back is kept."""
+    generator, _ = _generator(monkeypatch, [["error 0", "delay 1", "bad 2"]])
+    verifier = FakeVerifier()
+    solution = _solution(tmp_path)
+    initial = FakeOutput(return_code=1, output="", duration=0)
+
+    with SolutionWorkspace(solution, temp_dir=tmp_path) as workspace:
+        result, output = _repair(
+            _command(monkeypatch, 3),
+            generator,
+            verifier,
+            solution,
+            workspace,
+            1,
+            initial,
+        )
+
+    assert result is None
+    assert output.output == "delay 1"
+    assert solution.files[0].content == "delay 1"
+    assert generator.turns[0].messages[-1].text == "```c\ndelay 1\n```"
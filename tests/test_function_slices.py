@@ -0,0 +1,104 @@
+# Author: Yiannis Charalambous
+
+"""Tests for splitting solutions into functions."""
+
+from pathlib import Path
+
+from esbmc_ai.function_slices import SolutionSlices
+from esbmc_ai.solution import Solution, SourceFile
+
+PROGRAM: str = """#include <stdlib.h>
+
+int table_entry(int x);
+int (*table[])(int) = {table_entry};
+
+int leaf(int x) {
+  return x + 1;
+}
+
+int middle(int x) {
+  return leaf(x) * 2;
+}
+
+int unused(int x) {
+  return x;
+}
+
+int table_entry(int x) {
+  return x;
+}
+
+int main(void) {
+  return middle(1);
+}
+"""
+
+
+def _slices(content: str) -> SolutionSlices:
+    solution = Solution([])
+    solution.add_source_file(SourceFile(Path("/tmp/program.c"), content))
+    return SolutionSlices(solution)
+
+
+def test_call_tree() -> None:
+    slices = _slices(PROGRAM)
+    assert set(slices.functions) == {
+        "leaf",
+        "middle",
+        "unused",
+        "table_entry",
+        "main",
+    }
+    assert slices.functions["middle"].references == {"leaf"}
+    # Functions named outside of functions can be reached from anywhere.
+    assert slices.call_tree("main") == {"main", "middle", "leaf", "table_entry"}
+    assert slices.call_tree("unused") == {"unused", "table_entry"}
+
+
+def test_call_tree_digest() -> None:
+    digest = _slices(PROGRAM).call_tree_digest("main")
+    assert digest is not None
+    assert _slices(PROGRAM).call_tree_digest("missing") is None
+
+    # Functions outside of the call tree don't change the digest.
+    changed = _slices(
+        PROGRAM.replace(
+            "int unused(int x) {\n  return x;", "int unused(int x) {\n  return 0;"
+        )
+    )
+    assert changed.call_tree_digest("main") == digest
+    assert changed.call_tree_digest("unused") != _slices(PROGRAM).call_tree_digest(
+        "unused"
+    )
+
+    # Functions in the call tree and the code outside functions do.
+    changed = _slices(PROGRAM.replace("x + 1", "x + 2"))
+    assert changed.call_tree_digest("main") != digest
+    assert (
+        _slices(PROGRAM.replace("<stdlib.h>", "<stdio.h>")).call_tree_digest("main")
+        != digest
+    )
+
+
+def test_call_tree_digest_include_dirs(tmp_path: Path) -> None:
+    """Headers in the include dirs and the paths of the files are part of the
+    digest."""
+    (tmp_path / "include").mkdir()
+    header = tmp_path / "include" / "value.h"
+    header.write_text("#define VALUE 1\n")
+    (tmp_path / "src").mkdir()
+    (tmp_path / "src" / "program.c").write_text(PROGRAM)
+
+    def digest(path: Path = tmp_path / "src" / "program.c") -> str | None:
+        solution = Solution([], include_dirs=[tmp_path / "include"])
+        solution.add_source_file(SourceFile(path, PROGRAM))
+        solution.add_source_file(SourceFile(tmp_path / "src" / "other.c", ""))
+        return SolutionSlices(solution).call_tree_digest("main")
+
+    before = digest()
+    assert digest() == before
+    header.write_text("#define VALUE 22\n")
+    assert digest() != before
+
+    # The same file name in another directory is another program.
+    assert digest(tmp_path / "src" / "sub" / "program.c") != digest()
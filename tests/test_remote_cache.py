@@ -0,0 +1,168 @@
+# Author: Yiannis Charalambous
+
+"""Tests for the remote cache backend against the reference cache server."""
+
+from http.client import HTTPConnection
+import os
+from pathlib import Path
+import subprocess
+import sys
+from threading import Thread
+from typing import Iterator
+
+import pytest
+
+from esbmc_ai.cache import DiskCache, RemoteCache
+from esbmc_ai.cache.cache_server import CacheHTTPServer, CacheUnixServer
+
+KEY: str = "ab" * 32
+
+
+@pytest.fixture
+def server(tmp_path: Path) -> Iterator[CacheHTTPServer]:
+    server = CacheHTTPServer(
+        ("127.0.0.1", 0), DiskCache(tmp_path / "server"), quiet=True
+    )
+    thread = Thread(target=server.serve_forever, daemon=True)
+    thread.start()
+    yield server
+    server.shutdown()
+    server.server_close()
+
+
+def _client(server: CacheHTTPServer, directory: Path) -> RemoteCache:
+    return RemoteCache(
+        url=f"http://127.0.0.1:{server.server_port}", local=DiskCache(directory)
+    )
+
+
+def test_write_behind_and_read_through(
+    server: CacheHTTPServer, tmp_path: Path
+) -> None:
+    writer = _client(server, tmp_path / "node1")
+    writer.put(KEY, b"result", version="ESBMC 7.8")
+    assert writer.flush()
+    assert server.cache.get(KEY) == b"result"
+
+    reader = _client(server, tmp_path / "node2")
+    assert reader.local.get(KEY) is None
+    assert reader.get(KEY) == b"result"
+    # Fetched entries are kept in the local cache.
+    assert reader.local.get(KEY) == b"result"
+    assert reader.local.stats().versions == {"ESBMC 7.8": 1}
+
+    remote_stats = reader.remote_stats()
+    assert remote_stats is not None and remote_stats.entries == 1
+    writer.close()
+
+
+def test_pending_uploads_are_sent_at_exit(
+    server: CacheHTTPServer, tmp_path: Path
+) -> None:
+    """A process that exits right after storing its results, like the CLI
+    does, still uploads them."""
+    script: str = (
+        "import sys\n"
+        "from pathlib import Path\n"
+        "from esbmc_ai.cache import DiskCache, RemoteCache\n"
+        f"cache = RemoteCache(url='http://127.0.0.1:{server.server_port}', "
+        f"local=DiskCache(Path({str(tmp_path / 'node')!r})))\n"
+        "for idx in range(50):\n"
+        "    cache.put(f'{idx:064x}', b'result')\n"
+        "sys.exit(0)\n"
+    )
+    subprocess.run(
+        [sys.executable, "-c", script],
+        check=True,
+        timeout=60,
+        env=dict(os.environ, PYTHONPATH=os.pathsep.join(sys.path)),
+    )
+    assert server.cache.stats().entries == 50
+
+
+def test_read_only_server(tmp_path: Path) -> None:
+    server = CacheHTTPServer(
+        ("127.0.0.1", 0), DiskCache(tmp_path / "server"), quiet=True, read_only=True
+    )
+    Thread(target=server.serve_forever, daemon=True).start()
+    try:
+        cache = _client(server, tmp_path / "node")
+        cache.put(KEY, b"result")
+        # The rejected upload is reported.
+        assert not cache.flush()
+        assert server.cache.get(KEY) is None
+        # The entry is still cached locally.
+        assert cache.get(KEY) == b"result"
+        cache.close()
+    finally:
+        server.shutdown()
+        server.server_close()
+
+
+def test_rejected_puts(tmp_path: Path) -> None:
+    """Invalid and oversized stores are rejected before their body is read."""
+    server = CacheHTTPServer(
+        ("127.0.0.1", 0), DiskCache(tmp_path / "server"), quiet=True, max_entry_size=8
+    )
+    Thread(target=server.serve_forever, daemon=True).start()
+
+    def put(headers: dict[str, str], body: bytes = b"") -> int:
+        connection = HTTPConnection("127.0.0.1", server.server_port, timeout=10)
+        connection.putrequest("PUT", f"/entries/{KEY}")
+        for name, value in headers.items():
+            connection.putheader(name, value)
+        connection.endheaders(body or None)
+        status: int = connection.getresponse().status
+        connection.close()
+        return status
+
+    try:
+        assert put({"Content-Length": "bad"}) == 400
+        assert put({"Content-Length": "-1"}) == 400
+        assert put({}) == 411
+        assert put({"Content-Length": str(1 << 40)}) == 413
+        assert put({"Content-Length": "6"}, b"result") == 204
+        assert server.cache.get(KEY) == b"result"
+    finally:
+        server.shutdown()
+        server.server_close()
+
+
+def test_missing_entry(server: CacheHTTPServer, tmp_path: Path) -> None:
+    cache = _client(server, tmp_path / "node")
+    assert cache.get(KEY) is None
+
+
+def test_falls_back_to_local_when_offline(tmp_path: Path) -> None:
+    cache = RemoteCache(
+        url="http://127.0.0.1:9", local=DiskCache(tmp_path / "node"), timeout=1
+    )
+    cache.put(KEY, b"result")
+    cache.put("cd" * 32, b"result")
+    # Neither upload reaches the store, the second is dropped without
+    # contacting it again. flush reports them once.
+    assert not cache.flush()
+    assert cache.flush()
+    assert cache.get(KEY) == b"result"
+    assert cache.get("ef" * 32) is None
+
+
+def test_unix_socket(tmp_path: Path) -> None:
+    socket_path = tmp_path / "cache.sock"
+    server = CacheUnixServer(socket_path, DiskCache(tmp_path / "server"), quiet=True)
+    Thread(target=server.serve_forever, daemon=True).start()
+    try:
+        cache = RemoteCache(
+            url=f"unix://{socket_path}", local=DiskCache(tmp_path / "node")
+        )
+        cache.put(KEY, b"result")
+        cache.flush()
+        assert server.cache.get(KEY) == b"result"
+    finally:
+        server.shutdown()
+        server.server_close()
+
+
+def test_rejects_unsupported_url(tmp_path: Path) -> None:
+    with pytest.raises(ValueError):
+        RemoteCache(url="ftp://host", local=DiskCache(tmp_path))
@@ -3,6 +3,9 @@
 from pathlib import Path
 from tempfile import TemporaryDirectory
 
+import pytest
+
+import esbmc_ai.solution
 from esbmc_ai.solution import SourceFile, Solution, SolutionIntegrityError
 
 #####################################
@@ -278,3 +281,76 @@ def test_save_temp_preserves_nested_include_dirs():
 
         if temp_solution.working_dir.exists():
             shutil.rmtree(temp_solution.working_dir)
+
+
+#####################################
+# Hashing
+#####################################
+
+
+def test_source_file_digest_follows_content():
+    """The digest is memoized but tracks reassignments of the content."""
+    source_file = SourceFile(file_path=Path("/tmp/a.c"), content="int a;")
+    digest = source_file.digest
+    assert digest == source_file.digest
+    assert hash(source_file) == hash(SourceFile(Path("/tmp/b.c"), "int a;"))
+
+    source_file.content = "int b;"
+    assert source_file.digest != digest
+    source_file.content = "int " + "a;"
+    assert source_file.digest == digest
+
+
+def test_solution_digest_tracks_include_dirs(tmp_path: Path):
+    """Include dir digests pick up modified, added and removed headers."""
+    include_dir = tmp_path / "include"
+    include_dir.mkdir()
+    header = include_dir / "a.h"
+    header.write_text("int a;")
+    source = tmp_path / "main.c"
+    source.write_text("int main() { return 0; }")
+
+    solution = Solution(files=[source], include_dirs=[include_dir])
+    digest = solution.digest
+    assert digest == solution.digest
+
+    header.write_text("long a;")
+    modified = solution.digest
+    assert modified != digest
+
+    (include_dir / "b.h").write_text("int b;")
+    added = solution.digest
+    assert added != modified
+
+    (include_dir / "b.h").unlink()
+    assert solution.digest == modified
+
+
+def test_include_dir_listings_are_memoized(
+    tmp_path: Path, monkeypatch: pytest.MonkeyPatch
+):
+    """Only the directories whose entries changed are listed again."""
+    monkeypatch.setattr(esbmc_ai.solution, "_directory_listings", {})
+    listed: list[Path] = []
+    scandir = esbmc_ai.solution.scandir
+
+    def counting_scandir(path):
+        listed.append(Path(path))
+        return scandir(path)
+
+    monkeypatch.setattr(esbmc_ai.solution, "scandir", counting_scandir)
+    include_dir = tmp_path / "include"
+    (include_dir / "sub").mkdir(parents=True)
+    (include_dir / "a.h").write_text("int a;")
+    (include_dir / "sub" / "b.h").write_text("int b;")
+    solution = Solution(files=[], include_dirs=[include_dir])
+
+    digest = solution.include_dirs_digest
+    assert sorted(listed) == [include_dir, include_dir / "sub"]
+    listed.clear()
+    assert solution.include_dirs_digest == digest
+    assert listed == []
+
+    (include_dir / "sub" / "c.h").write_text("int c;")
+    assert solution.include_dirs_digest != digest
+    assert listed == [include_dir / "sub"]
@@ -0,0 +1,258 @@
+# Author: Yiannis Charalambous
+
+"""Tests for the async and streaming APIs of the solution generator."""
+
+import asyncio
+from pathlib import Path
+
+import pytest
+from langchain_core.messages import (
+    AIMessage,
+    AIMessageChunk,
+    BaseMessage,
+    HumanMessage,
+)
+from langchain_core.prompts import PromptTemplate
+
+from esbmc_ai.chats.conversation_memory import ConversationTurn
+from esbmc_ai.chats.solution_generator import CodeFenceExtractor, SolutionGenerator
+from esbmc_ai.solution import Solution, SourceFile
+from esbmc_ai.unified_diff import unified_diff
+from esbmc_ai.verifiers.esbmc import ESBMCOutput
+
+# The template is not rendered, see _generator.
+PROMPT = PromptTemplate(template="", input_variables=[])
+
+
+class DelayedModel:
+    """Stands in for a chat model, the n-th request is answered with candidate
+    n after delays[n] seconds."""
+
+    def __init__(self, delays: list[float]) -> None:
+        self.delays: list[float] = delays
+        self.requests: int = 0
+        self.cancelled: int = 0
+
+    async def ainvoke(self, messages: list[BaseMessage]) -> AIMessage:
+        _ = messages
+        idx: int = self.requests
+        self.requests += 1
+        try:
+            await asyncio.sleep(self.delays[idx])
+        except asyncio.CancelledError:
+            self.cancelled += 1
+            raise
+        return AIMessage(content=f"```c\nint candidate_{idx};\n```")
+
+
+def _generator(
+    monkeypatch: pytest.MonkeyPatch, delays: list[float]
+) -> tuple[SolutionGenerator, DelayedModel]:
+    model = DelayedModel(delays)
+    generator = SolutionGenerator(ai_model=model)  # type: ignore[arg-type]
+
+    def push_prompt(*_) -> ConversationTurn:
+        # Skips rendering the template.
+        turn = ConversationTurn(messages=[HumanMessage(content="prompt")])
+        generator.turns.append(turn)
+        return turn
+
+    monkeypatch.setattr(generator, "_push_prompt", push_prompt)
+    return generator, model
+
+
+def _solution() -> Solution:
+    solution = Solution([])
+    solution.add_source_file(SourceFile(Path("/tmp/main.c"), "int a;\n"))
+    return solution
+
+
+def test_agenerate_solution(monkeypatch: pytest.MonkeyPatch) -> None:
+    generator, _ = _generator(monkeypatch, [0])
+    output = ESBMCOutput(return_code=1, output="")
+    code = asyncio.run(generator.agenerate_solution(PROMPT, _solution(), output))
+    assert code == "int candidate_0;"
+    assert generator.messages[-1].text == "```c\nint candidate_0;\n```"
+    assert generator.turns[-1].summary is not None
+
+
+def test_aiter_solutions_yields_in_arrival_order(
+    monkeypatch: pytest.MonkeyPatch,
+) -> None:
+    generator, model = _generator(monkeypatch, [0.2, 0, 0.1])
+    output = ESBMCOutput(return_code=1, output="")
+
+    async def collect() -> list[tuple[int, str]]:
+        return [
+            candidate
+            async for candidate in generator.aiter_solutions(
+                PROMPT, _solution(), output, count=3
+            )
+        ]
+
+    assert asyncio.run(collect()) == [
+        (1, "int candidate_1;"),
+        (2, "int candidate_2;"),
+        (0, "int candidate_0;"),
+    ]
+    assert model.requests == 3 and generator.invokations == 3
+    # Only the first candidate is kept in the conversation.
+    assert generator.messages[-1].text == "```c\nint candidate_0;\n```"
+
+
+def test_aiter_solutions_cancels_remaining_requests(
+    monkeypatch: pytest.MonkeyPatch,
+) -> None:
+    generator, model = _generator(monkeypatch, [10, 0, 10])
+    output = ESBMCOutput(return_code=1, output="")
+
+    async def first() -> tuple[int, str]:
+        candidates = generator.aiter_solutions(PROMPT, _solution(), output, count=3)
+        candidate = await anext(candidates)
+        await candidates.aclose()
+        # Let the cancelled requests run to handle the cancellation.
+        await asyncio.sleep(0)
+        return candidate
+
+    assert asyncio.run(first()) == (1, "int candidate_1;")
+    assert model.cancelled == 2
+
+
+RESPONSE: str = (
+    "Here is the fix:\n```c\nint main() {\n  return 0;\n}\n```\n"
+    "The bug was in the return value."
+)
+
+
+def test_code_fence_extractor() -> None:
+    """The code is the same as extract_code_from_solution, wherever the
+    response is split into chunks."""
+    expected = SolutionGenerator.extract_code_from_solution(RESPONSE)
+    closing_fence_end = RESPONSE.index("```\n", RESPONSE.index("}")) + 4
+    for split in range(1, len(RESPONSE)):
+        extractor = CodeFenceExtractor()
+        first = extractor.feed(RESPONSE[:split])
+        second = extractor.feed(RESPONSE[split:])
+        # The code is found by the chunk that holds the end of the fence.
+        assert (first if split >= closing_fence_end else second) == expected
+        assert extractor.code == expected and extractor.finish() is None
+
+
+def test_code_fence_extractor_closed_at_end() -> None:
+    extractor = CodeFenceExtractor()
+    assert extractor.feed("```python\nprint(1)\n```") is None
+    assert extractor.finish() == "print(1)"
+
+    extractor = CodeFenceExtractor()
+    assert extractor.feed("no code") is None
+    assert extractor.finish() is None and extractor.code is None
+
+
+class StreamingModel:
+    """Stands in for a chat model, streams RESPONSE a few characters at a
+    time and records how many chunks were sent."""
+
+    def __init__(self) -> None:
+        self.sent: int = 0
+
+    def stream(self, messages: list[BaseMessage]):
+        _ = messages
+        for idx in range(0, len(RESPONSE), 5):
+            self.sent += 1
+            yield AIMessageChunk(content=RESPONSE[idx : idx + 5])
+
+
+def test_stream_solution(monkeypatch: pytest.MonkeyPatch) -> None:
+    generator, _ = _generator(monkeypatch, [])
+    model = StreamingModel()
+    generator.ai_model = model  # type: ignore[assignment]
+    received: list[tuple[str, int]] = []
+
+    code = generator.stream_solution(
+        PROMPT,
+        _solution(),
+        ESBMCOutput(return_code=1, output=""),
+        on_code=lambda code: received.append((code, model.sent)),
+    )
+    assert code == "int main() {\n  return 0;\n}"
+    # The code was handed over before the trailing prose was streamed.
+    assert [c for c, _ in received] == [code]
+    assert received[0][1] < model.sent
+    assert generator.messages[-1].text == RESPONSE
+
+
+SOURCE: str = "int main() {\n  int a[2];\n  a[2] = 1;\n  return 0;\n}\n"
+
+
+def _source_solution() -> Solution:
+    solution = Solution([])
+    solution.add_source_file(SourceFile(Path("/tmp/main.c"), SOURCE))
+    return solution
+
+
+def test_apply_diff_solution() -> None:
+    # The hunk header is off by a line, it is found with an offset.
+    response = (
+        "```diff\n--- a/main.c\n+++ b/main.c\n@@ -3,3 +3,3 @@\n"
+        "   int a[2];\n-  a[2] = 1;\n+  a[1] = 1;\n   return 0;\n```"
+    )
+    solution = _source_solution()
+    code = SolutionGenerator.apply_diff_solution(solution, response)
+    assert code == SOURCE.replace("a[2] = 1", "a[1] = 1")
+    # The solution is not changed.
+    assert solution.files[0].content == SOURCE
+
+
+def test_apply_diff_solution_rejected() -> None:
+    solution = _source_solution()
+    # Context that is not in the file.
+    assert (
+        SolutionGenerator.apply_diff_solution(
+            solution,
+            "```diff\n--- a/main.c\n+++ b/main.c\n@@ -1 +1 @@\n-int b;\n+int c;\n```",
+        )
+        is None
+    )
+    # The line counts don't match the hunk.
+    assert (
+        SolutionGenerator.apply_diff_solution(
+            solution,
+            "```diff\n--- a/main.c\n+++ b/main.c\n@@ -3,2 +3,2 @@\n"
+            "-  a[2] = 1;\n+  a[1] = 1;\n```",
+        )
+        is None
+    )
+    # The whole file rather than a diff.
+    assert SolutionGenerator.apply_diff_solution(solution, f"```c\n{SOURCE}```") is None
+
+
+class ListModel:
+    """Stands in for a chat model, answers with the responses in order."""
+
+    def __init__(self, responses: list[str]) -> None:
+        self.responses: list[str] = responses
+
+    def invoke(self, messages: list[BaseMessage]) -> AIMessage:
+        _ = messages
+        return AIMessage(content=self.responses.pop(0))
+
+
+def test_generate_diff_solution_falls_back(monkeypatch: pytest.MonkeyPatch) -> None:
+    generator, _ = _generator(monkeypatch, [])
+    fixed: str = SOURCE.replace("a[2] = 1", "a[1] = 1")
+    generator.ai_model = ListModel(  # type: ignore[assignment]
+        ["```diff\n--- a/main.c\n+++ b/main.c\nnot a hunk\n```", f"```c\n{fixed}```"]
+    )
+    code = generator.generate_diff_solution(
+        PROMPT, PROMPT, _source_solution(), ESBMCOutput(return_code=1, output="")
+    )
+    assert code == fixed.rstrip("\n")
+    assert generator.diff_fallbacks == 1 and generator.invokations == 2
+    # The fallback is part of the same attempt.
+    assert generator.attempts == 1
+    assert [turn.summary for turn in generator.turns] == [
+        "Repair attempt 1 gave a diff that could not be applied.",
+        "Repair attempt 1 made these changes:\n\n```diff\n"
+        + unified_diff(SOURCE, code, "a/main.c", "b/main.c")
+        + "```",
+    ]
@@ -0,0 +1,129 @@
+# Author: Yiannis Charalambous
+
+"""Tests for the overlay workspace of solutions."""
+
+from pathlib import Path
+
+import pytest
+
+import esbmc_ai.solution
+from esbmc_ai.solution import Solution, SourceFile
+from esbmc_ai.solution_workspace import SolutionWorkspace
+
+
+def _solution(tmp_path: Path) -> Solution:
+    project = tmp_path / "project"
+    (project / "include").mkdir(parents=True)
+    (project / "include" / "util.h").write_text("int util(void);\n")
+    (project / "main.c").write_text("int main(void) { return 0; }\n")
+    (project / "other.c").write_text("int other;\n")
+    return Solution(
+        [project / "main.c", project / "other.c"],
+        include_dirs=[project / "include"],
+    )
+
+
+def _variant(solution: Solution, content: str) -> Solution:
+    variant = Solution([], include_dirs=solution.include_dirs)
+    for source_file in solution.files:
+        variant.add_source_file(
+            SourceFile(
+                file_path=source_file.file_path,
+                content=(
+                    content
+                    if source_file.file_path.name == "main.c"
+                    else source_file.content
+                ),
+            )
+        )
+    return variant
+
+
+def test_only_modified_files_are_written(tmp_path: Path) -> None:
+    solution = _solution(tmp_path)
+    with SolutionWorkspace(solution, temp_dir=tmp_path) as workspace:
+        attempt = workspace.materialize(_variant(solution, "int main;\n"))
+        main = next(f for f in attempt.files if f.file_path.name == "main.c")
+        other = next(f for f in attempt.files if f.file_path.name == "other.c")
+
+        assert main.file_path.read_text() == "int main;\n"
+        assert main.file_path.stat().st_nlink == 1
+        # Unchanged files are shared with the base snapshot.
+        assert other.file_path.samefile(workspace.base_dir / "other.c")
+        # Include dirs are referenced, not copied.
+        (include_dir,) = attempt.include_dirs
+        assert include_dir.is_symlink()
+        assert (include_dir / "util.h").read_text() == "int util(void);\n"
+
+        # The original solution is left untouched.
+        assert (solution.working_dir / "main.c").read_text() == (
+            "int main(void) { return 0; }\n"
+        )
+
+
+def test_attempts_are_reclaimed(tmp_path: Path) -> None:
+    solution = _solution(tmp_path)
+    workspace = SolutionWorkspace(solution, temp_dir=tmp_path)
+    with workspace.attempt(_variant(solution, "int a;\n")) as attempt:
+        attempt_dir = attempt.working_dir
+        assert attempt_dir.exists()
+    assert not attempt_dir.exists()
+    assert workspace.base_dir.exists()
+
+    workspace.close()
+    assert not workspace.root.exists()
+
+
+def test_attempts_are_kept_without_auto_clean(tmp_path: Path) -> None:
+    solution = _solution(tmp_path)
+    with SolutionWorkspace(
+        solution, temp_dir=tmp_path, auto_clean=False
+    ) as workspace:
+        with workspace.attempt(_variant(solution, "int a;\n")) as attempt:
+            attempt_dir = attempt.working_dir
+    assert attempt_dir.exists()
+    assert workspace.root.exists()
+
+
+def test_attempt_include_dirs_share_digests(
+    tmp_path: Path, monkeypatch: pytest.MonkeyPatch
+) -> None:
+    """The include files of the attempts are reached through symlinks, their
+    digests are memoized on the files so they are only read once."""
+    monkeypatch.setattr(esbmc_ai.solution, "_include_file_digests", {})
+    solution = _solution(tmp_path)
+    digest = solution.include_dirs_digest
+    with SolutionWorkspace(solution, temp_dir=tmp_path) as workspace:
+        for content in ("int a;\n", "int b;\n"):
+            with workspace.attempt(_variant(solution, content)) as attempt:
+                assert attempt.include_dirs_digest == digest
+    assert len(esbmc_ai.solution._include_file_digests) == 1
+
+
+def test_include_dir_holding_solution_files(tmp_path: Path) -> None:
+    """An include dir that holds the files of the solution (such as -I on the
+    source dir) has all of its headers in each attempt, and the attempt's own
+    version of the solution files."""
+    project = tmp_path / "project"
+    (project / "sub").mkdir(parents=True)
+    (project / "main.c").write_text("int main;\n")
+    (project / "util.h").write_text("int util(void);\n")
+    (project / "sub" / "extra.h").write_text("int extra;\n")
+    solution = Solution([project / "main.c"], include_dirs=[project])
+    # The in memory content differs from the one on disk.
+    solution.files[0].content = "int main(void) { return 0; }\n"
+
+    with SolutionWorkspace(solution, temp_dir=tmp_path) as workspace:
+        assert (workspace.base_dir / "main.c").read_text() == (
+            "int main(void) { return 0; }\n"
+        )
+        with workspace.attempt(_variant(solution, "int a;\n")) as attempt:
+            (include_dir,) = attempt.include_dirs
+            assert include_dir == attempt.working_dir
+            assert (include_dir / "main.c").read_text() == "int a;\n"
+            assert (include_dir / "util.h").read_text() == "int util(void);\n"
+            assert (include_dir / "sub" / "extra.h").read_text() == "int extra;\n"
+        # The base keeps its own version of the solution files.
+        assert (workspace.base_dir / "main.c").read_text() == (
+            "int main(void) { return 0; }\n"
+        )
@@ -0,0 +1,242 @@
+# Author: Yiannis Charalambous
+
+"""Tests for the in-process unified diff engine."""
+
+from pathlib import Path
+import random
+import shutil
+import subprocess
+
+import pytest
+
+from esbmc_ai.solution import Solution, SourceFile
+from esbmc_ai.unified_diff import (
+    PatchParseError,
+    apply_patch,
+    parse_patch,
+    unified_diff,
+)
+
+
+def _gnu_diff(tmp_path: Path, a: str, b: str) -> str:
+    (tmp_path / "a").write_text(a)
+    (tmp_path / "b").write_text(b)
+    process = subprocess.run(
+        ["diff", "-u", "--label", "a.c", "--label", "b.c", "a", "b"],
+        cwd=tmp_path,
+        capture_output=True,
+        check=False,
+    )
+    return process.stdout.decode("utf-8")
+
+
+def test_equal_texts() -> None:
+    assert unified_diff("int a;\n", "int a;\n", "a.c", "b.c") == ""
+
+
+def test_simple_change() -> None:
+    a = "".join(f"line {i}\n" for i in range(10))
+    b = a.replace("line 5\n", "line five\n")
+    assert unified_diff(a, b, "a.c", "b.c") == (
+        "--- a.c\n"
+        "+++ b.c\n"
+        "@@ -3,7 +3,7 @@\n"
+        " line 2\n"
+        " line 3\n"
+        " line 4\n"
+        "-line 5\n"
+        "+line five\n"
+        " line 6\n"
+        " line 7\n"
+        " line 8\n"
+    )
+
+
+def test_no_newline_at_end_of_file() -> None:
+    assert unified_diff("a\nb", "a\nb\n", "a.c", "b.c") == (
+        "--- a.c\n"
+        "+++ b.c\n"
+        "@@ -1,2 +1,2 @@\n"
+        " a\n"
+        "-b\n"
+        "\\ No newline at end of file\n"
+        "+b\n"
+    )
+
+
+def test_empty_files() -> None:
+    assert unified_diff("", "a\n", "a.c", "b.c") == (
+        "--- a.c\n+++ b.c\n@@ -0,0 +1 @@\n+a\n"
+    )
+    assert unified_diff("a\n", "", "a.c", "b.c") == (
+        "--- a.c\n+++ b.c\n@@ -1 +0,0 @@\n-a\n"
+    )
+
+
+@pytest.mark.skipif(shutil.which("diff") is None, reason="diff is not installed")
+def test_matches_diff(tmp_path: Path) -> None:
+    """The output is byte for byte the same as diff -u, also when there are
+    several shortest edit scripts to pick from."""
+    rng = random.Random(0)
+    for _ in range(300):
+        alphabet = rng.choice(["ab", "abc", "abcdefgh"])
+        a = [rng.choice(alphabet) for _ in range(rng.randint(0, 60))]
+        b = list(a)
+        for _ in range(rng.randint(0, 8)):
+            position = rng.randint(0, len(b))
+            if rng.random() < 0.5 and position < len(b):
+                del b[position]
+            else:
+                b.insert(position, rng.choice(alphabet))
+        text_a = "\n".join(a) + ("\n" if rng.random() < 0.8 else "")
+        text_b = "\n".join(b) + ("\n" if rng.random() < 0.8 else "")
+        assert unified_diff(text_a, text_b, "a.c", "b.c") == _gnu_diff(
+            tmp_path, text_a, text_b
+        )
+
+
+def test_source_file_diff() -> None:
+    original = SourceFile(Path("/tmp/a.c"), "int a;\nint b;\n")
+    modified = SourceFile(Path("/tmp/b.c"), "int a;\nint c;\n")
+    assert modified.get_diff(original) == (
+        "--- /tmp/a.c\n+++ /tmp/b.c\n@@ -1,2 +1,2 @@\n int a;\n-int b;\n+int c;\n"
+    )
+    assert original.get_diff(SourceFile(Path("/tmp/c.c"), "int a;\nint b;\n")) == ""
+
+
+def test_solution_diff_skips_unchanged_files(tmp_path: Path) -> None:
+    for name in ("old", "new"):
+        (tmp_path / name).mkdir()
+        (tmp_path / name / "same.c").write_text("int same;\n")
+    (tmp_path / "old" / "changed.c").write_text("int a;\n")
+    (tmp_path / "new" / "changed.c").write_text("int b;\n")
+    (tmp_path / "new" / "added.c").write_text("int added;\n")
+
+    old = Solution.from_paths(tmp_path / "old")
+    new = Solution.from_paths(tmp_path / "new")
+    old_dir, new_dir = old.working_dir, new.working_dir
+
+    assert old.get_diff(new) == (
+        f"diff -ruN {old_dir / 'added.c'} {new_dir / 'added.c'}\n"
+        f"--- {old_dir / 'added.c'}\n"
+        f"+++ {new_dir / 'added.c'}\n"
+        "@@ -0,0 +1 @@\n"
+        "+int added;\n"
+        f"diff -ruN {old_dir / 'changed.c'} {new_dir / 'changed.c'}\n"
+        f"--- {old_dir / 'changed.c'}\n"
+        f"+++ {new_dir / 'changed.c'}\n"
+        "@@ -1 +1 @@\n"
+        "-int a;\n"
+        "+int b;\n"
+    )
+
+
+#####################################
+# Patching
+#####################################
+
+
+def _lines(count: int) -> str:
+    return "".join(f"line {i}\n" for i in range(count))
+
+
+def test_patch_round_trip() -> None:
+    """Applying a diff reproduces the modified text exactly."""
+    rng = random.Random(1)
+    for _ in range(200):
+        a = [rng.choice("abcdef") for _ in range(rng.randint(0, 40))]
+        b = list(a)
+        for _ in range(rng.randint(1, 6)):
+            b.insert(rng.randint(0, len(b)), rng.choice("xyz"))
+            if b and rng.random() < 0.5:
+                del b[rng.randrange(len(b))]
+        text_a = "\n".join(a) + ("\n" if rng.random() < 0.8 else "")
+        text_b = "\n".join(b) + ("\n" if rng.random() < 0.8 else "")
+        diff = unified_diff(text_a, text_b, "a.c", "b.c")
+        if not diff:
+            continue
+        (file_patch,) = parse_patch(diff)
+        patched, results = apply_patch(text_a, file_patch.hunks)
+        assert all(r.applied and r.offset == 0 and r.fuzz == 0 for r in results)
+        assert patched == text_b
+
+
+def test_patch_with_offset() -> None:
+    original = _lines(20)
+    modified = original.replace("line 10\n", "line ten\n")
+    (file_patch,) = parse_patch(unified_diff(original, modified, "a.c", "b.c"))
+
+    shifted = "extra 1\nextra 2\n" + original
+    patched, (result,) = apply_patch(shifted, file_patch.hunks)
+    assert result.applied and result.offset == 2 and result.fuzz == 0
+    assert patched == "extra 1\nextra 2\n" + modified
+
+
+def test_patch_with_fuzz() -> None:
+    original = _lines(20)
+    modified = original.replace("line 10\n", "line ten\n")
+    (file_patch,) = parse_patch(unified_diff(original, modified, "a.c", "b.c"))
+
+    drifted = original.replace("line 7\n", "line seven\n")
+    patched, (result,) = apply_patch(drifted, file_patch.hunks)
+    assert result.applied and result.fuzz == 1
+    assert patched == modified.replace("line 7\n", "line seven\n")
+
+    _, (result,) = apply_patch(drifted, file_patch.hunks, max_fuzz=0)
+    assert not result.applied
+
+
+def test_patch_accepts_missing_context_space() -> None:
+    """Empty context lines that lost their leading space still apply."""
+    patch = "--- a.c\n+++ b.c\n@@ -1,3 +1,3 @@\n a\n\n-b\n+c\n"
+    patched, (result,) = apply_patch("a\n\nb\n", parse_patch(patch)[0].hunks)
+    assert result.applied and patched == "a\n\nc\n"
+
+
+def test_patch_parse_errors() -> None:
+    with pytest.raises(PatchParseError):
+        parse_patch("@@ -1 +1 @@\n-a\n+b\n")
+    with pytest.raises(PatchParseError):
+        parse_patch("--- a.c\n+++ b.c\n@@ -1,2 +1,2 @@\n-a\n")
+
+
+def test_solution_patch(tmp_path: Path) -> None:
+    (tmp_path / "main.c").write_text(_lines(10))
+    (tmp_path / "util.c").write_text("int util;\n")
+    solution = Solution.from_paths(tmp_path)
+    main = solution.get_file(tmp_path / "main.c")
+
+    patch = (
+        "--- a/main.c\n+++ b/main.c\n@@ -2,3 +2,3 @@\n"
+        " line 1\n-line 2\n+line two\n line 3\n"
+        "--- /dev/null\n+++ b/new.c\n@@ -0,0 +1 @@\n+int created;\n"
+    )
+    result = solution.patch_solution(patch)
+    assert result.applied
+    assert main.content == _lines(10).replace("line 2\n", "line two\n")
+    assert solution.get_file(tmp_path / "new.c").content == "int created;\n"
+    # Nothing is written to disk.
+    assert (tmp_path / "main.c").read_text() == _lines(10)
+
+
+def test_solution_patch_rejected(tmp_path: Path) -> None:
+    """A patch with a failing hunk leaves the solution untouched."""
+    (tmp_path / "main.c").write_text(_lines(10))
+    (tmp_path / "util.c").write_text("int util;\n")
+    solution = Solution.from_paths(tmp_path)
+
+    patch = (
+        "--- a/util.c\n+++ b/util.c\n@@ -1 +1 @@\n-int util;\n+long util;\n"
+        "--- a/main.c\n+++ b/main.c\n@@ -2 +2 @@\n-not there\n+line two\n"
+    )
+    result = solution.patch_solution(patch)
+    assert not result.applied and result.failed_hunks == 1
+    assert solution.get_file(tmp_path / "util.c").content == "int util;\n"
+
+    result = solution.patch_solution(patch, allow_partial=True)
+    assert solution.get_file(tmp_path / "util.c").content == "long util;\n"
+
+    result = solution.patch_solution(
+        "--- a/missing.c\n+++ b/missing.c\n@@ -1 +1 @@\n-int a;\n+int b;\n"
+    )
+    assert result.missing == ["b/missing.c"]
@@ -0,0 +1,223 @@
+# Author: Yiannis Charalambous
+
+"""Tests for the concurrent verifier service."""
+
+from concurrent.futures import as_completed
+from pathlib import Path
+import resource
+import signal
+import sys
+from threading import Barrier, Event, Thread
+from types import SimpleNamespace
+from typing import override
+
+from pydantic import ValidationError
+import pytest
+
+from esbmc_ai.config import VerifierConfig
+from esbmc_ai.solution import Solution, SourceFile
+from esbmc_ai.verifier_output import VerifierOutput
+from esbmc_ai.verifiers.base_source_verifier import (
+    BaseSourceVerifier,
+    ProcessLimits,
+    VerifierCancelledException,
+    process_limits,
+)
+from esbmc_ai.verifiers.verifier_service import VerifierService, available_cpus
+
+
+class PythonOutput(VerifierOutput):
+    @property
+    @override
+    def successful(self) -> bool:
+        return self.return_code == 0
+
+
+class PythonVerifier(BaseSourceVerifier):
+    """Runs the solution as a Python script, succeeding if it exits with 0.
+    The output is the affinity of the process and its address space limit."""
+
+    def __init__(self, **verifier_config) -> None:
+        super().__init__(verifier_name="python", authors="")
+        self.global_config = SimpleNamespace(  # type: ignore[assignment]
+            verifier=SimpleNamespace(
+                **{"memory_limit": None, "cpu_time_limit": None} | verifier_config
+            )
+        )
+
+    @override
+    def verify_source(
+        self, *, solution: Solution, timeout: int | None = None, **_
+    ) -> VerifierOutput:
+        process, duration = self.run_command(
+            [sys.executable, str(solution.files[0].file_path)],
+            cwd=solution.working_dir,
+            process_timeout=timeout,
+        )
+        return PythonOutput(
+            return_code=process.returncode,
+            output=process.stdout.decode("utf-8"),
+            duration=duration,
+            resource_usage=process.resource_usage,
+        )
+
+
+REPORT_LIMITS: str = (
+    "import os, resource\n"
+    "print(sorted(os.sched_getaffinity(0)))\n"
+    "print(resource.getrlimit(resource.RLIMIT_AS)[0])\n"
+)
+
+
+def _solution(tmp_path: Path, name: str, code: str) -> Solution:
+    path = tmp_path / name
+    path.write_text(code)
+    solution = Solution([])
+    solution.add_source_file(SourceFile(file_path=path, content=code))
+    return solution
+
+
+def test_runs_jobs_concurrently(tmp_path: Path) -> None:
+    solutions = [
+        _solution(tmp_path, f"job{i}.py", f"raise SystemExit({i % 2})")
+        for i in range(6)
+    ]
+    with VerifierService(PythonVerifier(), workers=3) as service:
+        futures = {service.submit(s): i for i, s in enumerate(solutions)}
+        codes = {futures[f]: f.result().return_code for f in as_completed(futures)}
+    assert codes == {i: i % 2 for i in range(6)}
+
+
+@pytest.mark.skipif(sys.platform != "linux", reason="Linux only")
+def test_process_limits(tmp_path: Path) -> None:
+    solution = _solution(tmp_path, "limits.py", REPORT_LIMITS)
+    with VerifierService(
+        PythonVerifier(), workers=1, cpu_affinity=True, memory_limit=1 << 32
+    ) as service:
+        output = service.submit(solution).result().output
+    affinity, memory_limit = output.splitlines()
+    assert affinity == str([available_cpus()[0]])
+    assert int(memory_limit) == 1 << 32
+
+
+@pytest.mark.skipif(sys.platform != "linux", reason="Linux only")
+def test_process_limits_at_start(tmp_path: Path) -> None:
+    """The limits are in place when the verifier starts, and are inherited by
+    the processes it starts right away."""
+    limits = ProcessLimits(
+        cpus=frozenset([available_cpus()[0]]),
+        memory_limit=1 << 32,
+        cpu_time_limit=60,
+    )
+    with process_limits(limits):
+        process, _ = PythonVerifier().run_command(
+            ["sh", "-c", "sh -c 'ulimit -v; ulimit -t; cat /proc/self/status'"],
+            cwd=tmp_path,
+            process_timeout=None,
+        )
+    memory_limit, cpu_time_limit, *status = process.stdout.decode().splitlines()
+    assert int(memory_limit) == (1 << 32) // 1024
+    assert cpu_time_limit == "60"
+    assert f"Cpus_allowed_list:\t{available_cpus()[0]}" in status
+
+
+@pytest.mark.skipif(sys.platform != "linux", reason="Linux only")
+def test_default_process_limits(tmp_path: Path) -> None:
+    """Verifier processes started outside of the service, such as by a
+    sequential repair, have the limits of the config, but are not pinned."""
+    solution = _solution(tmp_path, "limits.py", REPORT_LIMITS)
+    verifier = PythonVerifier(memory_limit=1 << 32)
+    output = verifier.verify_source(solution=solution).output
+    affinity, memory_limit = output.splitlines()
+    assert affinity == str(sorted(available_cpus()))
+    assert int(memory_limit) == 1 << 32
+
+    # The limits of the service replace the ones of the config.
+    with VerifierService(verifier, workers=1, memory_limit=1 << 33) as service:
+        output = service.submit(solution).result().output
+    assert int(output.splitlines()[1]) == 1 << 33
+
+
+@pytest.mark.skipif(sys.platform != "linux", reason="Linux only")
+def test_process_limits_zero_memory_limit(tmp_path: Path) -> None:
+    """A memory limit of 0 means no limit, rather than an address space that
+    the verifier cannot even be executed in."""
+    solution = _solution(tmp_path, "limits.py", REPORT_LIMITS)
+    with VerifierService(PythonVerifier(), workers=1, memory_limit=0) as service:
+        output = service.submit(solution).result()
+    assert output.return_code == 0
+    assert int(output.output.splitlines()[1]) == resource.RLIM_INFINITY
+
+
+def test_memory_limit_config_floor() -> None:
+    """The config rejects memory limits too small to execute the verifier."""
+    with pytest.raises(ValidationError):
+        VerifierConfig(memory_limit=0)
+    with pytest.raises(ValidationError):
+        VerifierConfig(memory_limit=(1 << 26) - 1)
+    assert VerifierConfig(memory_limit=1 << 26).memory_limit == 1 << 26
+
+
+def test_cache_created_once(tmp_path: Path) -> None:
+    """Threads that access the cache of a verifier at once share one cache."""
+    verifier = PythonVerifier(
+        cache_dir=tmp_path, cache_max_size=None, cache_remote_url=None
+    )
+    barrier = Barrier(8)
+    caches: list[object] = []
+
+    def access() -> None:
+        barrier.wait()
+        caches.append(verifier.cache)
+
+    threads = [Thread(target=access) for _ in range(8)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    assert len({id(cache) for cache in caches}) == 1
+
+
+def test_resource_usage(tmp_path: Path) -> None:
+    code = (
+        "import time\n"
+        "data = bytearray(64 << 20)\n"
+        "end = time.process_time() + 0.2\n"
+        "while time.process_time() < end: pass\n"
+    )
+    with VerifierService(PythonVerifier(), workers=1) as service:
+        output = service.submit(_solution(tmp_path, "usage.py", code)).result()
+    usage = output.resource_usage
+    assert usage is not None and usage.kill_reason is None
+    assert usage.max_rss >= 64 << 20
+    assert usage.user_time + usage.system_time >= 0.2
+
+
+@pytest.mark.skipif(sys.platform != "linux", reason="Linux only")
+def test_cpu_time_limit(tmp_path: Path) -> None:
+    solution = _solution(tmp_path, "spin.py", "while True: pass\n")
+    with VerifierService(PythonVerifier(), workers=1, cpu_time_limit=1) as service:
+        output = service.submit(solution, timeout=30).result()
+    assert output.return_code == -signal.SIGXCPU
+    assert output.resource_usage is not None
+    assert output.resource_usage.kill_reason == "SIGXCPU"
+    assert output.resource_usage.user_time >= 0.9
+
+
+def test_cancel_job(tmp_path: Path) -> None:
+    solution = _solution(tmp_path, "sleep.py", "import time\ntime.sleep(30)\n")
+    cancel_event = Event()
+    with VerifierService(PythonVerifier(), workers=1) as service:
+        running = service.submit(solution, cancel_event=cancel_event)
+        queued = service.submit(solution)
+        assert queued.cancel()
+        cancel_event.set()
+        with pytest.raises(VerifierCancelledException):
+            running.result(timeout=10)
+
+
+def test_closed_service_rejects_jobs(tmp_path: Path) -> None:
+    service = VerifierService(PythonVerifier(), workers=1)
+    service.close()
+    with pytest.raises(RuntimeError):
+        service.submit(_solution(tmp_path, "job.py", ""))